@@ -0,0 +1,123 @@
+/*
+ ## Cypress USB 3.0 Platform source file (cyfxbulklpcrc.c)
+ ## ===========================
+ ##
+ ##  Copyright Cypress Semiconductor Corporation, 2010-2011,
+ ##  All Rights Reserved
+ ##  UNPUBLISHED, LICENSED SOFTWARE.
+ ##
+ ##  CONFIDENTIAL AND PROPRIETARY INFORMATION
+ ##  WHICH IS THE PROPERTY OF CYPRESS.
+ ##
+ ##  Use of this file is governed
+ ##  by the license agreement included in the file
+ ##
+ ##     <install>/license/license.txt
+ ##
+ ##  where <install> is the Cypress software
+ ##  installation root directory path.
+ ##
+ ## ===========================
+*/
+
+/* This file contains the CRC32 engine used to check the FRAM data on the device.
+ * The CRC is the IEEE 802.3 CRC-32 (as used by zlib) computed with slice-by-4
+ * lookup tables, so four bytes are processed with four table lookups.
+ */
+
+#include "cyfxbulklpmaninout.h"
+
+uint32_t glCrcTable[4][256];            // Slice-by-4 lookup tables
+
+/* 32 bit word in the byte data block. The word reads are marked to alias
+ * the uint8_t data, so that strict aliasing does not apply to them. */
+typedef uint32_t __attribute__ ((__may_alias__)) CyFxBulkLpCrcWord_t;
+
+/*
+ * Build the CRC32 lookup tables
+ *
+ * This function must be called once before CyFxBulkLpCrcUpdate is used.
+ */
+void
+CyFxBulkLpCrcInit (
+    void
+) {
+    uint32_t crc;
+    uint16_t i;
+    uint8_t  j;
+
+    for (i = 0; i < 256; i++) {
+        crc = i;
+        for (j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? CY_FX_CRC32_POLY : 0);
+        }
+        glCrcTable[0][i] = crc;
+    }
+
+    /*
+     * Table n gives the CRC of a byte followed by n zero bytes.
+     */
+    for (i = 0; i < 256; i++) {
+        crc = glCrcTable[0][i];
+        for (j = 1; j < 4; j++) {
+            crc = (crc >> 8) ^ glCrcTable[0][crc & 0xFF];
+            glCrcTable[j][i] = crc;
+        }
+    }
+}
+
+/*
+ * Update a CRC32 with a data block
+ *
+ * Parameters
+ *
+ * uint32_t crc
+ *     The CRC of the preceding data, 0 for the first block.
+ * const uint8_t *data
+ *     The data block.
+ * uint32_t length
+ *     The number of bytes in the data block.
+ *
+ * Returns the CRC of the preceding data followed by the data block.
+ */
+uint32_t
+CyFxBulkLpCrcUpdate (
+    uint32_t        crc,
+    const uint8_t   *data,
+    uint32_t        length
+) {
+    uint32_t word;
+
+    crc = ~crc;
+
+    /*
+     * Process the leading bytes up to a word boundary.
+     */
+    while ((length > 0) && (((uint32_t)data & 3) != 0)) {
+        crc = (crc >> 8) ^ glCrcTable[0][(crc ^ *data++) & 0xFF];
+        length--;
+    }
+
+    /*
+     * Process a little endian word at a time.
+     */
+    while (length >= 4) {
+        word = crc ^ *(const CyFxBulkLpCrcWord_t *)data;
+        crc  = glCrcTable[3][word & 0xFF] ^
+               glCrcTable[2][(word >> 8) & 0xFF] ^
+               glCrcTable[1][(word >> 16) & 0xFF] ^
+               glCrcTable[0][word >> 24];
+        data   += 4;
+        length -= 4;
+    }
+
+    while (length > 0) {
+        crc = (crc >> 8) ^ glCrcTable[0][(crc ^ *data++) & 0xFF];
+        length--;
+    }
+
+    return ~crc;
+}
+
+/*[]*/
+
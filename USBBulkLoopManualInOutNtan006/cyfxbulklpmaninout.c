@@ -37,9 +37,9 @@
    to wait for buffer from the application thread. Refer to the MANUAL mode example for how to commit data from
    callback.
 
-   The DMA buffer size for each channel is defined based on the USB speed. 64 for full speed, 512 for high speed
-   and 1024 for super speed. CY_FX_BULKLP_DMA_BUF_COUNT in the header file defines the number of DMA buffers per
-   channel.
+   The DMA buffer size for each channel is CY_FX_BULKLP_DMA_CHUNK_SIZE independent of the USB speed, and
+   CY_FX_BULKLP_DMA_CHUNK_COUNT in the header file defines the number of DMA buffers per channel. A FRAM sector
+   is transferred in chunks of one DMA buffer so that the USB and SPI transfers can overlap.
  */
 
 #include "cyu3system.h"
@@ -51,18 +51,126 @@
 #include "cyu3uart.h"
 #include "cyu3spi.h"
 CyU3PThread     BulkLpAppThread;	 /* Bulk loop application thread structure */
+CyU3PThread     BulkLpSpiThread;        /* SPI worker thread structure */
 CyU3PDmaChannel glChHandleBulkLpIn;      /* DMA MANUAL_IN channel handle.          */
 CyU3PDmaChannel glChHandleBulkLpOut;     /* DMA MANUAL_OUT channel handle.         */
 CyU3PDmaChannel glSpiTxHandle;          // SPI Tx channel handle
 CyU3PDmaChannel glSpiRxHandle;          // SPI Rx channel handle
 
 CyBool_t glIsApplnActive = CyFalse;      /* Whether the loopback application is active or not. */
+volatile uint32_t glInZlpSent;          // Number of ZLPs committed to the IN endpoint
+volatile uint32_t glInZlpDone;          // Number of ZLPs taken by the host
 
-uint16_t    glSectorToWrite;            // Sector number to be WRITTEN
-uint16_t    glSectorToRead;             // Sector number to be READ
-uint16_t    glSizeToRead;               // Data size to be READ
+/* READ/WRITE request queued for the application thread.
+ * The size is four words to be sent through the SPI worker queue. */
+typedef struct CyFxBulkLpCmd_t
+{
+    uint8_t     request;                // Vendor request code
+    uint8_t     reserved;
+    uint16_t    nSectors;               // Number of sectors
+    uint32_t    address;                // First sector number or byte address
+    uint32_t    byteCount;              // Data size of each sector or of the byte range
+    uint32_t    time;                   // Time when the request was received
+} CyFxBulkLpCmd_t;
+
+#define CY_FX_CMD_WORDS         (sizeof (CyFxBulkLpCmd_t) / 4)
+
+/*
+ * The request queue is a single-producer/single-consumer ring without a lock.
+ * The USB setup callback is the only writer of glCmdHead and the application
+ * thread is the only writer of glCmdTail. A flush only moves glCmdDrop, which
+ * the thread catches up with when it takes the next request.
+ */
+CyFxBulkLpCmd_t glCmdQueue[CY_FX_CMD_QUEUE_DEPTH];  // Queue of the requests
+volatile uint32_t glCmdHead;            // Number of requests put in the queue
+volatile uint32_t glCmdTail;            // Number of requests taken from the queue
+volatile uint32_t glCmdDrop;            // Value of glCmdHead at the last flush
+volatile uint32_t glCmdDone;            // Number of requests served or discarded
+volatile uint32_t glCmdReconfig;        // Value of glCmdHead after the last SET_DMA_MODE or SET_BURST
+
+/* Keep the compiler from moving the memory accesses across the barrier.
+ * The ARM9 core runs the callback and the thread on a single CPU, so the
+ * program order is enough for the other context to see the accesses. */
+#define CY_FX_MEMORY_BARRIER()  __asm__ __volatile__ ("" : : : "memory")
 CyU3PEvent  glFramEvent;                // Event group used to signal the thread a READ/WRITE request.
+CyU3PQueue  glSpiQueue;                 // Requests passed to the SPI worker thread
+CyU3PEvent  glSpiEvent;                 // Event group used to signal the completion of a request by the SPI worker
+uint32_t    glSpiJobsSent;              // Number of requests passed to the SPI worker thread
+uint32_t    glSpiJobsDone;              // Number of requests completed by the SPI worker thread
+CyU3PMutex  glSpiLock;                  // Lock for the SPI shared by the threads and the setup callback
+uint8_t     *glAppStack;                // Stack of the application thread
+uint8_t     *glSpiStack;                // Stack of the SPI worker thread
 uint32_t    glPacketSize;               // Current packet size
+uint8_t     glBurstLength = CY_FX_EP_BURST_LENGTH;  // Burst length of the SuperSpeed endpoints
+uint8_t     glDmaMode = CY_FX_DMA_MODE_CPU;         // DMA mode of the FRAM READ/WRITE requests
+CyFxBulkLpSpiClock_t glSpiClock;                    // Current SPI clock setting
+CyFxBulkLpFramGeometry_t glFramGeometry;            // Geometry of the FRAM
+
+/* Sector cache entry. The data is stored from the top of the sector. */
+typedef struct CyFxBulkLpCacheEntry_t
+{
+    uint8_t     *buffer;                // Sector data allocated from the DMA buffer heap
+    uint16_t    sector;                 // Cached sector number
+    uint16_t    validCount;             // Number of valid bytes, 0 if the entry is empty
+    uint32_t    lastUse;                // Value of glCacheUse when the entry was used last
+} CyFxBulkLpCacheEntry_t;
+
+#if (CY_FX_SECTOR_CACHE_COUNT > 0)
+CyFxBulkLpCacheEntry_t glCache[CY_FX_SECTOR_CACHE_COUNT];  // Sector cache entries
+#else
+CyFxBulkLpCacheEntry_t glCache[1];
+#endif
+uint32_t    glCacheUse;                 // Use counter for the LRU replacement
+CyBool_t    glCacheEnabled = CyFalse;   // Whether the sector cache is used or not
+CyFxBulkLpCacheStats_t glCacheStats;    // Sector cache statistics
+
+uint8_t     *glCrcBuffer = NULL;        // DMA buffer used to read the FRAM data for the CRC
+CyBool_t    glVerifyWrite = CyFalse;    // Whether the written data is verified or not
+CyFxBulkLpCrcResult_t glCrcResult;      // Result of the CRC request and the verification
+CyFxBulkLpPerfStats_t glPerfStats;      // Performance counters of the FRAM transfer stages
+CyFxBulkLpPatternResult_t glPatternResult;  // Results of the test pattern requests
+CyFxBulkLpLoopStats_t glLoopStats;      // Throughput counters of the loopback modes
+
+/* State of the WRITE request advanced by the DMA callbacks. */
+typedef struct CyFxBulkLpCbWrite_t
+{
+    volatile CyBool_t isArmed;          // The request is advanced by the callbacks
+    volatile CyBool_t isSending;        // The SPI is held for a chunk, by the thread or a callback
+    volatile CyBool_t isSent;           // The chunk is sent, or was not sent, and waits for the thread
+    volatile CyBool_t isReady;          // A chunk was received while the SPI was held
+    CyBool_t    isOpen;                 // The WRITE transaction is started
+    CyBool_t    isVerify;               // The CRC32 of the written data is computed
+    uint32_t    byteAddress;            // FRAM address of the first byte
+    uint32_t    maxCount;               // Maximum number of bytes to be written
+    uint32_t    total;                  // Number of bytes written
+    uint32_t    crc;                    // CRC32 of the written data
+    uint8_t     *copy;                  // Buffer where a copy of the data is stored, or NULL
+    uint8_t     *buffer;                // Producer channel buffer of the chunk being sent
+    uint16_t    count;                  // Number of bytes of the chunk being sent
+    uint16_t    received;               // Number of bytes received in the chunk being sent
+    CyU3PReturnStatus_t sendStatus;     // Result of handing the chunk to the SPI
+    CyU3PReturnStatus_t status;         // Result of the request
+} CyFxBulkLpCbWrite_t;
+
+CyFxBulkLpCbWrite_t glCbWrite;          // WRITE request advanced by the DMA callbacks
+uint32_t    glLoopAutoBase;             // Byte count of the AUTO loopback channel when the counters are cleared
+
+#if (CY_FX_TRACE_ENABLE)
+CyFxBulkLpTrace_t glTrace __attribute__ ((aligned (32)));   // Trace ring sent to the host
+#define CY_FX_TRACE(id,a,b)     CyFxBulkLpTrace ((id), (uint32_t)(a), (uint32_t)(b))
+#else
+#define CY_FX_TRACE(id,a,b)
+#endif
+
+/* SPI clock candidates tried by the calibration in the ascending order */
+const uint32_t glSpiClockTable[] = {
+    CY_FX_SPI_CLOCK_MIN, 16000000, 20000000, 24000000, 30000000, CY_FX_SPI_CLOCK_MAX
+};
+
+CyFxBulkLpAppStats_t glAppStats;        // Application thread statistics
+
+/* Buffer used for the EP0 data stage. */
+uint8_t glEp0Buffer[CY_FX_EP0_BUF_SIZE] __attribute__ ((aligned (32)));
 
 /* Application Error Handler */
 void
@@ -82,6 +190,90 @@ CyFxAppErrorHandler (
     }
 }
 
+/*
+ * Account the time spent in a FRAM transfer stage
+ *
+ * Parameters
+ *
+ * uint8_t stage
+ *     The stage index, one of CY_FX_PERF_*.
+ * uint32_t start
+ *     The time when the stage was started.
+ * uint32_t byteCount
+ *     The number of bytes processed in the stage.
+ */
+void
+CyFxBulkLpPerfAdd (
+    uint8_t     stage,
+    uint32_t    start,
+    uint32_t    byteCount
+) {
+    CyFxBulkLpPerfStage_t *stage_p = &glPerfStats.stage[stage];
+    uint32_t elapsed = CyU3PGetTime () - start;
+
+    stage_p->ops++;
+    stage_p->bytes     += byteCount;
+    stage_p->timeTotal += elapsed;
+    if ((stage_p->ops == 1) || (elapsed < stage_p->timeMin)) {
+        stage_p->timeMin = elapsed;
+    }
+    if (elapsed > stage_p->timeMax) {
+        stage_p->timeMax = elapsed;
+    }
+}
+
+#if (CY_FX_TRACE_ENABLE)
+/*
+ * Record an event in the trace ring
+ *
+ * Only a few stores are made, and the ring is formatted by the host.
+ * The application thread and the SPI worker both record events, and the
+ * application thread preempts the worker. The ARM9 core has no atomic
+ * increment, so the entry is claimed and stored with the interrupts
+ * disabled; a preempting thread then takes the next entry.
+ */
+void
+CyFxBulkLpTrace (
+    uint16_t    id,
+    uint32_t    a,
+    uint32_t    b
+) {
+    CyFxBulkLpTraceEntry_t *entry_p;
+    uint32_t time = CyU3PGetTime ();
+    uint32_t intMask;
+
+    intMask = CyU3PVicDisableAllInterrupts ();
+    entry_p = &glTrace.entry[glTrace.count & (CY_FX_TRACE_DEPTH - 1)];
+    entry_p->time = time;
+    entry_p->id   = id;
+    entry_p->a    = a;
+    entry_p->b    = b;
+    glTrace.count++;
+    CyU3PVicEnableInterrupts (intMask);
+}
+#endif
+
+/*
+ * Get the high-water mark of a thread stack
+ *
+ * The stack is filled with CY_FX_STACK_FILL before the thread is
+ * created. It grows down, so the words at its start which still hold
+ * the fill have never been used.
+ */
+uint32_t
+CyFxBulkLpStackUsed (
+    const uint8_t   *stack,
+    uint32_t        size
+) {
+    const uint32_t *word_p = (const uint32_t *)stack;
+    uint32_t unused = 0;
+
+    while ((unused < size) && (*word_p++ == CY_FX_STACK_FILL * 0x01010101U)) {
+        unused += 4;
+    }
+    return size - unused;
+}
+
 /* This function initializes the debug module. The debug prints
  * are routed to the UART and can be seen using a UART console
  * running at 115200 baud rate. */
@@ -130,27 +322,42 @@ CyFxBulkLpApplnDebugInit (void)
     }
 }
 
+CyU3PReturnStatus_t CyFxBulkLpSpiDmaCreate (void);
+void CyFxBulkLpSpiDmaCb (CyU3PDmaChannel *chHandle, CyU3PDmaCbType_t type, CyU3PDmaCBInput_t *input);
+void CyFxBulkLpApplnStart (void);
+void CyFxBulkLpApplnStop (void);
+void CyFxBulkLpApplnTeardown (void);
+
 /*
- * SPI initialization for FRAM programmer application.
+ * Set the SPI clock and the READ command
+ *
+ * Parameters
+ *
+ * uint32_t clock
+ *     The SPI clock in Hz, CY_FX_SPI_CLOCK_MIN to CY_FX_SPI_CLOCK_MAX.
+ * CyBool_t fastRead
+ *     CyTrue to use the FAST_READ command with a dummy byte.
+ *
+ * The SPI block must be idle when this function is called. When the
+ * configuration fails, the previous clock is configured again and
+ * glSpiClock is not changed.
  */
 CyU3PReturnStatus_t
-CyFxBulkLpSpiInit (void)
-{
+CyFxBulkLpSpiSetClock (
+    uint32_t    clock,
+    CyBool_t    fastRead
+) {
     CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
     CyU3PSpiConfig_t spiConfig;
-    CyU3PDmaChannelConfig_t dmaConfig;
 
-    /* Start the SPI module and configure the master. */
-    status = CyU3PSpiInit();
-    if (status != CY_U3P_SUCCESS)
-    {
-        return status;
+    if ((clock < CY_FX_SPI_CLOCK_MIN) || (clock > CY_FX_SPI_CLOCK_MAX)) {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
     }
 
     /*
-     * Start the SPI master block. Run the SPI clock at 24MHz
-     * and configure the word length to 8 bits. Also configure
-     * the slave select using the firmware.
+     * Configure the SPI master block with the specified clock
+     * and the word length of 8 bits. Also configure the slave
+     * select using the firmware.
      */
     CyU3PMemSet ((uint8_t *)&spiConfig, 0, sizeof(spiConfig));
     spiConfig.isLsbFirst = CyFalse;
@@ -160,18 +367,136 @@ CyFxBulkLpSpiInit (void)
     spiConfig.leadTime   = CY_U3P_SPI_SSN_LAG_LEAD_HALF_CLK;
     spiConfig.lagTime    = CY_U3P_SPI_SSN_LAG_LEAD_HALF_CLK;
     spiConfig.ssnCtrl    = CY_U3P_SPI_SSN_CTRL_FW;
-    spiConfig.clock      = 24000000;
+    spiConfig.clock      = clock;
     spiConfig.wordLen    = 8;
 
     status = CyU3PSpiSetConfig (&spiConfig, NULL);
     if (status != CY_U3P_SUCCESS)
+    {
+        /*
+         * Put the previous clock back, so that the SPI block keeps
+         * matching glSpiClock.
+         */
+        if (glSpiClock.clock != 0) {
+            spiConfig.clock = glSpiClock.clock;
+            CyU3PSpiSetConfig (&spiConfig, NULL);
+        }
+        return status;
+    }
+
+    glSpiClock.clock      = clock;
+    glSpiClock.fastRead   = (fastRead) ? 1 : 0;
+    glSpiClock.calibrated = 0;
+
+    return CY_U3P_SUCCESS;
+}
+
+/*
+ * Identify the SPI FRAM and set up its geometry
+ *
+ * The RDID command is sent and the density code in the response is
+ * decoded for the Fujitsu (0x04, 0x7F, ...) and the Cypress
+ * (0x7F x 6, 0xC2, ...) parts. The address width follows from the
+ * capacity. A 2Mbit FRAM is assumed when the part is not identified.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramIdentify (
+    void
+) {
+    uint8_t rdid[1] = {0x9F};  // RDID command
+    uint8_t *id = glFramGeometry.deviceId;
+    uint32_t unit = 0;
+    uint8_t density = 0;
+    uint32_t capacity = CY_FX_FRAM_DEFAULT_SIZE;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    CyU3PMemSet ((uint8_t *)&glFramGeometry, 0, sizeof (glFramGeometry));
+
+    CyU3PSpiSetSsnLine (CyFalse);
+    status = CyU3PSpiTransmitWords (rdid, 1);
+    if (status == CY_U3P_SUCCESS) {
+        status = CyU3PSpiReceiveWords (id, sizeof (glFramGeometry.deviceId));
+    }
+    CyU3PSpiSetSsnLine (CyTrue);
+    if (status != CY_U3P_SUCCESS) {
+        return status;
+    }
+
+    if ((id[0] == 0x04) && (id[1] == 0x7F)) {
+        /* Fujitsu: density 0x05 is 256Kbit. */
+        unit    = 1024;
+        density = id[2] & 0x1F;
+    } else if ((id[0] == 0x7F) && (id[5] == 0x7F) && (id[6] == 0xC2)) {
+        /* Cypress: density 0x01 is 128Kbit. */
+        unit    = 8192;
+        density = id[7] & 0x1F;
+    }
+
+    if ((unit != 0) && (((CY_FX_FRAM_MAX_SIZE / unit) >> density) != 0)) {
+        capacity = unit << density;
+        glFramGeometry.identified = 1;
+    }
+
+    glFramGeometry.capacity     = capacity;
+    glFramGeometry.sectorSize   = CY_FX_SECTOR_SIZE;
+    glFramGeometry.nSectors     = (capacity - CY_FX_FRAM_SCRATCH_SIZE) / CY_FX_SECTOR_SIZE;
+    glFramGeometry.addressBytes = (capacity <= 0x10000UL) ? 2 : (capacity <= 0x1000000UL) ? 3 : 4;
+
+    CyU3PDebugPrint (4, "SPI FRAM - capacity: %d, sectors: %d, address bytes: %d\r\n",
+            capacity, glFramGeometry.nSectors, glFramGeometry.addressBytes);
+    return CY_U3P_SUCCESS;
+}
+
+/*
+ * SPI initialization for FRAM programmer application.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpSpiInit (void)
+{
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    /* Start the SPI module and configure the master. */
+    status = CyU3PSpiInit();
+    if (status != CY_U3P_SUCCESS)
+    {
+        return status;
+    }
+
+    /*
+     * Start the SPI master block with the default clock.
+     * The clock is raised later by CyFxBulkLpSpiCalibrate.
+     */
+    status = CyFxBulkLpSpiSetClock (CY_FX_SPI_CLOCK_DEFAULT, CyFalse);
+    if (status != CY_U3P_SUCCESS)
+    {
+        return status;
+    }
+
+    /* Discover the capacity and the address width of the FRAM. */
+    status = CyFxBulkLpFramIdentify ();
+    if (status != CY_U3P_SUCCESS)
     {
         return status;
     }
 
     /* Create the DMA channels for SPI write and read. */
+    return CyFxBulkLpSpiDmaCreate ();
+}
+
+/*
+ * Create the DMA channels between the CPU and the SPI block
+ *
+ * These channels are used in the override mode to transfer data between
+ * the DMA buffers of the USB channels and the SPI FRAM.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpSpiDmaCreate (void)
+{
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+    CyU3PDmaChannelConfig_t dmaConfig;
+
     CyU3PMemSet ((uint8_t *)&dmaConfig, 0, sizeof(dmaConfig));
-    dmaConfig.size           = CY_FX_BULKLP_DMA_BUF_SIZE;
+    dmaConfig.size           = CY_FX_BULKLP_DMA_CHUNK_SIZE;
     /* No buffers need to be allocated as this channel
      * will be used only in override mode. */
     dmaConfig.count          = 0;
@@ -183,7 +508,12 @@ CyFxBulkLpSpiInit (void)
     dmaConfig.notification   = 0;
     dmaConfig.cb             = NULL;
 
-    /* Channel to write to SPI flash. */
+    /* Channel to write to SPI flash.
+     * The completion of a chunk advances a callback driven WRITE. */
+    if (glDmaMode == CY_FX_DMA_MODE_CALLBACK) {
+        dmaConfig.notification = CY_U3P_DMA_CB_SEND_CPLT;
+        dmaConfig.cb           = CyFxBulkLpSpiDmaCb;
+    }
     dmaConfig.prodSckId = CY_U3P_CPU_SOCKET_PROD;
     dmaConfig.consSckId = CY_U3P_LPP_SOCKET_SPI_CONS;
     status = CyU3PDmaChannelCreate (&glSpiTxHandle,
@@ -194,6 +524,8 @@ CyFxBulkLpSpiInit (void)
     }
 
     /* Channel to read from SPI flash. */
+    dmaConfig.notification = 0;
+    dmaConfig.cb           = NULL;
     dmaConfig.prodSckId = CY_U3P_LPP_SOCKET_SPI_PROD;
     dmaConfig.consSckId = CY_U3P_CPU_SOCKET_CONS;
     status = CyU3PDmaChannelCreate (&glSpiRxHandle,
@@ -203,67 +535,97 @@ CyFxBulkLpSpiInit (void)
 }
 
 /*
- * Read a data from a specified sector
+ * Prepare a command with an address for the SPI FRAM
  *
  * Parameters
  *
- * uint16_t sector
- *     The sector number where the data to be read is located.
- *     The maximum number is specified in the header file.
- *     No sector number validation is implemented in this function.
- * uint8_t *buffer
- *     Buffer address where the read data is to be stored.
- *     The buffer should be a 32 byte aligned address because the
- *     value is directly used for the DMA channel buffer.
- * uint16_t byteCount
- *     The number of bytes to be read from the SPI FRAM.
- *     The maximum byte count is specified in the header file.
+ * uint8_t *command
+ *     Buffer where the command is stored. At least 5 bytes are required.
+ * uint8_t opcode
+ *     The command code.
+ * uint32_t byteAddress
+ *     The FRAM address.
  *
+ * Returns the length of the command. The address is sent in
+ * glFramGeometry.addressBytes bytes, MS byte first.
  */
-CyU3PReturnStatus_t
-CyFxBulkLpFramRead (
-    uint16_t    sector,
-    uint8_t     *buffer,
-    uint16_t    byteCount
+uint8_t
+CyFxBulkLpFramCommand (
+    uint8_t     *command,
+    uint8_t     opcode,
+    uint32_t    byteAddress
 ) {
-    CyU3PDmaBuffer_t inBuf_p;
-    uint8_t location[4];
-    uint32_t byteAddress = 0;
-    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+    uint8_t i;
+    uint8_t length = glFramGeometry.addressBytes;
 
-    /*
-     * Do nothing if 0 Byte data is required.
-     */
-    if (byteCount == 0) {
-        return CY_U3P_SUCCESS;
+    command[0] = opcode;
+    for (i = length; i > 0; i--) {
+        command[i] = byteAddress & 0xFF;
+        byteAddress >>= 8;
     }
+    return length + 1;
+}
 
-    /*
-     * Calculate the address of the sector on the SPI FRAM
-     * The address is calculated by the sector size specified
-     * in the header file.
-     */
-    byteAddress  = CY_FX_SECTOR_SIZE * sector;
-    CyU3PDebugPrint (2, "SPI FRAM read - addr: 0x%x, size: 0x%x.\r\n",
-            byteAddress, byteCount);
+/*
+ * Prepare a READ command for the SPI FRAM
+ *
+ * Parameters
+ *
+ * uint8_t *command
+ *     Buffer where the command is stored. At least 6 bytes are required.
+ * uint32_t byteAddress
+ *     The FRAM address where the data to be read is located.
+ *
+ * Returns the length of the command. A command code and the address
+ * are provided as preamble, followed by a dummy byte when the
+ * FAST_READ command is used.
+ */
+uint8_t
+CyFxBulkLpFramReadCommand (
+    uint8_t     *command,
+    uint32_t    byteAddress
+) {
+    uint8_t length;
 
-    /*
-     * Prepare READ command for SPI FRAM
-     * A command code and three byte address are provided as preamble.
-     */
-    location[0] = 0x03; /* Read command. */
-    location[1] = (byteAddress >> 16) & 0xFF;       /* MS byte */
-    location[2] = (byteAddress >> 8) & 0xFF;
-    location[3] = byteAddress & 0xFF;               /* LS byte */
+    if (glSpiClock.fastRead) {
+        length = CyFxBulkLpFramCommand (command, 0x0B, byteAddress);    /* FAST_READ command */
+        command[length] = 0x00;                                         /* Dummy byte */
+        return length + 1;
+    }
+    return CyFxBulkLpFramCommand (command, 0x03, byteAddress);          /* READ command */
+}
+
+/*
+ * Begin a READ transaction on the SPI FRAM
+ *
+ * Parameters
+ *
+ * uint32_t byteAddress
+ *     The FRAM address where the data to be read is located.
+ * uint32_t byteCount
+ *     The total number of bytes to be read in this transaction.
+ *
+ * The READ command is sent and the SPI block is prepared to read
+ * byteCount bytes. The data is received by one or more calls of
+ * CyFxBulkLpFramReadData, and the transaction is closed by
+ * CyFxBulkLpFramReadEnd.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramReadBegin (
+    uint32_t    byteAddress,
+    uint32_t    byteCount
+) {
+    uint8_t location[6];
+    uint8_t length;
+    uint32_t start = CyU3PGetTime ();
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    CY_FX_TRACE (CY_FX_TRACE_FRAM_READ, byteAddress, byteCount);
 
     /*
-     * Prepare DMA buffer descriptor for the SPI FRAM
-     * Both size and count field have the size of the DMA buffer.
+     * Prepare READ command for SPI FRAM
      */
-    inBuf_p.buffer = buffer;
-    inBuf_p.status = 0;
-    inBuf_p.size   = CY_FX_BULKLP_DMA_BUF_SIZE;
-    inBuf_p.count  = CY_FX_BULKLP_DMA_BUF_SIZE;
+    length = CyFxBulkLpFramReadCommand (location, byteAddress);
 
     /*
      * Assert Slave Select output
@@ -274,7 +636,7 @@ CyFxBulkLpFramRead (
     /*
      * Send a READ command to the SPI FRAM
      */
-    status = CyU3PSpiTransmitWords (location, 4);
+    status = CyU3PSpiTransmitWords (location, length);
     if (status != CY_U3P_SUCCESS)
     {
         CyU3PDebugPrint (2, "SPI READ command failed\r\n");
@@ -290,6 +652,49 @@ CyFxBulkLpFramRead (
      */
     CyU3PSpiSetBlockXfer (0, byteCount);
 
+    CyFxBulkLpPerfAdd (CY_FX_PERF_SPI_CMD, start, 0);
+    return CY_U3P_SUCCESS;
+}
+
+/*
+ * Read a data block in the current READ transaction
+ *
+ * Parameters
+ *
+ * uint8_t *buffer
+ *     Buffer address where the read data is to be stored.
+ *     The buffer should be a 32 byte aligned address because the
+ *     value is directly used for the DMA channel buffer.
+ * uint16_t byteCount
+ *     The number of bytes to be read from the SPI FRAM.
+ *     A block smaller than CY_FX_BULKLP_DMA_CHUNK_SIZE is allowed
+ *     only as the last block of the transaction.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramReadData (
+    uint8_t     *buffer,
+    uint16_t    byteCount
+) {
+    CyU3PDmaBuffer_t inBuf_p;
+    uint32_t start;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    /*
+     * Do nothing if 0 Byte data is required.
+     */
+    if (byteCount == 0) {
+        return CY_U3P_SUCCESS;
+    }
+
+    /*
+     * Prepare DMA buffer descriptor for the SPI FRAM
+     * Both size and count field have the size of the DMA buffer.
+     */
+    inBuf_p.buffer = buffer;
+    inBuf_p.status = 0;
+    inBuf_p.size   = CY_FX_BULKLP_DMA_CHUNK_SIZE;
+    inBuf_p.count  = CY_FX_BULKLP_DMA_CHUNK_SIZE;
+
     /*
      * Connect the DMA buffer to DMA Channel
      * The DMA buffer descriptor is provided to the DMA Channel
@@ -298,192 +703,2294 @@ CyFxBulkLpFramRead (
     status = CyU3PDmaChannelSetupRecvBuffer (&glSpiRxHandle,  &inBuf_p);
     if (status != CY_U3P_SUCCESS)
     {
-        CyU3PSpiSetSsnLine (CyTrue);
         return status;
     }
 
+    if (byteCount == CY_FX_BULKLP_DMA_CHUNK_SIZE)
+    {
+        /*
+         * Wait for the DMA Channel completed
+         * This API returns when the DMA buffer is filled.
+         */
+        start = CyU3PGetTime ();
+        status = CyU3PDmaChannelWaitForCompletion (&glSpiRxHandle,
+                CY_FX_FRAM_TIMEOUT);
+        CyFxBulkLpPerfAdd (CY_FX_PERF_DMA_WAIT, start, byteCount);
+    }
+    else
+    {
+        /*
+         * Wait for the SPI block transfer completed
+         * This API returns when the SCK pulses are generated
+         * to get the data from the SPI FRAM.
+         */
+        start = CyU3PGetTime ();
+        status = CyU3PSpiWaitForBlockXfer(CyTrue);
+        CyFxBulkLpPerfAdd (CY_FX_PERF_SPI_WAIT, start, byteCount);
+        if (status != CY_U3P_SUCCESS)
+        {
+            return status;
+        }
+
+        /*
+         * Finalize the DMA channel to disconnect from SPI
+         * This API finished the DMA channel transfer whenever the DMA
+         * buffer is not full.
+         */
+        status = CyU3PDmaChannelSetWrapUp(&glSpiRxHandle);
+    }
+
+    return status;
+}
+
+/*
+ * End the current READ transaction
+ */
+void
+CyFxBulkLpFramReadEnd (
+    void
+) {
     /*
-     * Wait for the SPI block transfer completed
-     * This API returns when the SCK pulses are generated
-     * to get the data from the SPI FRAM.
+     * Negate Slave Select output
+     * This indicates the end of SPI transfer.
      */
-    status = CyU3PSpiWaitForBlockXfer(CyTrue);
-    if (status != CY_U3P_SUCCESS)
-    {
+    CyU3PSpiSetSsnLine (CyTrue);
+
+    /*
+     * Stop Block Transfer of SPI
+     * Disable the block transfer mode of SPI to disconnect
+     * from the DMA channel.
+     */
+    CyU3PSpiDisableBlockXfer (CyFalse, CyTrue);
+}
+
+/*
+ * Compute the CRC32 of a byte range of the SPI FRAM
+ *
+ * Parameters
+ *
+ * uint32_t byteAddress
+ *     The FRAM address where the data is located.
+ * uint32_t byteCount
+ *     The number of bytes.
+ * uint32_t *crc
+ *     Returns the CRC32 of the data.
+ *
+ * The data is read into glCrcBuffer in CY_FX_BULKLP_DMA_CHUNK_SIZE
+ * chunks through glSpiRxHandle, and nothing is sent to the host. In the
+ * direct mode the SPI sockets are used by the AUTO channels, so the data
+ * is read in the register mode.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramCrc (
+    uint32_t    byteAddress,
+    uint32_t    byteCount,
+    uint32_t    *crc
+) {
+    uint8_t location[6];
+    uint8_t length;
+    uint32_t remain = byteCount;
+    uint16_t count;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    *crc = 0;
+    if (byteCount == 0) {
+        return CY_U3P_SUCCESS;
+    }
+
+    if (glDmaMode == CY_FX_DMA_MODE_DIRECT) {
+        length = CyFxBulkLpFramReadCommand (location, byteAddress);
+        CyU3PSpiSetSsnLine (CyFalse);
+        status = CyU3PSpiTransmitWords (location, length);
+        while ((status == CY_U3P_SUCCESS) && (remain > 0)) {
+            count = (remain > CY_FX_BULKLP_DMA_CHUNK_SIZE) ? CY_FX_BULKLP_DMA_CHUNK_SIZE : remain;
+            status = CyU3PSpiReceiveWords (glCrcBuffer, count);
+            *crc = CyFxBulkLpCrcUpdate (*crc, glCrcBuffer, count);
+            remain -= count;
+        }
         CyU3PSpiSetSsnLine (CyTrue);
         return status;
     }
 
-    /*
-     * Finalize the DMA channel to disconnect from SPI
-     * This API finished the DMA channel transfer whenever the DMA
-     * buffer is not full.
-     */
-    status = CyU3PDmaChannelSetWrapUp(&glSpiRxHandle);
-    if (status != CY_U3P_SUCCESS)
-    {
-        CyU3PSpiSetSsnLine (CyTrue);
-        return status;
+    status = CyFxBulkLpFramReadBegin (byteAddress, byteCount);
+    if (status != CY_U3P_SUCCESS) {
+        return status;
+    }
+
+    while (remain > 0) {
+        count = (remain > CY_FX_BULKLP_DMA_CHUNK_SIZE) ? CY_FX_BULKLP_DMA_CHUNK_SIZE : remain;
+        status = CyFxBulkLpFramReadData (glCrcBuffer, count);
+        if (status != CY_U3P_SUCCESS) {
+            break;
+        }
+        *crc = CyFxBulkLpCrcUpdate (*crc, glCrcBuffer, count);
+        remain -= count;
+    }
+
+    CyFxBulkLpFramReadEnd ();
+
+    return status;
+}
+
+/*
+ * Verify the written data with the CRC32 of the readback
+ *
+ * A mismatch is counted in glCrcResult.verifyErrors and does not
+ * stop the application.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramVerify (
+    uint32_t    byteAddress,
+    uint32_t    byteCount,
+    uint32_t    crc
+) {
+    uint32_t readCrc;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    status = CyFxBulkLpFramCrc (byteAddress, byteCount, &readCrc);
+    if (status != CY_U3P_SUCCESS) {
+        return status;
+    }
+
+    glCrcResult.verifyCount++;
+    if (readCrc != crc) {
+        glCrcResult.verifyErrors++;
+        CyU3PDebugPrint (4, "SPI FRAM verify failed - addr: 0x%x, size: 0x%x.\r\n",
+                byteAddress, byteCount);
+    }
+    return CY_U3P_SUCCESS;
+}
+
+/*
+ * Read data from the SPI FRAM and send it to the IN endpoint
+ *
+ * Parameters
+ *
+ * uint32_t byteAddress
+ *     The FRAM address where the data to be read is located.
+ * uint32_t byteCount
+ *     The number of bytes to be read from the SPI FRAM.
+ * uint8_t *copy
+ *     Buffer where a copy of the read data is stored, or NULL.
+ *
+ * The data is read in CY_FX_BULKLP_DMA_CHUNK_SIZE chunks in a single
+ * READ transaction. Each chunk is committed to the consumer channel as
+ * soon as it is read, so the host receives the first chunk while the
+ * rest of the data is still read from the SPI FRAM. No ZLP is sent by
+ * this function.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramReadPipe (
+    uint32_t    byteAddress,
+    uint32_t    byteCount,
+    uint8_t     *copy
+) {
+    CyU3PDmaBuffer_t outBuf_p;
+    uint32_t remain = byteCount;
+    uint16_t count;
+    uint32_t start;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    /*
+     * Do nothing if 0 Byte data is required.
+     */
+    if (byteCount == 0) {
+        return CY_U3P_SUCCESS;
+    }
+
+    status = CyFxBulkLpFramReadBegin (byteAddress, byteCount);
+    if (status != CY_U3P_SUCCESS) {
+        return status;
+    }
+
+    while (remain > 0) {
+        count = (remain > CY_FX_BULKLP_DMA_CHUNK_SIZE) ? CY_FX_BULKLP_DMA_CHUNK_SIZE : remain;
+
+        /*
+         * Wait for a free buffer to be used to transmit the read data.
+         */
+        start = CyU3PGetTime ();
+        status = CyU3PDmaChannelGetBuffer (&glChHandleBulkLpOut, &outBuf_p, CYU3P_WAIT_FOREVER);
+        CyFxBulkLpPerfAdd (CY_FX_PERF_GET_BUFFER, start, 0);
+        if (status != CY_U3P_SUCCESS) {
+            break;
+        }
+
+        status = CyFxBulkLpFramReadData (outBuf_p.buffer, count);
+        if (status != CY_U3P_SUCCESS) {
+            break;
+        }
+        if (copy != NULL) {
+            CyU3PMemCopy (copy + (byteCount - remain), outBuf_p.buffer, count);
+        }
+
+        /*
+         * Commit the read data to the consumer pipe so that the data can be
+         * transmitted to the USB host while the next chunk is read.
+         */
+        start = CyU3PGetTime ();
+        status = CyU3PDmaChannelCommitBuffer (&glChHandleBulkLpOut, count, 0);
+        CyFxBulkLpPerfAdd (CY_FX_PERF_COMMIT, start, count);
+        if (status != CY_U3P_SUCCESS) {
+            break;
+        }
+        remain -= count;
+    }
+
+    CyFxBulkLpFramReadEnd ();
+
+    return status;
+}
+
+/*
+ * Send a ZLP to the IN endpoint
+ *
+ * A ZLP is required to terminate a transfer when the size of data
+ * is a multiple of the packet size.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpSendZlp (
+    void
+) {
+    CyU3PDmaBuffer_t outBuf_p;
+    uint32_t start = CyU3PGetTime ();
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    status = CyU3PDmaChannelGetBuffer (&glChHandleBulkLpOut, &outBuf_p, CYU3P_WAIT_FOREVER);
+    if (status == CY_U3P_SUCCESS) {
+        status = CyU3PDmaChannelCommitBuffer (&glChHandleBulkLpOut, 0, 0);
+    }
+    if (status == CY_U3P_SUCCESS) {
+        glInZlpSent++;
+    }
+
+    CyFxBulkLpPerfAdd (CY_FX_PERF_ZLP, start, 0);
+    return status;
+}
+
+/*
+ * Receive the ZLP which ends a transfer from the OUT endpoint
+ *
+ * In the CPU DMA modes a transfer of a multiple of the packet size is
+ * ended by a ZLP. When the last chunk is full, the ZLP arrives in a
+ * buffer of its own after the data, and is taken here so that it does
+ * not end the next transfer. A buffer with data is left in the channel
+ * for the next request.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpRecvZlp (
+    void
+) {
+    CyU3PDmaBuffer_t inBuf_p;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    status = CyU3PDmaChannelGetBuffer (&glChHandleBulkLpIn, &inBuf_p, CY_FX_ZLP_TIMEOUT);
+    if ((status == CY_U3P_SUCCESS) && (inBuf_p.count == 0)) {
+        status = CyU3PDmaChannelDiscardBuffer (&glChHandleBulkLpIn);
+    }
+    return status;
+}
+
+/*
+ * Send the WREN command to enable WRITE operations
+ *
+ * WREN command should be issued prior the WRITE command in a
+ * separate transaction, so it is sent in the register mode.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramWriteEnable (
+    void
+) {
+    uint8_t wren[1] = {0x06};  // WREN command
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    CyU3PSpiSetSsnLine (CyFalse);
+    status = CyU3PSpiTransmitWords (wren, 1);
+    CyU3PSpiSetSsnLine (CyTrue);
+    if (status != CY_U3P_SUCCESS)
+    {
+        CyU3PDebugPrint (2, "FRAM WREN command failed\n\r");
+    }
+    return status;
+}
+
+/*
+ * Begin a WRITE transaction on the SPI FRAM
+ *
+ * Parameters
+ *
+ * uint32_t byteAddress
+ *     The FRAM address where the data is to be written.
+ *
+ * The WREN and WRITE commands are sent and the Slave Select is left
+ * asserted, so that any number of data blocks can follow by calling
+ * CyFxBulkLpFramWriteData. The transaction is closed by
+ * CyFxBulkLpFramWriteEnd.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramWriteBegin (
+    uint32_t    byteAddress
+) {
+    uint8_t location[5];
+    uint8_t length;
+    uint32_t start = CyU3PGetTime ();
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    /*
+     * Prepare WRITE command for SPI FRAM
+     * A command code and the address are provided as preamble.
+     */
+    length = CyFxBulkLpFramCommand (location, 0x02, byteAddress);   /* Write command */
+
+    status = CyFxBulkLpFramWriteEnable ();
+    if (status != CY_U3P_SUCCESS)
+    {
+        return status;
+    }
+
+    /*
+     * Assert Slave Select output
+     * A SPI transfer begins.
+     */
+    CyU3PSpiSetSsnLine (CyFalse);
+
+    /*
+     * Send a WRITE command to the SPI FRAM
+     */
+    status = CyU3PSpiTransmitWords (location, length);
+    if (status != CY_U3P_SUCCESS)
+    {
+        CyU3PDebugPrint (2, "SPI WRITE command failed\r\n");
+        CyU3PSpiSetSsnLine (CyTrue);
+        return status;
+    }
+
+    CyFxBulkLpPerfAdd (CY_FX_PERF_SPI_CMD, start, 0);
+    return CY_U3P_SUCCESS;
+}
+
+/*
+ * Begin a WRITE transaction with the command in front of the first data block
+ *
+ * Parameters
+ *
+ * uint32_t byteAddress
+ *     The FRAM address where the data is to be written.
+ * uint8_t *buffer
+ *     Buffer of the first data block with CY_FX_FRAM_HEADER_SIZE free
+ *     bytes in front of it.
+ * uint8_t *length
+ *     Returns the number of command bytes stored in front of the buffer.
+ *
+ * The WRITE command and the address are stored right in front of the
+ * data, so the first call of CyFxBulkLpFramWriteData with the buffer
+ * moved back by length bytes sends the command and the data in one DMA
+ * transfer. The DMA has to start on a word boundary, so a command which
+ * is not a word long is sent by CyFxBulkLpFramWriteBegin and length is 0.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramWriteBeginHeader (
+    uint32_t    byteAddress,
+    uint8_t     *buffer,
+    uint8_t     *length
+) {
+    uint8_t location[5];
+    uint32_t start = CyU3PGetTime ();
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    *length = 0;
+    if ((glFramGeometry.addressBytes + 1) % 4 != 0) {
+        return CyFxBulkLpFramWriteBegin (byteAddress);
+    }
+
+    status = CyFxBulkLpFramWriteEnable ();
+    if (status != CY_U3P_SUCCESS)
+    {
+        return status;
+    }
+
+    *length = CyFxBulkLpFramCommand (location, 0x02, byteAddress);  /* Write command */
+    CyU3PMemCopy (buffer - *length, location, *length);
+
+    /*
+     * Assert Slave Select output
+     * The SPI transfer begins with the DMA of the first block.
+     */
+    CyU3PSpiSetSsnLine (CyFalse);
+
+    CyFxBulkLpPerfAdd (CY_FX_PERF_SPI_CMD, start, 0);
+    return CY_U3P_SUCCESS;
+}
+
+/*
+ * Write a data block in the current WRITE transaction
+ *
+ * Parameters
+ *
+ * uint8_t *buffer
+ *     Buffer address where the data to be written is stored.
+ *     The buffer should be a 32 byte aligned address because the
+ *     value is directly used for the DMA channel buffer, or the
+ *     command stored by CyFxBulkLpFramWriteBeginHeader in front of it.
+ * uint16_t byteCount
+ *     The number of bytes to be written to the SPI FRAM, including
+ *     the command in front of the buffer.
+ *
+ * The Slave Select is kept asserted, so the data is written
+ * right after the data of the previous block.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramWriteData (
+    uint8_t     *buffer,
+    uint16_t    byteCount
+) {
+    CyU3PDmaBuffer_t outBuf_p;
+    uint32_t start;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    /*
+     * Do nothing if 0 Byte data is required
+     */
+    if (byteCount == 0) {
+        return CY_U3P_SUCCESS;
+    }
+
+    /*
+     * Prepare DMA buffer descriptor for the SPI FRAM
+     * The size field have the size of the DMA buffer.
+     * The count field has the byte count to be written.
+     */
+    outBuf_p.buffer = buffer;
+    outBuf_p.status = 0;
+    outBuf_p.size   = CY_FX_BULKLP_DMA_CHUNK_SIZE + CY_FX_FRAM_HEADER_SIZE;
+    outBuf_p.count  = byteCount;
+
+    /*
+     * Prepare SPI transfer for WRITE
+     * This API specifies how many words will be written to the SPI.
+     * In the other words, this specifies the number of SCK pulses
+     * to be generated.
+     */
+    CyU3PSpiSetBlockXfer (byteCount, 0);
+
+    /*
+     * Connect the DMA buffer to DMA Channel
+     * The DMA buffer descriptor is provided to the DMA Channel
+     * to write the data to the SPI FRAM.
+     */
+    status = CyU3PDmaChannelSetupSendBuffer (&glSpiTxHandle, &outBuf_p);
+    if (status == CY_U3P_SUCCESS)
+    {
+        /*
+         * Wait for the DMA Channel completed
+         * This API returns when all data stored in the DMA buffer are sent.
+         */
+        start = CyU3PGetTime ();
+        status = CyU3PDmaChannelWaitForCompletion(&glSpiTxHandle,
+                CY_FX_FRAM_TIMEOUT);
+        CyFxBulkLpPerfAdd (CY_FX_PERF_DMA_WAIT, start, byteCount);
+    }
+    if (status == CY_U3P_SUCCESS)
+    {
+        /*
+         * Wait for the SPI block transfer completed
+         * This API returns when the last word is shifted out.
+         */
+        start = CyU3PGetTime ();
+        status = CyU3PSpiWaitForBlockXfer (CyFalse);
+        CyFxBulkLpPerfAdd (CY_FX_PERF_SPI_WAIT, start, 0);
+    }
+
+    /*
+     * Stop Block Transfer of SPI
+     * Disable the block transfer mode of SPI to disconnect
+     * from the DMA channel.
+     */
+    CyU3PSpiDisableBlockXfer (CyTrue, CyFalse);
+
+    return status;
+}
+
+/*
+ * End the current WRITE transaction
+ */
+void
+CyFxBulkLpFramWriteEnd (
+    void
+) {
+    /*
+     * Negate Slave Select output
+     * This indicates the end of SPI transfer.
+     */
+    CyU3PSpiSetSsnLine (CyTrue);
+}
+
+/*
+ * Write a small record to the SPI FRAM in the register mode
+ *
+ * Parameters
+ *
+ * uint32_t byteAddress
+ *     The FRAM address where the data is to be written.
+ * uint8_t *buffer
+ *     The data to be written.
+ * uint16_t byteCount
+ *     The number of bytes to be written.
+ *
+ * No DMA channel is used, so the function works in all the DMA modes.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramWriteRegister (
+    uint32_t    byteAddress,
+    uint8_t     *buffer,
+    uint16_t    byteCount
+) {
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    status = CyFxBulkLpFramWriteBegin (byteAddress);
+    if (status != CY_U3P_SUCCESS) {
+        return status;
+    }
+    status = CyU3PSpiTransmitWords (buffer, byteCount);
+    CyFxBulkLpFramWriteEnd ();
+    return status;
+}
+
+/*
+ * Read a small record from the SPI FRAM in the register mode
+ *
+ * Parameters
+ *
+ * uint32_t byteAddress
+ *     The FRAM address where the data to be read is located.
+ * uint8_t *buffer
+ *     Buffer where the read data is stored.
+ * uint16_t byteCount
+ *     The number of bytes to be read.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramReadRegister (
+    uint32_t    byteAddress,
+    uint8_t     *buffer,
+    uint16_t    byteCount
+) {
+    uint8_t location[6];
+    uint8_t length;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    length = CyFxBulkLpFramReadCommand (location, byteAddress);
+    CyU3PSpiSetSsnLine (CyFalse);
+    status = CyU3PSpiTransmitWords (location, length);
+    if (status == CY_U3P_SUCCESS) {
+        status = CyU3PSpiReceiveWords (buffer, byteCount);
+    }
+    CyU3PSpiSetSsnLine (CyTrue);
+    return status;
+}
+
+/*
+ * Verify the SPI FRAM access with the current SPI clock setting
+ *
+ * Parameters
+ *
+ * uint8_t seed
+ *     The first byte of the test pattern.
+ *
+ * A test pattern is written to the scratch area and read back in the
+ * register mode. Returns CY_U3P_SUCCESS only when the data matches.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpSpiVerify (
+    uint8_t     seed
+) {
+    uint8_t pattern[CY_FX_FRAM_SCRATCH_SIZE];
+    uint8_t readBack[CY_FX_FRAM_SCRATCH_SIZE];
+    uint16_t i;
+    uint32_t scratch = glFramGeometry.capacity - CY_FX_FRAM_SCRATCH_SIZE;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    /*
+     * Use a pattern with all bit transitions in each byte lane.
+     */
+    for (i = 0; i < CY_FX_FRAM_SCRATCH_SIZE; i++) {
+        pattern[i] = (uint8_t)(seed + i * 0x3B) ^ ((i & 1) ? 0xAA : 0x55);
+    }
+
+    status = CyFxBulkLpFramWriteRegister (scratch, pattern, CY_FX_FRAM_SCRATCH_SIZE);
+    if (status != CY_U3P_SUCCESS) {
+        return status;
+    }
+
+    CyU3PMemSet (readBack, 0, CY_FX_FRAM_SCRATCH_SIZE);
+    status = CyFxBulkLpFramReadRegister (scratch, readBack, CY_FX_FRAM_SCRATCH_SIZE);
+    if (status != CY_U3P_SUCCESS) {
+        return status;
+    }
+
+    if (CyU3PMemCmp (pattern, readBack, CY_FX_FRAM_SCRATCH_SIZE) != 0) {
+        return CY_U3P_ERROR_FAILURE;
+    }
+    return CY_U3P_SUCCESS;
+}
+
+/*
+ * Select the fastest SPI clock that accesses the SPI FRAM correctly
+ *
+ * The clock is stepped up through glSpiClockTable. At each clock the
+ * READ command is tried first, then the FAST_READ command. The step
+ * stops at the first clock where neither of them verifies, and the
+ * last verified setting is kept. The default setting is restored when
+ * no setting is verified.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpSpiCalibrate (
+    void
+) {
+    uint32_t clock = 0;
+    CyBool_t fastRead = CyFalse;
+    CyBool_t verified;
+    uint8_t step;
+    uint8_t mode;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    for (step = 0; step < (sizeof (glSpiClockTable) / sizeof (glSpiClockTable[0])); step++) {
+        verified = CyFalse;
+        for (mode = 0; (mode < 2) && (!verified); mode++) {
+            status = CyFxBulkLpSpiSetClock (glSpiClockTable[step], (mode != 0));
+            if (status != CY_U3P_SUCCESS) {
+                break;
+            }
+            if (CyFxBulkLpSpiVerify (step * 2 + mode) == CY_U3P_SUCCESS) {
+                verified = CyTrue;
+                clock = glSpiClockTable[step];
+                fastRead = (mode != 0);
+            }
+        }
+        if (!verified) {
+            break;
+        }
+    }
+
+    if (clock == 0) {
+        CyU3PDebugPrint (4, "SPI clock calibration failed\r\n");
+        return CyFxBulkLpSpiSetClock (CY_FX_SPI_CLOCK_DEFAULT, CyFalse);
+    }
+
+    status = CyFxBulkLpSpiSetClock (clock, fastRead);
+    if (status == CY_U3P_SUCCESS) {
+        glSpiClock.calibrated = 1;
+    }
+    CyU3PDebugPrint (4, "SPI clock calibrated - clock: %d, fast read: %d\r\n",
+            clock, fastRead);
+    return status;
+}
+
+/*
+ * Complete the callback driven WRITE request
+ *
+ * Called in the thread. The WRITE transaction is closed and the
+ * callbacks stop handing chunks.
+ */
+void
+CyFxBulkLpCbWriteFinish (
+    CyU3PReturnStatus_t status
+) {
+    if (glCbWrite.isOpen) {
+        CyFxBulkLpFramWriteEnd ();
+        glCbWrite.isOpen = CyFalse;
+    }
+    glCbWrite.status  = status;
+    glCbWrite.isArmed = CyFalse;
+    glCbWrite.isSending = CyFalse;
+}
+
+/*
+ * Hand a received chunk to the SPI Tx channel
+ *
+ * Called in the thread for the first chunk and from the callbacks for
+ * the following ones, so only the SPI block transfer and the DMA buffer
+ * are set up. The chunk is sent from the buffer of the producer channel,
+ * with header bytes of command in front of it. The thread is woken when
+ * the chunk is sent, and right away for a ZLP or an error.
+ */
+void
+CyFxBulkLpCbWriteHand (
+    CyU3PDmaBuffer_t    *inBuf_p,
+    uint8_t             header
+) {
+    CyU3PDmaBuffer_t outBuf_p;
+    uint32_t count = inBuf_p->count;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    if (count > (glCbWrite.maxCount - glCbWrite.total)) {
+        count = glCbWrite.maxCount - glCbWrite.total;
+    }
+    glCbWrite.buffer   = inBuf_p->buffer;
+    glCbWrite.count    = count;
+    glCbWrite.received = inBuf_p->count;
+
+    /*
+     * Nothing is sent for a ZLP.
+     */
+    if (count > 0) {
+        outBuf_p.buffer = inBuf_p->buffer - header;
+        outBuf_p.status = 0;
+        outBuf_p.size   = CY_FX_BULKLP_DMA_CHUNK_SIZE + CY_FX_FRAM_HEADER_SIZE;
+        outBuf_p.count  = count + header;
+        CyU3PSpiSetBlockXfer (count + header, 0);
+        status = CyU3PDmaChannelSetupSendBuffer (&glSpiTxHandle, &outBuf_p);
+        if (status == CY_U3P_SUCCESS) {
+            return;
+        }
+    }
+
+    glCbWrite.sendStatus = status;
+    glCbWrite.isSent = CyTrue;
+    CyU3PEventSet (&glFramEvent, CY_FX_CB_WRITE_DONE, CYU3P_EVENT_OR);
+}
+
+/*
+ * Hand the next received chunk from the callback context
+ *
+ * When no chunk has been received yet, the SPI is left to the next
+ * CY_U3P_DMA_CB_PROD_EVENT of the producer channel.
+ */
+void
+CyFxBulkLpCbWriteNext (
+    void
+) {
+    CyU3PDmaBuffer_t inBuf_p;
+    CyU3PReturnStatus_t status;
+
+    glCbWrite.isSending = CyTrue;
+    status = CyU3PDmaChannelGetBuffer (&glChHandleBulkLpIn, &inBuf_p, CYU3P_NO_WAIT);
+    if (status == CY_U3P_SUCCESS) {
+        CyFxBulkLpCbWriteHand (&inBuf_p, 0);
+    } else if (status == CY_U3P_ERROR_TIMEOUT) {
+        glCbWrite.isSending = CyFalse;
+    } else {
+        glCbWrite.sendStatus = status;
+        glCbWrite.isSent = CyTrue;
+        CyU3PEventSet (&glFramEvent, CY_FX_CB_WRITE_DONE, CYU3P_EVENT_OR);
+    }
+}
+
+/*
+ * Complete the chunk sent to the SPI FRAM
+ *
+ * Called in the thread when woken by CY_FX_CB_WRITE_DONE. The data of
+ * the chunk is copied and added to the CRC, and its buffer is returned
+ * to the producer channel. A chunk received in the meantime is handed
+ * here, otherwise the SPI is released to the producer callback.
+ */
+void
+CyFxBulkLpCbWriteSent (
+    void
+) {
+    CyU3PDmaBuffer_t inBuf_p;
+    uint32_t count = glCbWrite.count;
+    uint32_t intMask;
+    CyBool_t isReady;
+    CyU3PReturnStatus_t status = glCbWrite.sendStatus;
+
+    glCbWrite.isSent = CyFalse;
+    if (status != CY_U3P_SUCCESS) {
+        CyU3PSpiDisableBlockXfer (CyTrue, CyFalse);
+        CyFxBulkLpCbWriteFinish (status);
+        return;
+    }
+
+    /*
+     * The DMA is completed when the last word enters the SPI block,
+     * so only the shift of the last words is waited for.
+     */
+    if (count > 0) {
+        status = CyU3PSpiWaitForBlockXfer (CyFalse);
+        CyU3PSpiDisableBlockXfer (CyTrue, CyFalse);
+        if (status != CY_U3P_SUCCESS) {
+            CyFxBulkLpCbWriteFinish (status);
+            return;
+        }
+
+        if (glCbWrite.copy != NULL) {
+            CyU3PMemCopy (glCbWrite.copy + glCbWrite.total, glCbWrite.buffer, count);
+        }
+        if (glCbWrite.isVerify) {
+            glCbWrite.crc = CyFxBulkLpCrcUpdate (glCbWrite.crc, glCbWrite.buffer, count);
+        }
+        glCbWrite.total += count;
+    }
+
+    /*
+     * Now discard the data from the producer channel so that the buffer
+     * is made available to receive more data.
+     */
+    status = CyU3PDmaChannelDiscardBuffer (&glChHandleBulkLpIn);
+    if (status != CY_U3P_SUCCESS) {
+        CyFxBulkLpCbWriteFinish (status);
+        return;
+    }
+
+    /*
+     * A short chunk indicates the end of the transfer.
+     */
+    if ((glCbWrite.received < CY_FX_BULKLP_DMA_CHUNK_SIZE) ||
+            (glCbWrite.total >= glCbWrite.maxCount)) {
+        CyFxBulkLpCbWriteFinish (CY_U3P_SUCCESS);
+        return;
+    }
+
+    /*
+     * The producer callback skips the chunks which arrive while the SPI
+     * is held here, and only marks them ready. The SPI is released with
+     * the interrupts disabled, so a chunk is either taken here or handed
+     * by the callback.
+     */
+    for (;;) {
+        status = CyU3PDmaChannelGetBuffer (&glChHandleBulkLpIn, &inBuf_p, CYU3P_NO_WAIT);
+        if (status != CY_U3P_ERROR_TIMEOUT) {
+            break;
+        }
+        intMask = CyU3PVicDisableAllInterrupts ();
+        isReady = glCbWrite.isReady;
+        glCbWrite.isReady = CyFalse;
+        if (!isReady) {
+            glCbWrite.isSending = CyFalse;
+        }
+        CyU3PVicEnableInterrupts (intMask);
+        if (!isReady) {
+            return;
+        }
+    }
+    if (status != CY_U3P_SUCCESS) {
+        CyFxBulkLpCbWriteFinish (status);
+        return;
+    }
+    CyFxBulkLpCbWriteHand (&inBuf_p, 0);
+}
+
+/*
+ * Callback of the producer channel in CY_FX_DMA_MODE_CALLBACK
+ *
+ * The received chunk is handed to the SPI when it is free. The DMA
+ * callbacks of both channels are called in the same DMA thread context,
+ * so the state is changed by one of them at a time.
+ */
+void
+CyFxBulkLpUsbDmaCb (
+    CyU3PDmaChannel     *chHandle,
+    CyU3PDmaCbType_t    type,
+    CyU3PDmaCBInput_t   *input
+) {
+    if ((type == CY_U3P_DMA_CB_PROD_EVENT) && (glCbWrite.isArmed)) {
+        if (glCbWrite.isSending) {
+            glCbWrite.isReady = CyTrue;
+        } else {
+            CyFxBulkLpCbWriteNext ();
+        }
+    }
+}
+
+/*
+ * Callback of the SPI Tx channel in CY_FX_DMA_MODE_CALLBACK
+ *
+ * The thread completes the chunk.
+ */
+void
+CyFxBulkLpSpiDmaCb (
+    CyU3PDmaChannel     *chHandle,
+    CyU3PDmaCbType_t    type,
+    CyU3PDmaCBInput_t   *input
+) {
+    if ((type == CY_U3P_DMA_CB_SEND_CPLT) &&
+            (glCbWrite.isArmed) && (glCbWrite.isSending)) {
+        glCbWrite.sendStatus = CY_U3P_SUCCESS;
+        glCbWrite.isSent = CyTrue;
+        CyU3PEventSet (&glFramEvent, CY_FX_CB_WRITE_DONE, CYU3P_EVENT_OR);
+    }
+}
+
+/*
+ * Write the data received from the OUT endpoint by the DMA callbacks
+ *
+ * Same as CyFxBulkLpFramWritePipe, but the chunks are handed to the SPI
+ * by the producer callback as soon as both the chunk and the SPI are
+ * ready, without waiting for the thread to be scheduled. The callbacks
+ * do not block: the thread sends the WRITE command, waits for the end of
+ * each SPI block transfer, copies the data and updates the CRC when it
+ * is woken by CY_FX_CB_WRITE_DONE.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramWriteEvents (
+    uint32_t    byteAddress,
+    uint32_t    maxCount,
+    uint32_t    *byteCount,
+    uint8_t     *copy
+) {
+    CyU3PDmaBuffer_t inBuf_p;
+    uint32_t eventFlags;
+    uint8_t header = 0;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    CyU3PMemSet ((uint8_t *)&glCbWrite, 0, sizeof (glCbWrite));
+    glCbWrite.byteAddress = byteAddress;
+    glCbWrite.maxCount    = maxCount;
+    glCbWrite.copy        = copy;
+    glCbWrite.isVerify    = glVerifyWrite;
+    *byteCount = 0;
+
+    status = CyU3PDmaChannelGetBuffer (&glChHandleBulkLpIn, &inBuf_p, CYU3P_WAIT_FOREVER);
+    if (status != CY_U3P_SUCCESS) {
+        return status;
+    }
+
+    /*
+     * isSending keeps the callbacks from taking the same chunk
+     * until it is handed here.
+     */
+    glCbWrite.isSending = CyTrue;
+    glCbWrite.isArmed   = CyTrue;
+    if ((inBuf_p.count > 0) && (maxCount > 0)) {
+        status = CyFxBulkLpFramWriteBeginHeader (byteAddress, inBuf_p.buffer, &header);
+        glCbWrite.isOpen = (status == CY_U3P_SUCCESS);
+    }
+    if (status == CY_U3P_SUCCESS) {
+        CyFxBulkLpCbWriteHand (&inBuf_p, header);
+    } else {
+        CyFxBulkLpCbWriteFinish (status);
+    }
+
+    /*
+     * The channels are destroyed when the application is stopped, and no
+     * more callbacks are expected once the chunk being sent is completed.
+     */
+    while (glCbWrite.isArmed) {
+        CyU3PEventGet (&glFramEvent, CY_FX_CB_WRITE_DONE, CYU3P_EVENT_OR_CLEAR,
+                &eventFlags, CY_FX_LOOP_TIMEOUT);
+        if (glCbWrite.isSent) {
+            CyFxBulkLpCbWriteSent ();
+        } else if ((!glIsApplnActive) && (!glCbWrite.isSending)) {
+            CyFxBulkLpCbWriteFinish (CY_U3P_ERROR_ABORTED);
+        }
+    }
+    status = glCbWrite.status;
+
+    /*
+     * Read back the written data and compare the CRC.
+     */
+    if ((glCbWrite.isVerify) && (status == CY_U3P_SUCCESS) && (glCbWrite.total > 0)) {
+        status = CyFxBulkLpFramVerify (byteAddress, glCbWrite.total, glCbWrite.crc);
+    }
+
+    CY_FX_TRACE (CY_FX_TRACE_FRAM_WRITE, byteAddress, glCbWrite.total);
+
+    *byteCount = glCbWrite.total;
+    return status;
+}
+
+/*
+ * Write the data received from the OUT endpoint to the SPI FRAM
+ *
+ * Parameters
+ *
+ * uint32_t byteAddress
+ *     The FRAM address where the data is to be written.
+ * uint32_t maxCount
+ *     The maximum number of bytes to be written.
+ * uint32_t *byteCount
+ *     Returns the number of bytes written to the SPI FRAM.
+ * uint8_t *copy
+ *     Buffer where a copy of the written data is stored, or NULL.
+ *
+ * The data is received in CY_FX_BULKLP_DMA_CHUNK_SIZE chunks. While a
+ * chunk is sent to the SPI FRAM, the following chunks are received into
+ * the other buffers of the producer channel, so the OUT endpoint is not
+ * blocked for the whole SPI transfer time. All chunks are written in a
+ * single WRITE transaction. The transfer ends with a short packet or a
+ * ZLP, or when maxCount bytes are received. When glVerifyWrite is set,
+ * the written data is read back and its CRC32 is compared.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramWritePipe (
+    uint32_t    byteAddress,
+    uint32_t    maxCount,
+    uint32_t    *byteCount,
+    uint8_t     *copy
+) {
+    CyU3PDmaBuffer_t inBuf_p;
+    CyBool_t isOpen = CyFalse;
+    uint32_t total = 0;
+    uint32_t crc = 0;
+    uint16_t count;
+    uint8_t header = 0;
+    uint32_t start;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    if (glDmaMode == CY_FX_DMA_MODE_CALLBACK) {
+        return CyFxBulkLpFramWriteEvents (byteAddress, maxCount, byteCount, copy);
+    }
+
+    for (;;) {
+        /*
+         * Wait for receiving a chunk from the producer socket (OUT endpoint).
+         */
+        start = CyU3PGetTime ();
+        status = CyU3PDmaChannelGetBuffer (&glChHandleBulkLpIn, &inBuf_p, CYU3P_WAIT_FOREVER);
+        CyFxBulkLpPerfAdd (CY_FX_PERF_GET_BUFFER, start, 0);
+        if (status != CY_U3P_SUCCESS) {
+            break;
+        }
+
+        count = inBuf_p.count;
+        if (count > (maxCount - total)) {
+            count = maxCount - total;
+        }
+
+        /*
+         * The WRITE transaction is started with the first data, so
+         * nothing is written for a ZLP.
+         */
+        if ((count > 0) && (!isOpen)) {
+            status = CyFxBulkLpFramWriteBeginHeader (byteAddress, inBuf_p.buffer, &header);
+            if (status != CY_U3P_SUCCESS) {
+                break;
+            }
+            isOpen = CyTrue;
+        }
+
+        /*
+         * The first block goes out with the command in front of it.
+         */
+        status = CyFxBulkLpFramWriteData (inBuf_p.buffer - header, count + header);
+        header = 0;
+        if (status != CY_U3P_SUCCESS) {
+            break;
+        }
+        if (copy != NULL) {
+            CyU3PMemCopy (copy + total, inBuf_p.buffer, count);
+        }
+        if (glVerifyWrite) {
+            crc = CyFxBulkLpCrcUpdate (crc, inBuf_p.buffer, count);
+        }
+        total += count;
+
+        /*
+         * Now discard the data from the producer channel so that the buffer is made available
+         * to receive more data.
+         */
+        start = CyU3PGetTime ();
+        status = CyU3PDmaChannelDiscardBuffer (&glChHandleBulkLpIn);
+        CyFxBulkLpPerfAdd (CY_FX_PERF_COMMIT, start, count);
+        if (status != CY_U3P_SUCCESS) {
+            break;
+        }
+
+        /*
+         * A short chunk indicates the end of the transfer.
+         */
+        if ((inBuf_p.count < CY_FX_BULKLP_DMA_CHUNK_SIZE) || (total >= maxCount)) {
+            break;
+        }
+    }
+
+    if (isOpen) {
+        CyFxBulkLpFramWriteEnd ();
+    }
+
+    /*
+     * Read back the written data and compare the CRC.
+     */
+    if ((glVerifyWrite) && (status == CY_U3P_SUCCESS) && (total > 0)) {
+        status = CyFxBulkLpFramVerify (byteAddress, total, crc);
+    }
+
+    CY_FX_TRACE (CY_FX_TRACE_FRAM_WRITE, byteAddress, total);
+
+    *byteCount = total;
+    return status;
+}
+
+/*
+ * Write the data from the OUT endpoint to the SPI FRAM in the direct mode
+ *
+ * Parameters
+ *
+ * uint32_t byteAddress
+ *     The FRAM address where the data is to be written.
+ * uint32_t byteCount
+ *     The number of bytes to be written. The host has to send exactly
+ *     this number of bytes.
+ *
+ * The data flows from the OUT endpoint to the SPI block through the AUTO
+ * channel glChHandleBulkLpIn. The firmware only sends the WRITE command
+ * and sets the size of the transfer.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramWriteDirect (
+    uint32_t    byteAddress,
+    uint32_t    byteCount
+) {
+    uint32_t start;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    if (byteCount == 0) {
+        return CY_U3P_SUCCESS;
+    }
+
+    status = CyFxBulkLpFramWriteBegin (byteAddress);
+    if (status != CY_U3P_SUCCESS) {
+        return status;
+    }
+
+    CyU3PSpiSetBlockXfer (byteCount, 0);
+
+    status = CyU3PDmaChannelSetXfer (&glChHandleBulkLpIn, byteCount);
+    if (status == CY_U3P_SUCCESS)
+    {
+        /*
+         * Wait until all the data is received from the host
+         * and sent to the SPI FRAM.
+         */
+        start = CyU3PGetTime ();
+        status = CyU3PDmaChannelWaitForCompletion (&glChHandleBulkLpIn,
+                CYU3P_WAIT_FOREVER);
+        CyFxBulkLpPerfAdd (CY_FX_PERF_DMA_WAIT, start, byteCount);
+    }
+    if (status == CY_U3P_SUCCESS)
+    {
+        start = CyU3PGetTime ();
+        status = CyU3PSpiWaitForBlockXfer (CyFalse);
+        CyFxBulkLpPerfAdd (CY_FX_PERF_SPI_WAIT, start, 0);
+    }
+
+    CyFxBulkLpFramWriteEnd ();
+    CyU3PSpiDisableBlockXfer (CyTrue, CyFalse);
+
+    return status;
+}
+
+/*
+ * Read data from the SPI FRAM to the IN endpoint in the direct mode
+ *
+ * Parameters
+ *
+ * uint32_t byteAddress
+ *     The FRAM address where the data to be read is located.
+ * uint32_t byteCount
+ *     The number of bytes to be read.
+ *
+ * The data flows from the SPI block to the IN endpoint through the AUTO
+ * channel glChHandleBulkLpOut. The firmware only sends the READ command
+ * and sets the size of the transfer. No ZLP is sent in this mode.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramReadDirect (
+    uint32_t    byteAddress,
+    uint32_t    byteCount
+) {
+    uint32_t start;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    if (byteCount == 0) {
+        return CY_U3P_SUCCESS;
+    }
+
+    status = CyU3PDmaChannelSetXfer (&glChHandleBulkLpOut, byteCount);
+    if (status != CY_U3P_SUCCESS) {
+        return status;
+    }
+
+    status = CyFxBulkLpFramReadBegin (byteAddress, byteCount);
+    if (status != CY_U3P_SUCCESS) {
+        return status;
+    }
+
+    start = CyU3PGetTime ();
+    status = CyU3PSpiWaitForBlockXfer (CyTrue);
+    CyFxBulkLpPerfAdd (CY_FX_PERF_SPI_WAIT, start, byteCount);
+    if ((status == CY_U3P_SUCCESS) && ((byteCount % CY_FX_BULKLP_DMA_CHUNK_SIZE) != 0))
+    {
+        /*
+         * Commit the last partial buffer to the IN endpoint.
+         */
+        status = CyU3PDmaChannelSetWrapUp (&glChHandleBulkLpOut);
+    }
+    if (status == CY_U3P_SUCCESS)
+    {
+        /*
+         * Wait until all the data is sent to the host.
+         */
+        start = CyU3PGetTime ();
+        status = CyU3PDmaChannelWaitForCompletion (&glChHandleBulkLpOut,
+                CYU3P_WAIT_FOREVER);
+        CyFxBulkLpPerfAdd (CY_FX_PERF_DMA_WAIT, start, 0);
+    }
+
+    CyFxBulkLpFramReadEnd ();
+
+    return status;
+}
+
+/*
+ * Allocate the sector cache from the DMA buffer heap
+ *
+ * The cache is enabled when at least one sector buffer is allocated.
+ */
+void
+CyFxBulkLpCacheInit (
+    void
+) {
+    uint8_t i;
+
+    CyU3PMemSet ((uint8_t *)glCache, 0, sizeof (glCache));
+    CyU3PMemSet ((uint8_t *)&glCacheStats, 0, sizeof (glCacheStats));
+    for (i = 0; i < CY_FX_SECTOR_CACHE_COUNT; i++) {
+        glCache[i].buffer = (uint8_t *)CyU3PDmaBufferAlloc (CY_FX_BULKLP_DMA_BUF_SIZE);
+        if (glCache[i].buffer == NULL) {
+            break;
+        }
+        glCacheStats.entries++;
+    }
+    glCacheEnabled = (glCacheStats.entries > 0);
+    CyU3PDebugPrint (4, "Sector cache - entries: %d\r\n", glCacheStats.entries);
+}
+
+/*
+ * Enable or disable the sector cache
+ *
+ * All entries are invalidated because the writes are not tracked
+ * while the cache is disabled.
+ */
+void
+CyFxBulkLpCacheEnable (
+    CyBool_t    enable
+) {
+    uint8_t i;
+
+    for (i = 0; i < glCacheStats.entries; i++) {
+        glCache[i].validCount = 0;
+        glCache[i].lastUse    = 0;
+    }
+    glCacheEnabled = (enable && (glCacheStats.entries > 0));
+}
+
+/*
+ * Find a sector in the cache
+ *
+ * Returns the entry holding at least byteCount bytes of the sector,
+ * or NULL for a miss.
+ */
+CyFxBulkLpCacheEntry_t *
+CyFxBulkLpCacheLookup (
+    uint16_t    sector,
+    uint16_t    byteCount
+) {
+    uint8_t i;
+
+    if (!glCacheEnabled) {
+        return NULL;
+    }
+
+    for (i = 0; i < glCacheStats.entries; i++) {
+        if ((glCache[i].validCount != 0) && (glCache[i].sector == sector) &&
+                (glCache[i].validCount >= byteCount)) {
+            glCache[i].lastUse = ++glCacheUse;
+            glCacheStats.hits++;
+            return &glCache[i];
+        }
+    }
+    glCacheStats.misses++;
+    return NULL;
+}
+
+/*
+ * Get a cache entry to store a sector
+ *
+ * The entry already holding the sector is used if any. Otherwise the
+ * least recently used entry is emptied and assigned to the sector.
+ * Returns NULL when the cache is disabled.
+ */
+CyFxBulkLpCacheEntry_t *
+CyFxBulkLpCacheAllocate (
+    uint16_t    sector
+) {
+    CyFxBulkLpCacheEntry_t *entry_p = NULL;
+    uint8_t i;
+
+    if (!glCacheEnabled) {
+        return NULL;
+    }
+
+    for (i = 0; i < glCacheStats.entries; i++) {
+        if ((glCache[i].validCount != 0) && (glCache[i].sector == sector)) {
+            entry_p = &glCache[i];
+            break;
+        }
+        if ((entry_p == NULL) || (glCache[i].lastUse < entry_p->lastUse)) {
+            entry_p = &glCache[i];
+        }
+    }
+
+    if (entry_p->sector != sector) {
+        if (entry_p->validCount != 0) {
+            glCacheStats.evictions++;
+        }
+        entry_p->validCount = 0;
+        entry_p->sector     = sector;
+    }
+    entry_p->lastUse = ++glCacheUse;
+    return entry_p;
+}
+
+/*
+ * Invalidate the cached sectors overlapping a byte range of the FRAM
+ */
+void
+CyFxBulkLpCacheInvalidate (
+    uint32_t    byteAddress,
+    uint32_t    byteCount
+) {
+    uint32_t top;
+    uint8_t i;
+
+    for (i = 0; i < glCacheStats.entries; i++) {
+        top = CY_FX_SECTOR_SIZE * glCache[i].sector;
+        if ((glCache[i].validCount != 0) &&
+                (byteAddress < top + CY_FX_SECTOR_SIZE) && (top < byteAddress + byteCount)) {
+            glCache[i].validCount = 0;
+            glCache[i].lastUse    = 0;
+        }
+    }
+}
+
+/*
+ * Send cached data to the IN endpoint
+ *
+ * The data is copied to the buffers of the consumer channel in
+ * CY_FX_BULKLP_DMA_CHUNK_SIZE chunks. No ZLP is sent by this function.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpCacheSend (
+    uint8_t     *data,
+    uint32_t    byteCount
+) {
+    CyU3PDmaBuffer_t outBuf_p;
+    uint32_t remain = byteCount;
+    uint16_t count;
+    uint32_t start;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    while (remain > 0) {
+        count = (remain > CY_FX_BULKLP_DMA_CHUNK_SIZE) ? CY_FX_BULKLP_DMA_CHUNK_SIZE : remain;
+
+        start = CyU3PGetTime ();
+        status = CyU3PDmaChannelGetBuffer (&glChHandleBulkLpOut, &outBuf_p, CYU3P_WAIT_FOREVER);
+        CyFxBulkLpPerfAdd (CY_FX_PERF_GET_BUFFER, start, 0);
+        if (status != CY_U3P_SUCCESS) {
+            break;
+        }
+        CyU3PMemCopy (outBuf_p.buffer, data + (byteCount - remain), count);
+        start = CyU3PGetTime ();
+        status = CyU3PDmaChannelCommitBuffer (&glChHandleBulkLpOut, count, 0);
+        CyFxBulkLpPerfAdd (CY_FX_PERF_COMMIT, start, count);
+        if (status != CY_U3P_SUCCESS) {
+            break;
+        }
+        remain -= count;
+    }
+
+    return status;
+}
+
+/*
+ * Write consecutive sectors with the data from the OUT endpoint
+ *
+ * Parameters
+ *
+ * uint16_t sector
+ *     The first sector number to be written.
+ * uint16_t nSectors
+ *     The number of sectors to be written.
+ * uint16_t byteCount
+ *     The number of bytes to be written to each sector in the direct
+ *     mode.
+ *
+ * The data of all sectors is received as a single BULK transfer.
+ * The transfer ends after nSectors full sectors, or earlier with
+ * a short packet or a ZLP. The written data is also stored in the
+ * sector cache in the CPU mode.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramWriteSectors (
+    uint16_t    sector,
+    uint16_t    nSectors,
+    uint16_t    byteCount
+) {
+    uint32_t written;
+    CyFxBulkLpCacheEntry_t *entry_p;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    if (glDmaMode == CY_FX_DMA_MODE_DIRECT) {
+        while ((nSectors > 0) && (status == CY_U3P_SUCCESS)) {
+            /* The data does not go through the CPU. */
+            CyFxBulkLpCacheInvalidate (CY_FX_SECTOR_SIZE * sector, CY_FX_SECTOR_SIZE);
+            status = CyFxBulkLpFramWriteDirect (CY_FX_SECTOR_SIZE * sector, byteCount);
+            sector++;
+            nSectors--;
+        }
+        return status;
+    }
+
+    while (nSectors > 0) {
+        entry_p = CyFxBulkLpCacheAllocate (sector);
+        status = CyFxBulkLpFramWritePipe (CY_FX_SECTOR_SIZE * sector,
+                CY_FX_BULKLP_DMA_BUF_SIZE, &written,
+                (entry_p != NULL) ? entry_p->buffer : NULL);
+        if (entry_p != NULL) {
+            if (status != CY_U3P_SUCCESS) {
+                entry_p->validCount = 0;
+            } else if (written > entry_p->validCount) {
+                entry_p->validCount = written;
+            }
+        }
+        if ((status != CY_U3P_SUCCESS) || (written < CY_FX_BULKLP_DMA_BUF_SIZE)) {
+            break;
+        }
+        sector++;
+        nSectors--;
+    }
+
+    return status;
+}
+
+/*
+ * Read consecutive sectors and send the data to the IN endpoint
+ *
+ * Parameters
+ *
+ * uint16_t sector
+ *     The first sector number to be read.
+ * uint16_t nSectors
+ *     The number of sectors to be read.
+ * uint16_t byteCount
+ *     The number of bytes to be read from each sector.
+ *
+ * The data of all sectors is sent as a single BULK transfer
+ * terminated by a ZLP if required. In the CPU mode the sectors found
+ * in the sector cache are sent without accessing the FRAM, and the
+ * other sectors are stored in the cache.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramReadSectors (
+    uint16_t    sector,
+    uint16_t    nSectors,
+    uint16_t    byteCount
+) {
+    uint32_t total = (uint32_t)byteCount * nSectors;
+    CyFxBulkLpCacheEntry_t *entry_p;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    if (glDmaMode == CY_FX_DMA_MODE_DIRECT) {
+        while ((nSectors > 0) && (status == CY_U3P_SUCCESS)) {
+            status = CyFxBulkLpFramReadDirect (CY_FX_SECTOR_SIZE * sector, byteCount);
+            sector++;
+            nSectors--;
+        }
+        return status;
+    }
+
+    while (nSectors > 0) {
+        entry_p = CyFxBulkLpCacheLookup (sector, byteCount);
+        if (entry_p != NULL) {
+            status = CyFxBulkLpCacheSend (entry_p->buffer, byteCount);
+        } else {
+            /*
+             * The cache entries hold up to CY_FX_BULKLP_DMA_BUF_SIZE bytes.
+             */
+            entry_p = ((byteCount != 0) && (byteCount <= CY_FX_BULKLP_DMA_BUF_SIZE)) ?
+                CyFxBulkLpCacheAllocate (sector) : NULL;
+            status = CyFxBulkLpFramReadPipe (CY_FX_SECTOR_SIZE * sector, byteCount,
+                    (entry_p != NULL) ? entry_p->buffer : NULL);
+            if (entry_p != NULL) {
+                if (status != CY_U3P_SUCCESS) {
+                    entry_p->validCount = 0;
+                } else if (byteCount > entry_p->validCount) {
+                    entry_p->validCount = byteCount;
+                }
+            }
+        }
+        if (status != CY_U3P_SUCCESS) {
+            return status;
+        }
+        sector++;
+        nSectors--;
+    }
+
+    if ((total % glPacketSize) == 0) {
+        /*
+         * Add ZLP for aligned size of data
+         */
+        status = CyFxBulkLpSendZlp ();
+    }
+
+    return status;
+}
+
+/*
+ * Write the data from the OUT endpoint to a byte range of the SPI FRAM
+ *
+ * Parameters
+ *
+ * uint32_t byteAddress
+ *     The FRAM address where the data is to be written.
+ * uint32_t byteCount
+ *     The number of bytes to be written.
+ *
+ * The range is not bound to the sectors. In the CPU modes the end of
+ * the transfer is only seen on a short packet, so a transfer of a
+ * multiple of the packet size is ended by a ZLP, also when it has
+ * byteCount bytes. The transfer may be terminated early in the same
+ * way. In the direct mode the transfer has exactly byteCount bytes.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramWriteBytes (
+    uint32_t    byteAddress,
+    uint32_t    byteCount
+) {
+    uint32_t written;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    CyFxBulkLpCacheInvalidate (byteAddress, byteCount);
+    if (glDmaMode == CY_FX_DMA_MODE_DIRECT) {
+        return CyFxBulkLpFramWriteDirect (byteAddress, byteCount);
+    }
+
+    status = CyFxBulkLpFramWritePipe (byteAddress, byteCount, &written, NULL);
+
+    /*
+     * The ZLP after a full last chunk is still in the channel.
+     */
+    if ((status == CY_U3P_SUCCESS) && (written == byteCount) &&
+            ((byteCount % CY_FX_BULKLP_DMA_CHUNK_SIZE) == 0)) {
+        status = CyFxBulkLpRecvZlp ();
+    }
+    return status;
+}
+
+/*
+ * Read a byte range of the SPI FRAM and send it to the IN endpoint
+ *
+ * Parameters
+ *
+ * uint32_t byteAddress
+ *     The FRAM address where the data to be read is located.
+ * uint32_t byteCount
+ *     The number of bytes to be read.
+ *
+ * In the CPU mode a ZLP follows when the length is a multiple of
+ * the packet size.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpFramReadBytes (
+    uint32_t    byteAddress,
+    uint32_t    byteCount
+) {
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    if (glDmaMode == CY_FX_DMA_MODE_DIRECT) {
+        return CyFxBulkLpFramReadDirect (byteAddress, byteCount);
+    }
+
+    status = CyFxBulkLpFramReadPipe (byteAddress, byteCount, NULL);
+    if ((status == CY_U3P_SUCCESS) && ((byteCount % glPacketSize) == 0)) {
+        status = CyFxBulkLpSendZlp ();
+    }
+    return status;
+}
+
+/*
+ * Make a line of the test pattern
+ *
+ * Parameters
+ *
+ * uint8_t *line
+ *     Buffer of CY_FX_PATTERN_LINE_SIZE bytes where the line is stored.
+ * uint32_t offset
+ *     The offset of the line in the transfer.
+ *
+ * The line is the offset in 4 hexadecimal digits between spaces,
+ * followed by digits and CR LF, as the lines of 1000.txt.
+ */
+void
+CyFxBulkLpPatternLine (
+    uint8_t     *line,
+    uint32_t    offset
+) {
+    const char hex[] = "0123456789ABCDEF";
+    uint8_t i;
+
+    line[0] = ' ';
+    for (i = 4; i > 0; i--) {
+        line[i] = hex[offset & 0x0F];
+        offset >>= 4;
+    }
+    line[5] = ' ';
+    for (i = 6; i < CY_FX_PATTERN_LINE_SIZE - 2; i++) {
+        line[i] = '0' + ((i + 1) % 10);
+    }
+    line[CY_FX_PATTERN_LINE_SIZE - 2] = '\r';
+    line[CY_FX_PATTERN_LINE_SIZE - 1] = '\n';
+}
+
+/*
+ * Fill or check a buffer with the test pattern
+ *
+ * Parameters
+ *
+ * uint8_t *buffer
+ *     The data buffer.
+ * uint32_t offset
+ *     The offset of the first byte of the buffer in the transfer.
+ * uint16_t count
+ *     The number of bytes in the buffer.
+ * CyBool_t isCheck
+ *     CyTrue to check the buffer, CyFalse to fill it.
+ *
+ * Returns the number of bytes which did not match the pattern, and
+ * records the offset of the first one in glPatternResult.
+ */
+uint32_t
+CyFxBulkLpPattern (
+    uint8_t     *buffer,
+    uint32_t    offset,
+    uint16_t    count,
+    CyBool_t    isCheck
+) {
+    uint8_t line[CY_FX_PATTERN_LINE_SIZE];
+    uint16_t column;
+    uint16_t length;
+    uint16_t i;
+    uint32_t errors = 0;
+
+    while (count > 0) {
+        column = offset % CY_FX_PATTERN_LINE_SIZE;
+        length = CY_FX_PATTERN_LINE_SIZE - column;
+        if (length > count) {
+            length = count;
+        }
+        CyFxBulkLpPatternLine (line, offset - column);
+
+        if (!isCheck) {
+            CyU3PMemCopy (buffer, line + column, length);
+        } else if (CyU3PMemCmp (buffer, line + column, length) != 0) {
+            for (i = 0; i < length; i++) {
+                if (buffer[i] != line[column + i]) {
+                    if ((errors == 0) && (glPatternResult.checkErrors == 0)) {
+                        glPatternResult.firstError = offset + i;
+                    }
+                    errors++;
+                }
+            }
+        }
+
+        buffer += length;
+        offset += length;
+        count  -= length;
+    }
+
+    return errors;
+}
+
+/*
+ * Send the test pattern to the IN endpoint
+ *
+ * The pattern is made directly in the buffers of the consumer channel,
+ * and a ZLP follows when the length is a multiple of the packet size.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpPatternSend (
+    uint32_t    byteCount
+) {
+    CyU3PDmaBuffer_t outBuf_p;
+    uint32_t total = 0;
+    uint32_t start = CyU3PGetTime ();
+    uint16_t count;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    while (total < byteCount) {
+        count = ((byteCount - total) > CY_FX_BULKLP_DMA_CHUNK_SIZE) ?
+            CY_FX_BULKLP_DMA_CHUNK_SIZE : (byteCount - total);
+
+        status = CyU3PDmaChannelGetBuffer (&glChHandleBulkLpOut, &outBuf_p, CYU3P_WAIT_FOREVER);
+        if (status != CY_U3P_SUCCESS) {
+            break;
+        }
+        CyFxBulkLpPattern (outBuf_p.buffer, total, count, CyFalse);
+        status = CyU3PDmaChannelCommitBuffer (&glChHandleBulkLpOut, count, 0);
+        if (status != CY_U3P_SUCCESS) {
+            break;
+        }
+        total += count;
+    }
+
+    if ((status == CY_U3P_SUCCESS) && ((byteCount % glPacketSize) == 0)) {
+        status = CyFxBulkLpSendZlp ();
+    }
+
+    glPatternResult.sendBytes = total;
+    glPatternResult.sendTime  = CyU3PGetTime () - start;
+    return status;
+}
+
+/*
+ * Check the data from the OUT endpoint with the test pattern
+ *
+ * The data is not written to the FRAM. The end of the transfer is only
+ * seen on a short packet, so a transfer of a multiple of the packet size
+ * is ended by a ZLP, also when it has byteCount bytes. The ZLP commits
+ * the partly filled last buffer; after a full last buffer it arrives on
+ * its own and is taken here.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpPatternCheck (
+    uint32_t    byteCount
+) {
+    CyU3PDmaBuffer_t inBuf_p;
+    uint32_t start = CyU3PGetTime ();
+    uint16_t count;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    glPatternResult.checkBytes  = 0;
+    glPatternResult.checkErrors = 0;
+    glPatternResult.firstError  = 0xFFFFFFFF;
+    glPatternResult.passed      = 0;
+
+    while (glPatternResult.checkBytes < byteCount) {
+        status = CyU3PDmaChannelGetBuffer (&glChHandleBulkLpIn, &inBuf_p, CYU3P_WAIT_FOREVER);
+        if (status != CY_U3P_SUCCESS) {
+            break;
+        }
+
+        count = inBuf_p.count;
+        if (count > (byteCount - glPatternResult.checkBytes)) {
+            count = byteCount - glPatternResult.checkBytes;
+        }
+        glPatternResult.checkErrors += CyFxBulkLpPattern (inBuf_p.buffer,
+                glPatternResult.checkBytes, count, CyTrue);
+        glPatternResult.checkBytes += count;
+
+        status = CyU3PDmaChannelDiscardBuffer (&glChHandleBulkLpIn);
+        if ((status != CY_U3P_SUCCESS) || (inBuf_p.count < CY_FX_BULKLP_DMA_CHUNK_SIZE)) {
+            break;
+        }
+    }
+
+    if ((status == CY_U3P_SUCCESS) && (glPatternResult.checkBytes == byteCount) &&
+            ((byteCount % CY_FX_BULKLP_DMA_CHUNK_SIZE) == 0)) {
+        status = CyFxBulkLpRecvZlp ();
+    }
+
+    glPatternResult.checkTime = CyU3PGetTime () - start;
+    glPatternResult.passed = ((status == CY_U3P_SUCCESS) &&
+            (glPatternResult.checkBytes == byteCount) && (glPatternResult.checkErrors == 0)) ? 1 : 0;
+    return status;
+}
+
+/*
+ * Get the number of requests in the queue
+ *
+ * The requests discarded by a flush are not counted even if the
+ * application thread has not skipped them yet.
+ */
+uint32_t
+CyFxBulkLpCmdLevel (
+    void
+) {
+    uint32_t head = glCmdHead;
+    uint32_t tail = glCmdTail;
+    uint32_t drop = glCmdDrop;
+
+    if ((int32_t)(drop - tail) > 0) {
+        tail = drop;
+    }
+    return head - tail;
+}
+
+/*
+ * Put a READ/WRITE request in the queue
+ *
+ * Called from the USB setup callback. The request is stored before
+ * glCmdHead is advanced, and the application thread is signaled only
+ * when the queue was empty. A thread busy with the queue takes the
+ * request without an event. CyFalse is returned if the queue is full.
+ */
+CyBool_t
+CyFxBulkLpCmdPut (
+    uint8_t     request,
+    uint32_t    address,
+    uint16_t    nSectors,
+    uint32_t    byteCount
+) {
+    CyFxBulkLpCmd_t *cmd_p;
+    uint32_t head = glCmdHead;
+    uint32_t level;
+
+    level = CyFxBulkLpCmdLevel ();
+    if (level >= CY_FX_CMD_QUEUE_DEPTH) {
+        glAppStats.cmdOverflow++;
+        return CyFalse;
+    }
+
+    cmd_p = &glCmdQueue[head % CY_FX_CMD_QUEUE_DEPTH];
+    cmd_p->request   = request;
+    cmd_p->address   = address;
+    cmd_p->nSectors  = nSectors;
+    cmd_p->byteCount = byteCount;
+    cmd_p->time      = CyU3PGetTime ();
+    CY_FX_MEMORY_BARRIER ();
+    glCmdHead = head + 1;
+    CY_FX_MEMORY_BARRIER ();
+
+    /*
+     * The level is read again after glCmdHead is advanced. If the thread
+     * has emptied the queue meanwhile, it may be going to sleep and has to
+     * be signaled. Otherwise it reads glCmdHead after its last request.
+     */
+    if (CyFxBulkLpCmdLevel () == 1) {
+        CyU3PEventSet (&glFramEvent, CY_FX_FRAM_CMD_READY, CYU3P_EVENT_OR);
+    }
+    if (level + 1 > glAppStats.cmdQueueMax) {
+        glAppStats.cmdQueueMax = level + 1;
+    }
+    return CyTrue;
+}
+
+/*
+ * Take the oldest request from the queue
+ *
+ * Called from the application thread only. The request is copied
+ * before glCmdTail is advanced to release the entry. CyFalse is
+ * returned if the queue is empty.
+ */
+CyBool_t
+CyFxBulkLpCmdGet (
+    CyFxBulkLpCmd_t *cmd_p
+) {
+    uint32_t tail = glCmdTail;
+    uint32_t drop = glCmdDrop;
+
+    /* Skip the requests discarded by a flush. */
+    if ((int32_t)(drop - tail) > 0) {
+        tail = drop;
+    }
+
+    /* The request taken before is served when the thread comes back. */
+    glCmdDone = tail;
+    if (glCmdHead == tail) {
+        glCmdTail = tail;
+        return CyFalse;
+    }
+
+    CY_FX_MEMORY_BARRIER ();
+    *cmd_p = glCmdQueue[tail % CY_FX_CMD_QUEUE_DEPTH];
+    CY_FX_MEMORY_BARRIER ();
+    glCmdTail = tail + 1;
+
+    return CyTrue;
+}
+
+/*
+ * Discard all the requests in the queue
+ *
+ * May be called from both contexts. glCmdTail is left to the
+ * application thread.
+ */
+void
+CyFxBulkLpCmdFlush (
+    void
+) {
+    glCmdDrop = glCmdHead;
+    CY_FX_MEMORY_BARRIER ();
+}
+
+/*
+ * Check whether a SET_DMA_MODE or SET_BURST request is not served yet
+ *
+ * Called from the USB setup callback. The channels are re-created by
+ * these requests, so the BULK data of a request queued after them
+ * would be flushed. A request discarded by a flush is not pending.
+ */
+CyBool_t
+CyFxBulkLpCmdReconfigPending (
+    void
+) {
+    uint32_t reconfig = glCmdReconfig;
+
+    return (((int32_t)(reconfig - glCmdDone) > 0) && ((int32_t)(reconfig - glCmdDrop) > 0));
+}
+
+/*
+ * Check whether all the queued requests are served
+ *
+ * Called from the USB setup callback. The callback is the only producer
+ * of the queue, so the threads stay idle until it returns.
+ */
+CyBool_t
+CyFxBulkLpCmdIdle (
+    void
+) {
+    return ((CyFxBulkLpCmdLevel () == 0) && (glCmdDone == glCmdTail) &&
+            (glSpiJobsDone == glSpiJobsSent));
+}
+
+/*
+ * Clear the throughput counters of the loopback modes
+ */
+void
+CyFxBulkLpLoopReset (
+    void
+) {
+    CyU3PDmaState_t state;
+    uint32_t prodXferCount;
+    uint32_t consXferCount = 0;
+
+    if (glIsApplnActive && (glDmaMode == CY_FX_DMA_MODE_LOOP_AUTO)) {
+        CyU3PDmaChannelGetStatus (&glChHandleBulkLpIn, &state, &prodXferCount, &consXferCount);
+    }
+    glLoopAutoBase = consXferCount;
+    glLoopStats.bytes   = 0;
+    glLoopStats.buffers = 0;
+    glLoopStats.period  = CyU3PGetTime ();
+}
+
+/*
+ * Loop a buffer from the OUT endpoint back to the IN endpoint
+ *
+ * Called by the application thread in CY_FX_DMA_MODE_LOOP_COPY and
+ * CY_FX_DMA_MODE_LOOP_HANDOFF. The wait for the buffers is limited by
+ * CY_FX_LOOP_TIMEOUT so that the thread can serve the queued requests.
+ * A buffer left by a timeout is returned again by the next call.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpLoopback (
+    void
+) {
+    CyU3PDmaBuffer_t inBuf_p, outBuf_p;
+    CyU3PReturnStatus_t status;
+
+    status = CyU3PDmaChannelGetBuffer (&glChHandleBulkLpIn, &inBuf_p, CY_FX_LOOP_TIMEOUT);
+    if (status == CY_U3P_ERROR_TIMEOUT) {
+        return CY_U3P_SUCCESS;
+    }
+    if (status != CY_U3P_SUCCESS) {
+        return status;
+    }
+
+    if (glDmaMode == CY_FX_DMA_MODE_LOOP_COPY) {
+        /*
+         * Copy the data to a buffer of the MANUAL_OUT channel.
+         */
+        status = CyU3PDmaChannelGetBuffer (&glChHandleBulkLpOut, &outBuf_p, CY_FX_LOOP_TIMEOUT);
+        if (status == CY_U3P_ERROR_TIMEOUT) {
+            return CY_U3P_SUCCESS;
+        }
+        if (status != CY_U3P_SUCCESS) {
+            return status;
+        }
+        CyU3PMemCopy (outBuf_p.buffer, inBuf_p.buffer, inBuf_p.count);
+        status = CyU3PDmaChannelCommitBuffer (&glChHandleBulkLpOut, inBuf_p.count, 0);
+        if (status != CY_U3P_SUCCESS) {
+            return status;
+        }
+        if (inBuf_p.count == 0) {
+            glInZlpSent++;
+        }
+        status = CyU3PDmaChannelDiscardBuffer (&glChHandleBulkLpIn);
+    } else {
+        /*
+         * Pass the same buffer to the consumer socket of the MANUAL channel.
+         */
+        status = CyU3PDmaChannelCommitBuffer (&glChHandleBulkLpIn, inBuf_p.count, 0);
+    }
+
+    if (status == CY_U3P_SUCCESS) {
+        glLoopStats.bytes += inBuf_p.count;
+        glLoopStats.buffers++;
+    }
+    return status;
+}
+
+/*
+ * Callback of the consumer channel of the IN endpoint in the CPU DMA modes
+ *
+ * Counts the ZLPs taken by the host. The data is counted by the channel.
+ */
+void
+CyFxBulkLpUsbConsCb (
+    CyU3PDmaChannel     *chHandle,
+    CyU3PDmaCbType_t    type,
+    CyU3PDmaCBInput_t   *input
+) {
+    if ((type == CY_U3P_DMA_CB_CONS_EVENT) && (input->buffer_p.count == 0)) {
+        glInZlpDone++;
     }
+}
 
-    /*
-     * Negate Slave Select output
-     * This indicates the end of SPI transfer.
-     */
-    CyU3PSpiSetSsnLine (CyTrue);
+/*
+ * Wait until the host has taken the data sent to the IN endpoint
+ *
+ * Called before the channels are re-created by SET_DMA_MODE and
+ * SET_BURST, so that the data of a READ served before is not flushed.
+ * The wait is given up after CY_FX_DRAIN_TIMEOUT if the host does not
+ * read the data. The loopback of CY_FX_DMA_MODE_LOOP_HANDOFF and
+ * CY_FX_DMA_MODE_LOOP_AUTO is not waited for.
+ */
+void
+CyFxBulkLpInDrain (
+    void
+) {
+    CyU3PDmaState_t state;
+    uint32_t prodXferCount, consXferCount;
+    uint32_t start = CyU3PGetTime ();
 
-    /*
-     * Stop Block Transfer of SPI
-     * Disable the block transfer mode of SPI to disconnect
-     * from the DMA channel.
-     */
-    CyU3PSpiDisableBlockXfer (CyFalse, CyTrue);
+    if ((glDmaMode == CY_FX_DMA_MODE_LOOP_HANDOFF) || (glDmaMode == CY_FX_DMA_MODE_LOOP_AUTO)) {
+        return;
+    }
 
-    return CY_U3P_SUCCESS;
+    while (CyU3PDmaChannelGetStatus (&glChHandleBulkLpOut, &state,
+                &prodXferCount, &consXferCount) == CY_U3P_SUCCESS) {
+        if ((consXferCount == prodXferCount) && (glInZlpDone == glInZlpSent)) {
+            break;
+        }
+        if (CyU3PGetTime () - start >= CY_FX_DRAIN_TIMEOUT) {
+            CyU3PDebugPrint (4, "IN endpoint not drained, %d bytes left\r\n", prodXferCount - consXferCount);
+            break;
+        }
+        CyU3PThreadSleep (1);
+    }
 }
 
 /*
- * Write a data packet to the specified sector
- *
- * Parameters
- *
- * uint16_t sector
- *     The sector number where the data to be written is located.
- *     The maximum number is specified in the header file.
- *     No sector number validation is implemented in this function.
- * uint8_t *buffer
- *     Buffer address where the data to be written is stored.
- *     The buffer should be a 32 byte aligned address because the
- *     value is directly used for the DMA channel buffer.
- * uint16_t byteCount
- *     The number of bytes to be written to the SPI FRAM.
- *     The maximum byte count is specified in the header file.
+ * Change the DMA mode of the FRAM READ/WRITE requests
  *
+ * The DMA channels for the new mode are created after the host has
+ * taken the data of the requests served before. The requests queued
+ * after this one are kept. In the direct mode the SPI sockets are
+ * connected to the USB endpoints, so the channels between the CPU and
+ * SPI are destroyed.
  */
 CyU3PReturnStatus_t
-CyFxBulkLpFramWrite (
-    uint16_t    sector,
-    uint8_t     *buffer,
-    uint16_t    byteCount
+CyFxBulkLpSetDmaMode (
+    uint8_t     mode
 ) {
-    CyU3PDmaBuffer_t outBuf_p;
-    uint8_t wren[1] = {0x06};  // WREN command
-    uint8_t location[4];
-    uint32_t byteAddress = 0;
+    CyBool_t isActive = glIsApplnActive;
     CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
 
-    /*
-     * Do nothing if 0 Byte data is required
-     */
-    if (byteCount == 0) {
+    if (mode == glDmaMode) {
         return CY_U3P_SUCCESS;
     }
 
-    /*
-     * Calculate the address of the sector on the SPI FRAM
-     * The address is calculated by the sector size specified
-     * in the header file.
-     */
-    byteAddress  = CY_FX_SECTOR_SIZE * sector;
-    CyU3PDebugPrint (2, "SPI FRAM write - addr: 0x%x, size: 0x%x.\r\n",
-            byteAddress, byteCount);
-
-    /*
-     * Prepare WRITE command for SPI FRAM
-     * A command code and three byte address are provided as preamble.
-     */
-    location[0] = 0x02; /* Write command */
-    location[1] = (byteAddress >> 16) & 0xFF;       /* MS byte */
-    location[2] = (byteAddress >> 8) & 0xFF;
-    location[3] = byteAddress & 0xFF;               /* LS byte */
+    if (isActive) {
+        CyFxBulkLpInDrain ();
+        CyFxBulkLpApplnTeardown ();
+    }
 
     /*
-     * Prepare DMA buffer descriptor for SPI FRAM
-     * Prepare DMA buffer descriptor for the SPI FRAM
-     * The size field have the size of the DMA buffer.
-     * The count field has the byte count to be written.
+     * The SPI channels are re-created because the callback of the
+     * SPI Tx channel depends on the mode.
      */
-    outBuf_p.buffer = buffer;
-    outBuf_p.status = 0;
-    outBuf_p.size   = CY_FX_BULKLP_DMA_BUF_SIZE;
-    outBuf_p.count  = byteCount;
+    if (glDmaMode != CY_FX_DMA_MODE_DIRECT) {
+        CyU3PDmaChannelDestroy (&glSpiTxHandle);
+        CyU3PDmaChannelDestroy (&glSpiRxHandle);
+    }
+    glDmaMode = mode;
+    if (mode != CY_FX_DMA_MODE_DIRECT) {
+        status = CyFxBulkLpSpiDmaCreate ();
+    }
 
-    /*
-     * Send WREN command to enable WRITE operations
-     * WREN command should be issued prior the WRITE command.
-     */
-    CyU3PSpiSetSsnLine (CyFalse);
-    status = CyU3PSpiTransmitWords (wren, 1);
-    CyU3PSpiSetSsnLine (CyTrue);
-    if (status != CY_U3P_SUCCESS)
-    {
-        CyU3PDebugPrint (2, "FRAM WREN command failed\n\r");
-        return status;
+    if (isActive) {
+        CyFxBulkLpApplnStart ();
     }
 
-    /*
-     * Assert Slave Select output
-     * A SPI transfer begins.
-     */
-    CyU3PSpiSetSsnLine (CyFalse);
+    return status;
+}
 
-    /*
-     * Send a WRITE command to the SPI FRAM
-     */
-    status = CyU3PSpiTransmitWords (location, 4);
-    if (status != CY_U3P_SUCCESS)
-    {
-        CyU3PDebugPrint (2, "SPI WRITE command failed\r\n");
-        CyU3PSpiSetSsnLine (CyTrue);
-        return status;
+/*
+ * Change the burst length of the SuperSpeed endpoints
+ *
+ * The endpoints are re-configured by re-creating the channels as
+ * SET_DMA_MODE does. The descriptors keep advertising CY_FX_EP_BURST_MAX,
+ * so the device does not have to re-enumerate.
+ */
+void
+CyFxBulkLpSetBurst (
+    uint8_t     burstLength
+) {
+    if (burstLength == glBurstLength) {
+        return;
     }
 
-    /*
-     * Prepare SPI transfer for WRITE
-     * This API specifies how many words will be written to the SPI.
-     * In the other words, this specifies the number of SCK pulses
-     * to be generated.
-     */
-    CyU3PSpiSetBlockXfer (byteCount, 0);
+    glBurstLength = burstLength;
+    if (glIsApplnActive) {
+        CyFxBulkLpInDrain ();
+        CyFxBulkLpApplnTeardown ();
+        CyFxBulkLpApplnStart ();
+    }
+}
+
+/*
+ * Serve a READ/WRITE request taken from the queue
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpCmdExecute (
+    CyFxBulkLpCmd_t *cmd_p
+) {
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
 
     /*
-     * Connect the DMA buffer to DMA Channel
-     * The DMA buffer descriptor is provided to the DMA Channel
-     * to write the data to the SPI FRAM.
+     * The endpoints are used by the loopback in the loopback modes,
+     * so the requests with BULK data are ignored.
      */
-    status = CyU3PDmaChannelSetupSendBuffer (&glSpiTxHandle, &outBuf_p);
-    if (status != CY_U3P_SUCCESS)
-    {
-        CyU3PSpiSetSsnLine (CyTrue);
-        return status;
+    if (CY_FX_DMA_MODE_IS_LOOP (glDmaMode)) {
+        switch (cmd_p->request) {
+            case CY_FX_RQT_FRAM_WRITE:
+            case CY_FX_RQT_FRAM_WRITE_MULTI:
+            case CY_FX_RQT_FRAM_READ:
+            case CY_FX_RQT_FRAM_READ_MULTI:
+            case CY_FX_RQT_FRAM_WRITE_BYTES:
+            case CY_FX_RQT_FRAM_READ_BYTES:
+                return CY_U3P_SUCCESS;
+            default:
+                break;
+        }
     }
 
-    /*
-     * Wait for the DMA Channel completed
-     * This API returns when all data stored in the DMA buffer are sent.
-     */
-    status = CyU3PDmaChannelWaitForCompletion(&glSpiTxHandle,
-            CY_FX_FRAM_TIMEOUT);
-    if (status != CY_U3P_SUCCESS)
-    {
-        CyU3PSpiSetSsnLine (CyTrue);
-        return status;
+    switch (cmd_p->request) {
+        case CY_FX_RQT_FRAM_WRITE:
+        case CY_FX_RQT_FRAM_WRITE_MULTI:
+            /*
+             * Write the data packets received from the producer socket (OUT endpoint)
+             * to FRAM at the sectors specified by the FRAM_WRITE control request.
+             */
+            status = CyFxBulkLpFramWriteSectors (cmd_p->address, cmd_p->nSectors, cmd_p->byteCount);
+            break;
+        case CY_FX_RQT_FRAM_READ:
+        case CY_FX_RQT_FRAM_READ_MULTI:
+            /*
+             * Read data packets from FRAM at the sectors specified by the
+             * FRAM_READ control request and send them to the consumer
+             * socket (IN endpoint).
+             */
+            status = CyFxBulkLpFramReadSectors (cmd_p->address, cmd_p->nSectors, cmd_p->byteCount);
+            break;
+        case CY_FX_RQT_FRAM_WRITE_BYTES:
+            status = CyFxBulkLpFramWriteBytes (cmd_p->address, cmd_p->byteCount);
+            break;
+        case CY_FX_RQT_FRAM_READ_BYTES:
+            status = CyFxBulkLpFramReadBytes (cmd_p->address, cmd_p->byteCount);
+            break;
+        case CY_FX_RQT_FRAM_CRC:
+            status = CyFxBulkLpFramCrc (cmd_p->address, cmd_p->byteCount, &glCrcResult.crc);
+            glCrcResult.byteAddress = cmd_p->address;
+            glCrcResult.byteCount   = cmd_p->byteCount;
+            glCrcResult.ready       = (status == CY_U3P_SUCCESS) ? 1 : 0;
+            break;
+        case CY_FX_RQT_PATTERN_SEND:
+            if (CY_FX_DMA_MODE_IS_CPU (glDmaMode)) {
+                status = CyFxBulkLpPatternSend (cmd_p->byteCount);
+            }
+            break;
+        case CY_FX_RQT_PATTERN_CHECK:
+            if (CY_FX_DMA_MODE_IS_CPU (glDmaMode)) {
+                status = CyFxBulkLpPatternCheck (cmd_p->byteCount);
+            }
+            break;
+        case CY_FX_RQT_SET_DMA_MODE:
+            status = CyFxBulkLpSetDmaMode (cmd_p->byteCount);
+            break;
+        case CY_FX_RQT_SET_BURST:
+            CyFxBulkLpSetBurst (cmd_p->byteCount);
+            break;
+        case CY_FX_RQT_SECTOR_CACHE:
+            CyFxBulkLpCacheEnable (cmd_p->byteCount != 0);
+            break;
+        case CY_FX_RQT_SET_VERIFY:
+            /*
+             * The setting changes between the requests, so a WRITE
+             * queued before is served with the previous setting.
+             */
+            glVerifyWrite = (cmd_p->byteCount != 0);
+            break;
+        case CY_FX_RQT_SPI_CLOCK:
+            /*
+             * Override the SPI clock setting in kHz, or restart the
+             * calibration when the clock is 0.
+             */
+            if (cmd_p->byteCount == 0) {
+                status = CyFxBulkLpSpiCalibrate ();
+            } else {
+                status = CyFxBulkLpSpiSetClock ((uint32_t)cmd_p->byteCount * 1000,
+                        (cmd_p->address != 0));
+            }
+            break;
+        default:
+            break;
     }
 
-    /*
-     * Negate Slave Select output
-     * This indicates the end of SPI transfer.
-     */
-    CyU3PSpiSetSsnLine (CyTrue);
+    return status;
+}
 
-    /*
-     * Stop Block Transfer of SPI
-     * Disable the block transfer mode of SPI to disconnect
-     * from the DMA channel.
-     */
-    CyU3PSpiDisableBlockXfer (CyTrue, CyFalse);
+/*
+ * Wait until the SPI worker thread completes all the passed requests
+ */
+void
+CyFxBulkLpSpiWaitIdle (
+    void
+) {
+    uint32_t eventFlags;
 
-    return CY_U3P_SUCCESS;
+    while (glSpiJobsDone != glSpiJobsSent) {
+        CyU3PEventGet (&glSpiEvent, CY_FX_SPI_JOB_DONE, CYU3P_EVENT_OR_CLEAR,
+                &eventFlags, CYU3P_WAIT_FOREVER);
+    }
+}
+
+/*
+ * Serve a request taken from the queue or pass it to the SPI worker thread
+ *
+ * The requests which use only the SPI FRAM are served by the SPI worker
+ * thread, so the application thread goes on with the USB side requests
+ * and the loopback meanwhile. Any other request using the SPI waits
+ * until the worker is idle to keep the order of the FRAM accesses.
+ */
+CyU3PReturnStatus_t
+CyFxBulkLpCmdDispatch (
+    CyFxBulkLpCmd_t *cmd_p
+) {
+    CyU3PReturnStatus_t status;
+
+    switch (cmd_p->request) {
+        case CY_FX_RQT_FRAM_CRC:
+        case CY_FX_RQT_SPI_CLOCK:
+            glSpiJobsSent++;
+            status = CyU3PQueueSend (&glSpiQueue, cmd_p, CYU3P_WAIT_FOREVER);
+            if (status != CY_U3P_SUCCESS) {
+                glSpiJobsSent--;
+            }
+            return status;
+        case CY_FX_RQT_PATTERN_SEND:
+        case CY_FX_RQT_PATTERN_CHECK:
+            /* The SPI is not used. */
+            break;
+        default:
+            CyFxBulkLpSpiWaitIdle ();
+            CyU3PMutexGet (&glSpiLock, CYU3P_WAIT_FOREVER);
+            status = CyFxBulkLpCmdExecute (cmd_p);
+            CyU3PMutexPut (&glSpiLock);
+            return status;
+    }
+
+    return CyFxBulkLpCmdExecute (cmd_p);
 }
 
 /* This function starts the bulk loop application. This is called
@@ -526,7 +3033,7 @@ CyFxBulkLpApplnStart (
     CyU3PMemSet ((uint8_t *)&epCfg, 0, sizeof (epCfg));
     epCfg.enable = CyTrue;
     epCfg.epType = CY_U3P_USB_EP_BULK;
-    epCfg.burstLen = 1;
+    epCfg.burstLen = (usbSpeed == CY_U3P_SUPER_SPEED) ? glBurstLength : 1;
     epCfg.streams = 0;
     epCfg.pcktSize = size;
     glPacketSize = size;
@@ -551,12 +3058,10 @@ CyFxBulkLpApplnStart (
     CyU3PUsbFlushEp(CY_FX_EP_PRODUCER);
     CyU3PUsbFlushEp(CY_FX_EP_CONSUMER);
 
-    /* Create a DMA MANUAL_IN channel for the producer socket. */
     // The DMA channel buffer size is independent to the USB bus speed.
-    dmaCfg.size  = CY_FX_BULKLP_DMA_BUF_SIZE;
-    dmaCfg.count = CY_FX_BULKLP_DMA_BUF_COUNT;
-    dmaCfg.prodSckId = CY_FX_EP_PRODUCER_SOCKET;
-    dmaCfg.consSckId = CY_U3P_CPU_SOCKET_CONS;
+    // Multiple chunk buffers are used to overlap the USB and SPI transfers.
+    dmaCfg.size  = CY_FX_BULKLP_DMA_CHUNK_SIZE;
+    dmaCfg.count = CY_FX_BULKLP_DMA_CHUNK_COUNT;
     dmaCfg.dmaMode = CY_U3P_DMA_MODE_BYTE;
     /* No callback is required. */
     dmaCfg.notification = 0;
@@ -566,50 +3071,137 @@ CyFxBulkLpApplnStart (
     dmaCfg.consHeader = 0;
     dmaCfg.prodAvailCount = 0;
 
-    apiRetStatus = CyU3PDmaChannelCreate (&glChHandleBulkLpIn,
-            CY_U3P_DMA_TYPE_MANUAL_IN, &dmaCfg);
-    if (apiRetStatus != CY_U3P_SUCCESS)
+    if (glDmaMode == CY_FX_DMA_MODE_DIRECT)
     {
-        CyU3PDebugPrint (4, "CyU3PDmaChannelCreate failed, Error code = %d\n", apiRetStatus);
-        CyFxAppErrorHandler(apiRetStatus);
-    }
+        /* Create a DMA AUTO channel from the producer socket to the SPI block.
+         * The transfer size is set for each request. */
+        dmaCfg.prodSckId = CY_FX_EP_PRODUCER_SOCKET;
+        dmaCfg.consSckId = CY_U3P_LPP_SOCKET_SPI_CONS;
+        apiRetStatus = CyU3PDmaChannelCreate (&glChHandleBulkLpIn,
+                CY_U3P_DMA_TYPE_AUTO, &dmaCfg);
+        if (apiRetStatus != CY_U3P_SUCCESS)
+        {
+            CyU3PDebugPrint (4, "CyU3PDmaChannelCreate failed, Error code = %d\n", apiRetStatus);
+            CyFxAppErrorHandler(apiRetStatus);
+        }
 
-    /* Create a DMA MANUAL_OUT channel for the consumer socket. */
-    dmaCfg.prodSckId = CY_U3P_CPU_SOCKET_PROD;
-    dmaCfg.consSckId = CY_FX_EP_CONSUMER_SOCKET;
-    apiRetStatus = CyU3PDmaChannelCreate (&glChHandleBulkLpOut,
-            CY_U3P_DMA_TYPE_MANUAL_OUT, &dmaCfg);
-    if (apiRetStatus != CY_U3P_SUCCESS)
-    {
-        CyU3PDebugPrint (4, "CyU3PDmaChannelCreate failed, Error code = %d\n", apiRetStatus);
-        CyFxAppErrorHandler(apiRetStatus);
+        /* Create a DMA AUTO channel from the SPI block to the consumer socket. */
+        dmaCfg.prodSckId = CY_U3P_LPP_SOCKET_SPI_PROD;
+        dmaCfg.consSckId = CY_FX_EP_CONSUMER_SOCKET;
+        apiRetStatus = CyU3PDmaChannelCreate (&glChHandleBulkLpOut,
+                CY_U3P_DMA_TYPE_AUTO, &dmaCfg);
+        if (apiRetStatus != CY_U3P_SUCCESS)
+        {
+            CyU3PDebugPrint (4, "CyU3PDmaChannelCreate failed, Error code = %d\n", apiRetStatus);
+            CyFxAppErrorHandler(apiRetStatus);
+        }
     }
-
-    /* Set DMA Channel transfer size */
-    apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleBulkLpIn, CY_FX_BULKLP_DMA_TX_SIZE);
-    if (apiRetStatus != CY_U3P_SUCCESS)
+    else if ((glDmaMode == CY_FX_DMA_MODE_LOOP_HANDOFF) || (glDmaMode == CY_FX_DMA_MODE_LOOP_AUTO))
     {
-        CyU3PDebugPrint (4, "CyU3PDmaChannelSetXfer Failed, Error code = %d\n", apiRetStatus);
-        CyFxAppErrorHandler(apiRetStatus);
-    }
+        /* Create a single DMA channel from the producer socket to the consumer socket.
+         * The CPU commits each buffer of the MANUAL channel, and the AUTO channel
+         * forwards the buffers without the CPU. */
+        dmaCfg.prodSckId = CY_FX_EP_PRODUCER_SOCKET;
+        dmaCfg.consSckId = CY_FX_EP_CONSUMER_SOCKET;
+        apiRetStatus = CyU3PDmaChannelCreate (&glChHandleBulkLpIn,
+                (glDmaMode == CY_FX_DMA_MODE_LOOP_AUTO) ? CY_U3P_DMA_TYPE_AUTO : CY_U3P_DMA_TYPE_MANUAL,
+                &dmaCfg);
+        if (apiRetStatus != CY_U3P_SUCCESS)
+        {
+            CyU3PDebugPrint (4, "CyU3PDmaChannelCreate failed, Error code = %d\n", apiRetStatus);
+            CyFxAppErrorHandler(apiRetStatus);
+        }
 
-    apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleBulkLpOut, CY_FX_BULKLP_DMA_TX_SIZE);
-    if (apiRetStatus != CY_U3P_SUCCESS)
+        /* Set DMA Channel transfer size */
+        apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleBulkLpIn, CY_FX_BULKLP_DMA_TX_SIZE);
+        if (apiRetStatus != CY_U3P_SUCCESS)
+        {
+            CyU3PDebugPrint (4, "CyU3PDmaChannelSetXfer Failed, Error code = %d\n", apiRetStatus);
+            CyFxAppErrorHandler(apiRetStatus);
+        }
+    }
+    else
     {
-        CyU3PDebugPrint (4, "CyU3PDmaChannelSetXfer Failed, Error code = %d\n", apiRetStatus);
-        CyFxAppErrorHandler(apiRetStatus);
+        /* Create a DMA MANUAL_IN channel for the producer socket.
+         * A received chunk advances a callback driven WRITE. */
+        dmaCfg.prodSckId = CY_FX_EP_PRODUCER_SOCKET;
+        dmaCfg.consSckId = CY_U3P_CPU_SOCKET_CONS;
+        if (glDmaMode == CY_FX_DMA_MODE_CALLBACK)
+        {
+            dmaCfg.notification = CY_U3P_DMA_CB_PROD_EVENT;
+            dmaCfg.cb = CyFxBulkLpUsbDmaCb;
+        }
+        /* The header space in front of each chunk takes the FRAM WRITE command. */
+        dmaCfg.size = CY_FX_BULKLP_DMA_CHUNK_SIZE + CY_FX_FRAM_HEADER_SIZE;
+        dmaCfg.prodHeader = CY_FX_FRAM_HEADER_SIZE;
+        apiRetStatus = CyU3PDmaChannelCreate (&glChHandleBulkLpIn,
+                CY_U3P_DMA_TYPE_MANUAL_IN, &dmaCfg);
+        if (apiRetStatus != CY_U3P_SUCCESS)
+        {
+            CyU3PDebugPrint (4, "CyU3PDmaChannelCreate failed, Error code = %d\n", apiRetStatus);
+            CyFxAppErrorHandler(apiRetStatus);
+        }
+        dmaCfg.size = CY_FX_BULKLP_DMA_CHUNK_SIZE;
+        dmaCfg.prodHeader = 0;
+
+        /* Create a DMA MANUAL_OUT channel for the consumer socket.
+         * The ZLPs taken by the host are counted for CyFxBulkLpInDrain. */
+        dmaCfg.notification = CY_U3P_DMA_CB_CONS_EVENT;
+        dmaCfg.cb = CyFxBulkLpUsbConsCb;
+        dmaCfg.prodSckId = CY_U3P_CPU_SOCKET_PROD;
+        dmaCfg.consSckId = CY_FX_EP_CONSUMER_SOCKET;
+        apiRetStatus = CyU3PDmaChannelCreate (&glChHandleBulkLpOut,
+                CY_U3P_DMA_TYPE_MANUAL_OUT, &dmaCfg);
+        if (apiRetStatus != CY_U3P_SUCCESS)
+        {
+            CyU3PDebugPrint (4, "CyU3PDmaChannelCreate failed, Error code = %d\n", apiRetStatus);
+            CyFxAppErrorHandler(apiRetStatus);
+        }
+
+        /* Set DMA Channel transfer size */
+        apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleBulkLpIn, CY_FX_BULKLP_DMA_TX_SIZE);
+        if (apiRetStatus != CY_U3P_SUCCESS)
+        {
+            CyU3PDebugPrint (4, "CyU3PDmaChannelSetXfer Failed, Error code = %d\n", apiRetStatus);
+            CyFxAppErrorHandler(apiRetStatus);
+        }
+
+        apiRetStatus = CyU3PDmaChannelSetXfer (&glChHandleBulkLpOut, CY_FX_BULKLP_DMA_TX_SIZE);
+        if (apiRetStatus != CY_U3P_SUCCESS)
+        {
+            CyU3PDebugPrint (4, "CyU3PDmaChannelSetXfer Failed, Error code = %d\n", apiRetStatus);
+            CyFxAppErrorHandler(apiRetStatus);
+        }
     }
 
     /* Update the flag so that the application thread is notified of this. */
+    glInZlpSent = 0;
+    glInZlpDone = 0;
     glIsApplnActive = CyTrue;
+
+    /* The transfer counts of the new channels start from 0. */
+    CyFxBulkLpLoopReset ();
 }
 
 /* This function stops the bulk loop application. This shall be called whenever
- * a RESET or DISCONNECT event is received from the USB host. The endpoints are
- * disabled and the DMA pipe is destroyed by this function. */
+ * a RESET or DISCONNECT event is received from the USB host. The queued requests
+ * are dropped, and the endpoints and the DMA pipe are torn down. */
 void
 CyFxBulkLpApplnStop (
         void)
+{
+    CyFxBulkLpApplnTeardown ();
+
+    /* Drop the requests which are not served yet. */
+    CyFxBulkLpCmdFlush ();
+}
+
+/* This function disables the endpoints and destroys the DMA pipe. The queued
+ * requests are kept, so SET_DMA_MODE and SET_BURST call this from the
+ * application thread before the application is started again. */
+void
+CyFxBulkLpApplnTeardown (
+        void)
 {
     CyU3PEpConfig_t epCfg;
     CyU3PReturnStatus_t apiRetStatus = CY_U3P_SUCCESS;
@@ -619,7 +3211,9 @@ CyFxBulkLpApplnStop (
 
     /* Destroy the channels */
     CyU3PDmaChannelDestroy (&glChHandleBulkLpIn);
-    CyU3PDmaChannelDestroy (&glChHandleBulkLpOut);
+    if ((glDmaMode != CY_FX_DMA_MODE_LOOP_HANDOFF) && (glDmaMode != CY_FX_DMA_MODE_LOOP_AUTO)) {
+        CyU3PDmaChannelDestroy (&glChHandleBulkLpOut);
+    }
 
     /* Flush the endpoint memory */
     CyU3PUsbFlushEp(CY_FX_EP_PRODUCER);
@@ -646,6 +3240,33 @@ CyFxBulkLpApplnStop (
     }
 }
 
+/*
+ * Receive a byte range in the data stage of a control request
+ *
+ * Returns CyTrue when the range is received and is within the FRAM
+ * excluding the scratch area at the end.
+ */
+CyBool_t
+CyFxBulkLpGetByteRange (
+    uint16_t                wLength,
+    CyFxBulkLpByteRange_t   *range_p
+) {
+    uint16_t readCount = 0;
+    uint32_t limit = glFramGeometry.capacity - CY_FX_FRAM_SCRATCH_SIZE;
+
+    if (wLength != sizeof (CyFxBulkLpByteRange_t)) {
+        return CyFalse;
+    }
+    if ((CyU3PUsbGetEP0Data (wLength, glEp0Buffer, &readCount) != CY_U3P_SUCCESS) ||
+            (readCount != sizeof (CyFxBulkLpByteRange_t))) {
+        return CyFalse;
+    }
+    CyU3PMemCopy ((uint8_t *)range_p, glEp0Buffer, sizeof (CyFxBulkLpByteRange_t));
+
+    return ((range_p->byteCount != 0) && (range_p->byteAddress < limit) &&
+            (range_p->byteCount <= (limit - range_p->byteAddress)));
+}
+
 /* Callback to handle the USB setup requests. */
 CyBool_t
 CyFxBulkLpApplnUSBSetupCB (
@@ -659,8 +3280,14 @@ CyFxBulkLpApplnUSBSetupCB (
 
     uint8_t  bRequest, bReqType;
     uint8_t  bType, bTarget;
-    uint16_t wValue, wIndex;
+    uint16_t wValue, wIndex, wLength;
+    CyFxBulkLpByteRange_t range;
+    uint32_t byteAddress;
+    uint16_t readCount = 0;
+    CyU3PDmaState_t state;
+    uint32_t prodXferCount, consXferCount;
     CyBool_t isHandled = CyFalse;
+    CyBool_t isReconfig;
     CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
 
     /* Decode the fields from the setup request. */
@@ -670,6 +3297,7 @@ CyFxBulkLpApplnUSBSetupCB (
     bRequest = ((setupdat0 & CY_U3P_USB_REQUEST_MASK) >> CY_U3P_USB_REQUEST_POS);
     wValue   = ((setupdat0 & CY_U3P_USB_VALUE_MASK)   >> CY_U3P_USB_VALUE_POS);
     wIndex   = ((setupdat1 & CY_U3P_USB_INDEX_MASK)   >> CY_U3P_USB_INDEX_POS);
+    wLength  = ((setupdat1 & CY_U3P_USB_LENGTH_MASK)  >> CY_U3P_USB_LENGTH_POS);
 
     if (bType == CY_U3P_USB_STANDARD_RQT)
     {
@@ -714,30 +3342,312 @@ CyFxBulkLpApplnUSBSetupCB (
                     CyU3PUsbAckSetup ();
                     isHandled = CyTrue;
                 }
-            }
-        }
-    }
-
-    /* Handle supported vendor requests. */
-    if (bType == CY_U3P_USB_VENDOR_RQT) {
-        switch (bRequest) {
-            case CY_FX_RQT_FRAM_WRITE:
-                if (wIndex < CY_FX_N_SECTORS) {
-                    glSectorToWrite = wIndex;
-                    CyU3PEventSet (&glFramEvent, CY_FX_FRAM_WRITE_READY, CYU3P_EVENT_OR);
+            }
+        }
+    }
+
+    /* Handle supported vendor requests. */
+    if (bType == CY_U3P_USB_VENDOR_RQT) {
+        /*
+         * The requests with BULK data are stalled until a SET_DMA_MODE or
+         * SET_BURST queued before them is served, as the data would go to
+         * the channels which are re-created.
+         */
+        isReconfig = CyFxBulkLpCmdReconfigPending ();
+
+        switch (bRequest) {
+            case CY_FX_RQT_FRAM_WRITE:
+                /*
+                 * The direct mode takes the size from wValue, so a WRITE
+                 * without it would leave the BULK data in the channel.
+                 */
+                if ((!isReconfig) &&
+                        ((wValue != 0) || (glDmaMode != CY_FX_DMA_MODE_DIRECT)) &&
+                        (wIndex < glFramGeometry.nSectors) && (wValue <= CY_FX_BULKLP_DMA_BUF_SIZE) &&
+                        (CyFxBulkLpCmdPut (bRequest, wIndex, 1, wValue))) {
+                    CyU3PUsbAckSetup();
+                    isHandled = CyTrue;
+                }
+                break;
+            case CY_FX_RQT_FRAM_READ:
+                if ((!isReconfig) &&
+                        (wIndex < glFramGeometry.nSectors) && (wValue <= CY_FX_BULKLP_DMA_BUF_SIZE) &&
+                        (CyFxBulkLpCmdPut (bRequest, wIndex, 1, wValue))) {
+                    CyU3PUsbAckSetup();
+                    isHandled = CyTrue;
+                }
+                break;
+            case CY_FX_RQT_FRAM_WRITE_MULTI:
+                if ((!isReconfig) &&
+                        (wValue > 0) && (wIndex < glFramGeometry.nSectors) && (wValue <= (glFramGeometry.nSectors - wIndex)) &&
+                        (CyFxBulkLpCmdPut (bRequest, wIndex, wValue, CY_FX_BULKLP_DMA_BUF_SIZE))) {
+                    CyU3PUsbAckSetup();
+                    isHandled = CyTrue;
+                }
+                break;
+            case CY_FX_RQT_FRAM_READ_MULTI:
+                if ((!isReconfig) &&
+                        (wValue > 0) && (wIndex < glFramGeometry.nSectors) && (wValue <= (glFramGeometry.nSectors - wIndex)) &&
+                        (CyFxBulkLpCmdPut (bRequest, wIndex, wValue, CY_FX_BULKLP_DMA_BUF_SIZE))) {
                     CyU3PUsbAckSetup();
                     isHandled = CyTrue;
                 }
                 break;
-            case CY_FX_RQT_FRAM_READ:
-                if (wIndex < CY_FX_N_SECTORS) {
-                    glSectorToRead = wIndex;
-                    glSizeToRead = wValue;
-                    CyU3PEventSet (&glFramEvent, CY_FX_FRAM_READ_READY, CYU3P_EVENT_OR);
+            case CY_FX_RQT_FRAM_WRITE_BYTES:
+            case CY_FX_RQT_FRAM_READ_BYTES:
+                /*
+                 * The byte range is received in the data stage.
+                 */
+                if ((isReconfig) || (!CyFxBulkLpGetByteRange (wLength, &range)) ||
+                        (!CyFxBulkLpCmdPut (bRequest, range.byteAddress, 1, range.byteCount))) {
+                    CyU3PUsbStall (0, CyTrue, CyFalse);
+                }
+                isHandled = CyTrue;
+                break;
+            case CY_FX_RQT_FRAM_CRC:
+                if ((bReqType & 0x80) != 0) {
+                    /*
+                     * Return the CRC result in the data stage.
+                     */
+                    CyU3PMemCopy (glEp0Buffer, (uint8_t *)&glCrcResult, sizeof (glCrcResult));
+                    if (wLength > sizeof (glCrcResult)) {
+                        wLength = sizeof (glCrcResult);
+                    }
+                    status = CyU3PUsbSendEP0Data (wLength, glEp0Buffer);
+                    isHandled = CyTrue;
+                } else if (wLength == 0) {
+                    /*
+                     * CRC of the top of a sector.
+                     * The result is cleared before the request is queued.
+                     */
+                    glCrcResult.ready = 0;
+                    if ((wIndex < glFramGeometry.nSectors) && (wValue <= CY_FX_BULKLP_DMA_BUF_SIZE) &&
+                            (CyFxBulkLpCmdPut (bRequest, CY_FX_SECTOR_SIZE * wIndex, 0,
+                                    (wValue == 0) ? CY_FX_BULKLP_DMA_BUF_SIZE : wValue))) {
+                        CyU3PUsbAckSetup();
+                        isHandled = CyTrue;
+                    }
+                } else {
+                    /*
+                     * CRC of the byte range received in the data stage.
+                     */
+                    glCrcResult.ready = 0;
+                    if ((!CyFxBulkLpGetByteRange (wLength, &range)) ||
+                            (!CyFxBulkLpCmdPut (bRequest, range.byteAddress, 0, range.byteCount))) {
+                        CyU3PUsbStall (0, CyTrue, CyFalse);
+                    }
+                    isHandled = CyTrue;
+                }
+                break;
+            case CY_FX_RQT_SET_VERIFY:
+                if ((wValue <= 1) &&
+                        (CyFxBulkLpCmdPut (bRequest, 0, 0, wValue))) {
+                    CyU3PUsbAckSetup();
+                    isHandled = CyTrue;
+                }
+                break;
+            case CY_FX_RQT_SET_BURST:
+                if ((wValue >= 1) && (wValue <= CY_FX_EP_BURST_MAX) &&
+                        (CyFxBulkLpCmdPut (bRequest, 0, 0, wValue))) {
+                    glCmdReconfig = glCmdHead;
+                    CyU3PUsbAckSetup();
+                    isHandled = CyTrue;
+                }
+                break;
+            case CY_FX_RQT_SET_DMA_MODE:
+                if ((wValue <= CY_FX_DMA_MODE_CALLBACK) &&
+                        (CyFxBulkLpCmdPut (bRequest, 0, 0, wValue))) {
+                    glCmdReconfig = glCmdHead;
+                    CyU3PUsbAckSetup();
+                    isHandled = CyTrue;
+                }
+                break;
+            case CY_FX_RQT_SPI_CLOCK:
+                if ((bReqType & 0x80) != 0) {
+                    /*
+                     * Return the current SPI clock setting in the data stage.
+                     */
+                    CyU3PMemCopy (glEp0Buffer, (uint8_t *)&glSpiClock, sizeof (glSpiClock));
+                    if (wLength > sizeof (glSpiClock)) {
+                        wLength = sizeof (glSpiClock);
+                    }
+                    status = CyU3PUsbSendEP0Data (wLength, glEp0Buffer);
+                    isHandled = CyTrue;
+                } else if (((wValue == 0) || ((wValue >= (CY_FX_SPI_CLOCK_MIN / 1000)) &&
+                                (wValue <= (CY_FX_SPI_CLOCK_MAX / 1000)))) && (wIndex <= 1) &&
+                        (CyFxBulkLpCmdPut (bRequest, wIndex, 0, wValue))) {
+                    CyU3PUsbAckSetup();
+                    isHandled = CyTrue;
+                }
+                break;
+            case CY_FX_RQT_GET_GEOMETRY:
+                /*
+                 * Return the FRAM geometry in the data stage.
+                 */
+                CyU3PMemCopy (glEp0Buffer, (uint8_t *)&glFramGeometry, sizeof (glFramGeometry));
+                if (wLength > sizeof (glFramGeometry)) {
+                    wLength = sizeof (glFramGeometry);
+                }
+                status = CyU3PUsbSendEP0Data (wLength, glEp0Buffer);
+                isHandled = CyTrue;
+                break;
+            case CY_FX_RQT_SECTOR_CACHE:
+                if ((bReqType & 0x80) != 0) {
+                    /*
+                     * Return the sector cache statistics in the data stage.
+                     */
+                    glCacheStats.enabled = (glCacheEnabled) ? 1 : 0;
+                    CyU3PMemCopy (glEp0Buffer, (uint8_t *)&glCacheStats, sizeof (glCacheStats));
+                    if (wValue == 1) {
+                        glCacheStats.hits      = 0;
+                        glCacheStats.misses    = 0;
+                        glCacheStats.evictions = 0;
+                    }
+                    if (wLength > sizeof (glCacheStats)) {
+                        wLength = sizeof (glCacheStats);
+                    }
+                    status = CyU3PUsbSendEP0Data (wLength, glEp0Buffer);
+                    isHandled = CyTrue;
+                } else if ((wValue <= 1) &&
+                        (CyFxBulkLpCmdPut (bRequest, 0, 0, wValue))) {
+                    CyU3PUsbAckSetup();
+                    isHandled = CyTrue;
+                }
+                break;
+            case CY_FX_RQT_GET_PERF:
+                /*
+                 * Return a snapshot of the performance counters in the
+                 * data stage and start a new period.
+                 */
+                glPerfStats.period = CyU3PGetTime () - glPerfStats.period;
+                CyU3PMemCopy (glEp0Buffer, (uint8_t *)&glPerfStats, sizeof (glPerfStats));
+                CyU3PMemSet ((uint8_t *)&glPerfStats, 0, sizeof (glPerfStats));
+                glPerfStats.period = CyU3PGetTime ();
+                if (wLength > sizeof (glPerfStats)) {
+                    wLength = sizeof (glPerfStats);
+                }
+                status = CyU3PUsbSendEP0Data (wLength, glEp0Buffer);
+                isHandled = CyTrue;
+                break;
+#if (CY_FX_TRACE_ENABLE)
+            case CY_FX_RQT_GET_TRACE:
+                /*
+                 * Send the trace ring raw. The host formats the events.
+                 */
+                if (wLength > sizeof (glTrace)) {
+                    wLength = sizeof (glTrace);
+                }
+                status = CyU3PUsbSendEP0Data (wLength, (uint8_t *)&glTrace);
+                isHandled = CyTrue;
+                break;
+#endif
+            case CY_FX_RQT_PATTERN_CHECK:
+                if ((bReqType & 0x80) != 0) {
+                    /*
+                     * Return the test pattern results in the data stage.
+                     */
+                    CyU3PMemCopy (glEp0Buffer, (uint8_t *)&glPatternResult, sizeof (glPatternResult));
+                    if (wLength > sizeof (glPatternResult)) {
+                        wLength = sizeof (glPatternResult);
+                    }
+                    status = CyU3PUsbSendEP0Data (wLength, glEp0Buffer);
+                    isHandled = CyTrue;
+                    break;
+                }
+                /* Fall through to queue the request. */
+            case CY_FX_RQT_PATTERN_SEND:
+                /*
+                 * The data goes through the CPU only in the CPU DMA mode.
+                 */
+                if ((!isReconfig) && (CY_FX_DMA_MODE_IS_CPU (glDmaMode)) &&
+                        (CyFxBulkLpCmdPut (bRequest, 0, 0, ((uint32_t)wIndex << 16) | wValue))) {
                     CyU3PUsbAckSetup();
                     isHandled = CyTrue;
                 }
                 break;
+            case CY_FX_RQT_FRAM_EP0:
+                /*
+                 * A small record is transferred in the data stage and
+                 * accessed in the register mode of SPI. It is served only
+                 * when the queued requests are served, so that it is
+                 * ordered after them, and stalled otherwise.
+                 */
+                byteAddress = ((uint32_t)wIndex << 16) | wValue;
+                if ((wLength == 0) || (wLength > CY_FX_EP0_FRAM_MAX_SIZE) ||
+                        (byteAddress >= glFramGeometry.capacity - CY_FX_FRAM_SCRATCH_SIZE) ||
+                        (wLength > glFramGeometry.capacity - CY_FX_FRAM_SCRATCH_SIZE - byteAddress) ||
+                        (!CyFxBulkLpCmdIdle ())) {
+                    break;
+                }
+                if ((bReqType & 0x80) != 0) {
+                    if (CyU3PMutexGet (&glSpiLock, CY_FX_EP0_SPI_TIMEOUT) != CY_U3P_SUCCESS) {
+                        break;
+                    }
+                    status = CyFxBulkLpFramReadRegister (byteAddress, glEp0Buffer, wLength);
+                    CyU3PMutexPut (&glSpiLock);
+                    if (status == CY_U3P_SUCCESS) {
+                        status = CyU3PUsbSendEP0Data (wLength, glEp0Buffer);
+                    }
+                    isHandled = CyTrue;
+                } else {
+                    status = CyU3PUsbGetEP0Data (wLength, glEp0Buffer, &readCount);
+                    if ((status == CY_U3P_SUCCESS) && (readCount == wLength) &&
+                            (CyU3PMutexGet (&glSpiLock, CY_FX_EP0_SPI_TIMEOUT) == CY_U3P_SUCCESS)) {
+                        CyFxBulkLpCacheInvalidate (byteAddress, wLength);
+                        status = CyFxBulkLpFramWriteRegister (byteAddress, glEp0Buffer, wLength);
+                        CyU3PMutexPut (&glSpiLock);
+                    } else {
+                        status = CY_U3P_ERROR_FAILURE;
+                    }
+                    /* The data stage is over, so EP0 is stalled for the status stage. */
+                    if (status != CY_U3P_SUCCESS) {
+                        CyU3PUsbStall (0, CyTrue, CyFalse);
+                        status = CY_U3P_SUCCESS;
+                    }
+                    isHandled = CyTrue;
+                }
+                break;
+            case CY_FX_RQT_GET_LOOP_STATS:
+                /*
+                 * Return a snapshot of the loopback counters in the data stage.
+                 * The AUTO channel counts the bytes by itself.
+                 */
+                if (glIsApplnActive && (glDmaMode == CY_FX_DMA_MODE_LOOP_AUTO)) {
+                    if (CyU3PDmaChannelGetStatus (&glChHandleBulkLpIn, &state,
+                                &prodXferCount, &consXferCount) == CY_U3P_SUCCESS) {
+                        glLoopStats.bytes = consXferCount - glLoopAutoBase;
+                    }
+                }
+                glLoopStats.mode = glDmaMode;
+                CyU3PMemCopy (glEp0Buffer, (uint8_t *)&glLoopStats, sizeof (glLoopStats));
+                ((CyFxBulkLpLoopStats_t *)glEp0Buffer)->period = CyU3PGetTime () - glLoopStats.period;
+                if (wValue == 1) {
+                    CyFxBulkLpLoopReset ();
+                }
+                if (wLength > sizeof (glLoopStats)) {
+                    wLength = sizeof (glLoopStats);
+                }
+                status = CyU3PUsbSendEP0Data (wLength, glEp0Buffer);
+                isHandled = CyTrue;
+                break;
+            case CY_FX_RQT_GET_STATS:
+                /*
+                 * Return a snapshot of the thread statistics in the data stage.
+                 */
+                glAppStats.upTime = CyU3PGetTime ();
+                glAppStats.cmdQueueLevel = CyFxBulkLpCmdLevel ();
+                glAppStats.appStackUsed = CyFxBulkLpStackUsed (glAppStack, CY_FX_BULKLP_THREAD_STACK);
+                glAppStats.spiStackUsed = CyFxBulkLpStackUsed (glSpiStack, CY_FX_SPI_THREAD_STACK);
+                CyU3PMemCopy (glEp0Buffer, (uint8_t *)&glAppStats, sizeof (glAppStats));
+                if (wValue == 1) {
+                    CyU3PMemSet ((uint8_t *)&glAppStats, 0, sizeof (glAppStats));
+                }
+                if (wLength > sizeof (glAppStats)) {
+                    wLength = sizeof (glAppStats);
+                }
+                status = CyU3PUsbSendEP0Data (wLength, glEp0Buffer);
+                isHandled = CyTrue;
+                break;
         }
     }
 
@@ -768,6 +3678,8 @@ CyFxBulkLpApplnUSBEventCB (
             }
             /* Start the loop back function. */
             CyFxBulkLpApplnStart ();
+            /* Wake up the thread to serve the requests. */
+            CyU3PEventSet (&glFramEvent, CY_FX_APPLN_STATE_CHANGE, CYU3P_EVENT_OR);
             break;
 
         case CY_U3P_USB_EVENT_RESET:
@@ -777,6 +3689,8 @@ CyFxBulkLpApplnUSBEventCB (
             {
                 CyFxBulkLpApplnStop ();
             }
+            /* Wake up the thread to notice the state change. */
+            CyU3PEventSet (&glFramEvent, CY_FX_APPLN_STATE_CHANGE, CYU3P_EVENT_OR);
             break;
 
         default:
@@ -814,6 +3728,26 @@ CyFxBulkLpApplnInit (void)
         return status;
     }
 
+    /* Select the fastest SPI clock verified with the FRAM. */
+    status = CyFxBulkLpSpiCalibrate ();
+    if (status != CY_U3P_SUCCESS) {
+        return status;
+    }
+
+#if (CY_FX_TRACE_ENABLE)
+    glTrace.depth = CY_FX_TRACE_DEPTH;
+#endif
+
+    /* Prepare the CRC32 engine and its buffer. */
+    CyFxBulkLpCrcInit ();
+    glCrcBuffer = (uint8_t *)CyU3PDmaBufferAlloc (CY_FX_BULKLP_DMA_CHUNK_SIZE);
+    if (glCrcBuffer == NULL) {
+        return CY_U3P_ERROR_MEMORY_ERROR;
+    }
+
+    /* Allocate the sector cache. */
+    CyFxBulkLpCacheInit ();
+
     /* Start the USB functionality. */
     apiRetStatus = CyU3PUsbStart();
     if (apiRetStatus != CY_U3P_SUCCESS)
@@ -926,18 +3860,198 @@ CyFxBulkLpApplnInit (void)
     return CY_U3P_SUCCESS;
 }
 
+#if (CY_FX_MEM_BENCHMARK)
+/*
+ * Byte loops of the SDK memory functions, kept as the reference of the
+ * microbenchmark.
+ */
+void
+CyFxBulkLpMemSetBytes (
+    uint8_t     *ptr,
+    uint8_t     data,
+    uint32_t    count
+) {
+    while (count >> 3) {
+        ptr[0] = data;
+        ptr[1] = data;
+        ptr[2] = data;
+        ptr[3] = data;
+        ptr[4] = data;
+        ptr[5] = data;
+        ptr[6] = data;
+        ptr[7] = data;
+        count -= 8;
+        ptr   += 8;
+    }
+    while (count--) {
+        *ptr++ = data;
+    }
+}
+
+void
+CyFxBulkLpMemCopyBytes (
+    uint8_t     *dest,
+    uint8_t     *src,
+    uint32_t    count
+) {
+    while (count >> 3) {
+        dest[0] = src[0];
+        dest[1] = src[1];
+        dest[2] = src[2];
+        dest[3] = src[3];
+        dest[4] = src[4];
+        dest[5] = src[5];
+        dest[6] = src[6];
+        dest[7] = src[7];
+        count -= 8;
+        dest  += 8;
+        src   += 8;
+    }
+    while (count--) {
+        *dest++ = *src++;
+    }
+}
+
+int32_t
+CyFxBulkLpMemCmpBytes (
+    const void  *s1,
+    const void  *s2,
+    uint32_t    n
+) {
+    const uint8_t *ptr1 = s1, *ptr2 = s2;
+
+    while (n--) {
+        if (*ptr1 != *ptr2) {
+            return *ptr1 - *ptr2;
+        }
+        ptr1++;
+        ptr2++;
+    }
+    return 0;
+}
+
+/*
+ * Print a time of CY_FX_MEM_BENCH_BYTES bytes in CPU cycles per byte
+ * with two decimals.
+ */
+void
+CyFxBulkLpMemBenchPrint (
+    const char  *name,
+    uint32_t    size,
+    uint32_t    time,
+    uint32_t    refTime
+) {
+    uint32_t cpb    = (uint32_t)((uint64_t)time * CY_FX_MEM_BENCH_CPU_KHZ * 100 / CY_FX_MEM_BENCH_BYTES);
+    uint32_t refCpb = (uint32_t)((uint64_t)refTime * CY_FX_MEM_BENCH_CPU_KHZ * 100 / CY_FX_MEM_BENCH_BYTES);
+
+    CyU3PDebugPrint (4, "%s %d B: %d.%s%d cycles/B, byte loop %d.%s%d cycles/B\n", name, size,
+            cpb / 100, ((cpb % 100) < 10) ? "0" : "", cpb % 100,
+            refCpb / 100, ((refCpb % 100) < 10) ? "0" : "", refCpb % 100);
+}
+
+/*
+ * Measure CyU3PMemCopy, CyU3PMemSet and CyU3PMemCmp against the byte loops
+ *
+ * Each function processes CY_FX_MEM_BENCH_BYTES bytes in calls of 64B
+ * to 20KB on 32 byte aligned DMA buffers. CyU3PGetTime counts 1 ms
+ * ticks, so the amount of data is large enough for a few percent of
+ * resolution. The compared buffers are equal, so CyU3PMemCmp goes
+ * through the whole length.
+ */
+void
+CyFxBulkLpMemBenchmark (
+    void
+) {
+    static const uint16_t sizes[] = { 64, 256, 1024, 4096, 10240, CY_FX_BULKLP_DMA_BUF_SIZE };
+    volatile int32_t result = 0;
+    uint8_t *src_p;
+    uint8_t *dest_p;
+    uint32_t start, time, refTime;
+    uint32_t loops;
+    uint32_t i;
+    uint8_t j;
+
+    src_p  = (uint8_t *)CyU3PDmaBufferAlloc (CY_FX_BULKLP_DMA_BUF_SIZE);
+    dest_p = (uint8_t *)CyU3PDmaBufferAlloc (CY_FX_BULKLP_DMA_BUF_SIZE);
+    if ((src_p == NULL) || (dest_p == NULL)) {
+        CyU3PDebugPrint (4, "Memory benchmark: no DMA buffer\n");
+        goto done;
+    }
+    CyU3PMemSet (src_p, 0x5A, CY_FX_BULKLP_DMA_BUF_SIZE);
+    CyU3PMemSet (dest_p, 0x5A, CY_FX_BULKLP_DMA_BUF_SIZE);
+
+    for (j = 0; j < sizeof (sizes) / sizeof (sizes[0]); j++) {
+        loops = CY_FX_MEM_BENCH_BYTES / sizes[j];
+
+        start = CyU3PGetTime ();
+        for (i = 0; i < loops; i++) {
+            CyU3PMemCopy (dest_p, src_p, sizes[j]);
+        }
+        time  = CyU3PGetTime () - start;
+        start = CyU3PGetTime ();
+        for (i = 0; i < loops; i++) {
+            CyFxBulkLpMemCopyBytes (dest_p, src_p, sizes[j]);
+        }
+        refTime = CyU3PGetTime () - start;
+        CyFxBulkLpMemBenchPrint ("MemCopy", sizes[j], time, refTime);
+
+        start = CyU3PGetTime ();
+        for (i = 0; i < loops; i++) {
+            CyU3PMemSet (dest_p, 0x5A, sizes[j]);
+        }
+        time  = CyU3PGetTime () - start;
+        start = CyU3PGetTime ();
+        for (i = 0; i < loops; i++) {
+            CyFxBulkLpMemSetBytes (dest_p, 0x5A, sizes[j]);
+        }
+        refTime = CyU3PGetTime () - start;
+        CyFxBulkLpMemBenchPrint ("MemSet", sizes[j], time, refTime);
+
+        start = CyU3PGetTime ();
+        for (i = 0; i < loops; i++) {
+            result += CyU3PMemCmp (dest_p, src_p, sizes[j]);
+        }
+        time  = CyU3PGetTime () - start;
+        start = CyU3PGetTime ();
+        for (i = 0; i < loops; i++) {
+            result += CyFxBulkLpMemCmpBytes (dest_p, src_p, sizes[j]);
+        }
+        refTime = CyU3PGetTime () - start;
+        CyFxBulkLpMemBenchPrint ("MemCmp", sizes[j], time, refTime);
+    }
+
+    if (result != 0) {
+        CyU3PDebugPrint (4, "Memory benchmark: MemCmp mismatch\n");
+    }
+
+done:
+    if (src_p != NULL) {
+        CyU3PDmaBufferFree (src_p);
+    }
+    if (dest_p != NULL) {
+        CyU3PDmaBufferFree (dest_p);
+    }
+}
+#endif
+
 /* Entry function for the BulkLpAppThread. */
 void
 BulkLpAppThread_Entry (
         uint32_t input)
 {
-    CyU3PDmaBuffer_t inBuf_p, outBuf_p;
     CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
     uint32_t eventFlags;
+    uint32_t waitTime, wakeTime, latency;
+    CyBool_t isLooping;
+    CyFxBulkLpCmd_t cmd;
 
     /* Initialize the debug module */
     CyFxBulkLpApplnDebugInit();
 
+#if (CY_FX_MEM_BENCHMARK)
+    CyFxBulkLpMemBenchmark ();
+#endif
+
     /* Initialize the bulk loop application */
     status = CyFxBulkLpApplnInit();
     if (status != CY_U3P_SUCCESS)
@@ -946,132 +4060,67 @@ BulkLpAppThread_Entry (
     }
 
     for (;;) {
-        if (glIsApplnActive) {
-            status = CyU3PEventGet(&glFramEvent,
-                CY_FX_FRAM_WRITE_READY | CY_FX_FRAM_READ_READY,
-                CYU3P_EVENT_OR_CLEAR,
-                &eventFlags,
-                CYU3P_NO_WAIT
-            );
-            if (status != CY_U3P_SUCCESS) {
-                continue;
-            }
-            if (eventFlags & CY_FX_FRAM_WRITE_READY) {
-                /*
-                 * Wait for receiving a buffer from the producer socket (OUT endpoint). The call
-                 * will fail if there was an error or if the USB connection was reset / disconnected.
-                 * In case of error invoke the error handler and in case of reset / disconnection,
-                 * glIsApplnActive will be CyFalse; continue to beginning of the loop.
-                 */
-                status = CyU3PDmaChannelGetBuffer (&glChHandleBulkLpIn, &inBuf_p, CYU3P_WAIT_FOREVER);
-                if (status != CY_U3P_SUCCESS) {
-                    if (!glIsApplnActive) {
-                        continue;
-                    } else {
-                        CyU3PDebugPrint (4, "CyU3PDmaChannelGetBuffer failed, Error code = %d\n", status);
-                        CyFxAppErrorHandler(status);
-                    }
-                }
-
-                /*
-                 * Write a data packet to FRAM at a sector previously
-                 * specified by the FRAM_WRITE control request.
-                 */
-                status = CyFxBulkLpFramWrite(glSectorToWrite, inBuf_p.buffer, inBuf_p.count);
-                if (status != CY_U3P_SUCCESS) {
-                    if (!glIsApplnActive) {
-                        continue;
-                    } else {
-                        CyU3PDebugPrint (4, "CyFxBulkLpFramWrite failed, Error code = %d\n", status);
-                        CyFxAppErrorHandler(status);
-                    }
-                }
+        /*
+         * Wait for an event from the USB callbacks. The thread sleeps
+         * until a READ/WRITE request arrives or the application is
+         * started or stopped, so no CPU time is wasted while idle.
+         * In the loopback modes with the CPU, the thread only polls the
+         * events between the buffers.
+         */
+        isLooping = glIsApplnActive &&
+            ((glDmaMode == CY_FX_DMA_MODE_LOOP_COPY) || (glDmaMode == CY_FX_DMA_MODE_LOOP_HANDOFF));
+        waitTime = CyU3PGetTime ();
+        status = CyU3PEventGet(&glFramEvent,
+            CY_FX_FRAM_EVENTS,
+            CYU3P_EVENT_OR_CLEAR,
+            &eventFlags,
+            (isLooping) ? CYU3P_NO_WAIT : CYU3P_WAIT_FOREVER
+        );
+        wakeTime = CyU3PGetTime ();
+        glAppStats.idleTime += wakeTime - waitTime;
+        if (status == CY_U3P_SUCCESS) {
+            glAppStats.wakeCount++;
+        } else if (!isLooping) {
+            continue;
+        }
 
-                /*
-                 * Now discard the data from the producer channel so that the buffer is made available
-                 * to receive more data.
-                 */
-                status = CyU3PDmaChannelDiscardBuffer (&glChHandleBulkLpIn);
-                if (status != CY_U3P_SUCCESS) {
-                    if (!glIsApplnActive) {
-                        continue;
-                    } else {
-                        CyU3PDebugPrint (4, "CyU3PDmaChannelDiscardBuffer failed, Error code = %d\n", status);
-                        CyFxAppErrorHandler(status);
-                    }
-                }
+        /*
+         * Serve all the queued requests in order. The call will fail if there was
+         * an error or if the USB connection was reset / disconnected. In case of
+         * error invoke the error handler and in case of reset / disconnection,
+         * glIsApplnActive will be CyFalse; continue to beginning of the loop.
+         */
+        while (glIsApplnActive && CyFxBulkLpCmdGet (&cmd)) {
+            latency = CyU3PGetTime () - cmd.time;
+            glAppStats.wakeLatencyTotal += latency;
+            if (latency > glAppStats.wakeLatencyMax) {
+                glAppStats.wakeLatencyMax = latency;
             }
-            if (eventFlags & CY_FX_FRAM_READ_READY) {
-                /*
-                 * Wait for a free buffer to be used to transmit the received data.
-                 * The failure cases are same as above.
-                 */
-                status = CyU3PDmaChannelGetBuffer (&glChHandleBulkLpOut, &outBuf_p, CYU3P_WAIT_FOREVER);
-                if (status != CY_U3P_SUCCESS) {
-                    if (!glIsApplnActive) {
-                        continue;
-                    } else {
-                        CyU3PDebugPrint (4, "CyU3PDmaChannelGetBuffer failed, Error code = %d\n", status);
-                        CyFxAppErrorHandler(status);
-                    }
-                }
+            glAppStats.requestCount++;
 
-                /*
-                 * Read a data packet from FRAM at a sector previously
-                 * specified by the FRAM_READ control request.
-                 */
-                status = CyFxBulkLpFramRead(glSectorToRead, outBuf_p.buffer, glSizeToRead);
-                if (status != CY_U3P_SUCCESS) {
-                    if (!glIsApplnActive) {
-                        continue;
-                    } else {
-                        CyU3PDebugPrint (4, "CyFxBulkLpFramRead failed, Error code = %d\n", status);
-                        CyFxAppErrorHandler(status);
-                    }
+            CY_FX_TRACE (CY_FX_TRACE_CMD, cmd.request, cmd.address);
+            status = CyFxBulkLpCmdDispatch (&cmd);
+            if (status != CY_U3P_SUCCESS) {
+                CY_FX_TRACE (CY_FX_TRACE_CMD_ERROR, cmd.request, status);
+                if (!glIsApplnActive) {
+                    break;
+                } else {
+                    CyU3PDebugPrint (4, "CyFxBulkLpCmdExecute failed, Error code = %d\n", status);
+                    CyFxAppErrorHandler(status);
                 }
+            }
+        }
 
-                /*
-                 * Commit the received data to the consumer pipe so that the data can be
-                 * transmitted back to the USB host. Since the same data is sent back, the
-                 * count shall be same as received and the status field of the call shall
-                 * be 0 for default use case.
-                 */
-                status = CyU3PDmaChannelCommitBuffer (&glChHandleBulkLpOut, glSizeToRead, 0);
-                if (status != CY_U3P_SUCCESS) {
-                    if (!glIsApplnActive) {
-                        continue;
-                    } else {
-                        CyU3PDebugPrint (4, "CyU3PDmaChannelCommitBuffer failed, Error code = %d\n", status);
-                        CyFxAppErrorHandler(status);
-                    }
-                }
-                if ((glSizeToRead > 0) && ((glSizeToRead % glPacketSize) == 0)) {
-                    /*
-                     * Add ZLP for aligned size of data
-                     */
-                    status = CyU3PDmaChannelGetBuffer (&glChHandleBulkLpOut, &outBuf_p, CYU3P_WAIT_FOREVER);
-                    if (status != CY_U3P_SUCCESS) {
-                        if (!glIsApplnActive) {
-                            continue;
-                        } else {
-                            CyU3PDebugPrint (4, "CyU3PDmaChannelGetBuffer failed, Error code = %d\n", status);
-                            CyFxAppErrorHandler(status);
-                        }
-                    }
-                    status = CyU3PDmaChannelCommitBuffer (&glChHandleBulkLpOut, 0, 0);
-                    if (status != CY_U3P_SUCCESS) {
-                        if (!glIsApplnActive) {
-                            continue;
-                        } else {
-                            CyU3PDebugPrint (4, "CyU3PDmaChannelCommitBuffer failed, Error code = %d\n", status);
-                            CyFxAppErrorHandler(status);
-                        }
-                    }
-                }
+        /*
+         * Loop a buffer back. The mode may be changed by the requests above.
+         */
+        if (glIsApplnActive &&
+                ((glDmaMode == CY_FX_DMA_MODE_LOOP_COPY) || (glDmaMode == CY_FX_DMA_MODE_LOOP_HANDOFF))) {
+            status = CyFxBulkLpLoopback ();
+            if ((status != CY_U3P_SUCCESS) && (glIsApplnActive)) {
+                CyU3PDebugPrint (4, "CyFxBulkLpLoopback failed, Error code = %d\n", status);
+                CyFxAppErrorHandler(status);
             }
-        } else {
-            /* No active data transfer. Sleep for a small amount of time. */
-            CyU3PThreadSleep (100);
         }
     }
 
@@ -1080,6 +4129,35 @@ handle_error:
     while (1);
 }
 
+/* Entry function for the BulkLpSpiThread.
+ * The requests passed by CyFxBulkLpCmdDispatch are served in order. */
+void
+BulkLpSpiThread_Entry (
+        uint32_t input)
+{
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+    CyFxBulkLpCmd_t cmd;
+
+    for (;;) {
+        status = CyU3PQueueReceive (&glSpiQueue, &cmd, CYU3P_WAIT_FOREVER);
+        if (status != CY_U3P_SUCCESS) {
+            continue;
+        }
+
+        CyU3PMutexGet (&glSpiLock, CYU3P_WAIT_FOREVER);
+        status = CyFxBulkLpCmdExecute (&cmd);
+        CyU3PMutexPut (&glSpiLock);
+        if (status != CY_U3P_SUCCESS) {
+            CY_FX_TRACE (CY_FX_TRACE_CMD_ERROR, cmd.request, status);
+            CyU3PDebugPrint (4, "SPI worker request failed, Error code = %d\n", status);
+            CyFxAppErrorHandler(status);
+        }
+
+        glSpiJobsDone++;
+        CyU3PEventSet (&glSpiEvent, CY_FX_SPI_JOB_DONE, CYU3P_EVENT_OR);
+    }
+}
+
 /* Application define function which creates the threads. */
 void
 CyFxApplicationDefine (
@@ -1095,8 +4173,36 @@ CyFxApplicationDefine (
         while (1);
     }
 
-    /* Allocate the memory for the threads */
+    status = CyU3PEventCreate (&glSpiEvent);
+    if (status != 0) {
+        /* Loop indefinitely */
+        while (1);
+    }
+
+    status = CyU3PMutexCreate (&glSpiLock, CYU3P_INHERIT);
+    if (status != 0) {
+        /* Loop indefinitely */
+        while (1);
+    }
+
+    /* The SPI worker queue holds as many requests as the request queue. */
+    ptr = CyU3PMemAlloc (CY_FX_CMD_QUEUE_DEPTH * sizeof (CyFxBulkLpCmd_t));
+    status = CyU3PQueueCreate (&glSpiQueue, CY_FX_CMD_WORDS, ptr,
+            CY_FX_CMD_QUEUE_DEPTH * sizeof (CyFxBulkLpCmd_t));
+    if (status != 0) {
+        /* Loop indefinitely */
+        while (1);
+    }
+
+    /* Allocate the memory for the threads. The stack is filled to find
+     * its high-water mark. */
     ptr = CyU3PMemAlloc (CY_FX_BULKLP_THREAD_STACK);
+    if (ptr == NULL) {
+        /* Loop indefinitely */
+        while (1);
+    }
+    CyU3PMemSet (ptr, CY_FX_STACK_FILL, CY_FX_BULKLP_THREAD_STACK);
+    glAppStack = ptr;
 
     /* Create the thread for the application */
     retThrdCreate = CyU3PThreadCreate (&BulkLpAppThread,           /* Bulk loop App Thread structure */
@@ -1122,6 +4228,34 @@ CyFxApplicationDefine (
         /* Loop indefinitely */
         while(1);
     }
+
+    /* Allocate the memory for the SPI worker thread */
+    ptr = CyU3PMemAlloc (CY_FX_SPI_THREAD_STACK);
+    if (ptr == NULL) {
+        /* Loop indefinitely */
+        while (1);
+    }
+    CyU3PMemSet (ptr, CY_FX_STACK_FILL, CY_FX_SPI_THREAD_STACK);
+    glSpiStack = ptr;
+
+    /* Create the SPI worker thread. It runs when the application thread
+     * waits for the USB, and is preempted by the application thread. */
+    retThrdCreate = CyU3PThreadCreate (&BulkLpSpiThread,           /* SPI worker Thread structure */
+                          "22:Bulk_loop_SPI_worker",               /* Thread ID and Thread name */
+                          BulkLpSpiThread_Entry,                   /* SPI worker Thread Entry function */
+                          0,                                       /* No input parameter to thread */
+                          ptr,                                     /* Pointer to the allocated thread stack */
+                          CY_FX_SPI_THREAD_STACK,                  /* SPI worker Thread stack size */
+                          CY_FX_SPI_THREAD_PRIORITY,               /* SPI worker Thread priority */
+                          CY_FX_SPI_THREAD_PRIORITY,               /* SPI worker Thread priority */
+                          CYU3P_NO_TIME_SLICE,                     /* No time slice for the worker thread */
+                          CYU3P_AUTO_START                         /* Start the Thread immediately */
+                          );
+    if (retThrdCreate != 0)
+    {
+        /* Loop indefinitely */
+        while(1);
+    }
 }
 
 /*
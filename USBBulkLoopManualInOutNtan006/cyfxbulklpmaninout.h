@@ -30,23 +30,116 @@
 #include "cyu3externcstart.h"
 
 #define CY_FX_BULKLP_DMA_BUF_SIZE       (20*1024)       // Maximum SPI packet data size
-#define CY_FX_BULKLP_DMA_BUF_COUNT      (1)             // DMA channel buffer count
+
+/* Default burst length of the SuperSpeed bulk endpoints (1 - 16). */
+#define CY_FX_EP_BURST_LENGTH           (8)
+
+/* Maximum burst length advertised in the SS endpoint companion descriptors.
+ * The descriptors are not changed by the SET_BURST request, so the host
+ * always sees this value and the endpoints burst up to glBurstLength. */
+#define CY_FX_EP_BURST_MAX              (16)
+
+/* The DMA buffer size is chosen to hold at least one burst and to divide
+ * the sector data size. */
+#if (CY_FX_EP_BURST_LENGTH < 1) || (CY_FX_EP_BURST_LENGTH > CY_FX_EP_BURST_MAX)
+#error "CY_FX_EP_BURST_LENGTH must be in the range 1 to CY_FX_EP_BURST_MAX"
+#elif (CY_FX_EP_BURST_LENGTH <= 4)
+#define CY_FX_BULKLP_DMA_CHUNK_SIZE     (4*1024)        // Pipelined transfer chunk size (DMA buffer size)
+#define CY_FX_BULKLP_DMA_CHUNK_COUNT    (4)             // DMA channel buffer count
+#elif (CY_FX_EP_BURST_LENGTH <= 10)
+#define CY_FX_BULKLP_DMA_CHUNK_SIZE     (10*1024)       // Pipelined transfer chunk size (DMA buffer size)
+#define CY_FX_BULKLP_DMA_CHUNK_COUNT    (4)             // DMA channel buffer count
+#else
+#define CY_FX_BULKLP_DMA_CHUNK_SIZE     (20*1024)       // Pipelined transfer chunk size (DMA buffer size)
+#define CY_FX_BULKLP_DMA_CHUNK_COUNT    (2)             // DMA channel buffer count
+#endif
 #define CY_FX_BULKLP_DMA_TX_SIZE        (0)                       /* DMA transfer size is set to infinite */
 #define CY_FX_BULKLP_THREAD_STACK       (0x1000)                  /* Bulk loop application thread stack size */
 #define CY_FX_BULKLP_THREAD_PRIORITY    (8)                       /* Bulk loop application thread priority */
+#define CY_FX_SPI_THREAD_STACK          (0x0800)                  /* SPI worker thread stack size */
+#define CY_FX_SPI_THREAD_PRIORITY       (9)                       /* SPI worker thread priority, below the USB side */
+#define CY_FX_STACK_FILL                (0xEF)                    /* Fill byte of the thread stacks for the high-water mark */
 
 #define CY_FX_SECTOR_SIZE               (CY_FX_BULKLP_DMA_BUF_SIZE+32)  // Sector size
-#define CY_FX_N_SECTORS                 (256*1024/CY_FX_SECTOR_SIZE)    // Number of sectors in 2Mbit FRAM
+#define CY_FX_FRAM_DEFAULT_SIZE         (256*1024)                      // 2Mbit FRAM assumed when RDID fails
+#define CY_FX_FRAM_MAX_SIZE             (0x8000000)                     // Largest FRAM accepted from RDID
+
+/* A sector is transferred in whole chunks. */
+#if ((CY_FX_BULKLP_DMA_BUF_SIZE % CY_FX_BULKLP_DMA_CHUNK_SIZE) != 0)
+#error "CY_FX_BULKLP_DMA_BUF_SIZE must be a multiple of CY_FX_BULKLP_DMA_CHUNK_SIZE"
+#endif
+
+/* Bytes reserved in front of each chunk of the producer channel in the CPU
+ * DMA modes.  The WRITE command and the address are stored there to be sent
+ * with the first chunk in a single DMA transfer.
+ */
+#define CY_FX_FRAM_HEADER_SIZE          (32)
 
 // Give a timeout value of 5s for any flash programming.
 #define CY_FX_FRAM_TIMEOUT              (5000)
 
+/* Number of sectors cached in the DMA buffer heap. 0 removes the cache.
+ * Each entry takes CY_FX_BULKLP_DMA_BUF_SIZE bytes of the heap shared with
+ * the DMA channels, which take 80KB of the 224KB heap.
+ */
+#define CY_FX_SECTOR_CACHE_COUNT        (4)
+
+/* CRC32 polynomial (IEEE 802.3, bit reversed) */
+#define CY_FX_CRC32_POLY                (0xEDB88320)
+
+/* Binary trace of the FRAM operations.  Set CY_FX_TRACE_ENABLE to 0 to
+ * remove the trace from the build.  CY_FX_TRACE_DEPTH must be a power of 2.
+ */
+#ifndef CY_FX_TRACE_ENABLE
+#define CY_FX_TRACE_ENABLE              (1)
+#endif
+#define CY_FX_TRACE_DEPTH               (64)
+
+/* Microbenchmark of CyU3PMemCopy, CyU3PMemSet and CyU3PMemCmp against the
+ * byte loops of the SDK, run once at boot before the USB is connected.
+ * Set CY_FX_MEM_BENCHMARK to 1 to add it to the build.  The results are
+ * printed in CPU cycles per byte, counted from CyU3PGetTime at the CPU
+ * clock CY_FX_MEM_BENCH_CPU_KHZ.
+ */
+#ifndef CY_FX_MEM_BENCHMARK
+#define CY_FX_MEM_BENCHMARK             (0)
+#endif
+#ifndef CY_FX_MEM_BENCH_CPU_KHZ
+#define CY_FX_MEM_BENCH_CPU_KHZ         (201600)        /* ARM926 clock of the FX3 */
+#endif
+#ifndef CY_FX_MEM_BENCH_BYTES
+#define CY_FX_MEM_BENCH_BYTES           (0x400000)      /* Bytes processed per measurement */
+#endif
+
+/* Trace event IDs */
+#define CY_FX_TRACE_CMD                 (1)     /* Request dispatched: request, address */
+#define CY_FX_TRACE_FRAM_READ           (2)     /* FRAM READ started: address, size */
+#define CY_FX_TRACE_FRAM_WRITE          (3)     /* FRAM WRITE done: address, size */
+#define CY_FX_TRACE_CMD_ERROR           (4)     /* Request failed: request, status */
+
+/* Test pattern layout, same as 1000.txt: lines of 64 bytes starting with the
+ * offset of the line in 4 hexadecimal digits.
+ */
+#define CY_FX_PATTERN_LINE_SIZE         (64)
+
+/* SPI clock settings */
+#define CY_FX_SPI_CLOCK_DEFAULT         (24000000)      // SPI clock used when the calibration fails
+#define CY_FX_SPI_CLOCK_MIN             (10000000)      // Minimum SPI clock, the first calibration step
+#define CY_FX_SPI_CLOCK_MAX             (33000000)      // Maximum SPI clock of the FX3
+
+/* Scratch area used by the SPI clock calibration.
+ * The area is at the end of the FRAM and is excluded from the sectors.
+ */
+#define CY_FX_FRAM_SCRATCH_SIZE         (64)
+
 /* USB vendor requests supported by the application. */
 
 /* USB vendor request to initialize WRITE to SPI FRAM. Any bytes of data
  * can be written to the FRAM at a sector specified by the wIndex parameter.
- * The maximum allowed data size is 20kBytes.  The data size is specified
- * by the BULK data size following this request.
+ * The maximum allowed data size is 20kBytes.  In the CPU DMA modes the data
+ * size is specified by the BULK data size following this request.  In the
+ * direct DMA mode it is specified by the wValue parameter, and the request
+ * is stalled when wValue is 0.
  */
 #define CY_FX_RQT_FRAM_WRITE            (0xC2)
 
@@ -58,13 +151,340 @@
  */
 #define CY_FX_RQT_FRAM_READ             (0xC3)
 
+/* USB vendor request to get the application thread statistics.  The
+ * statistics structure CyFxBulkLpAppStats_t is returned in the data stage
+ * of this IN request.  Setting wValue to 1 clears the statistics after
+ * they are returned.
+ */
+#define CY_FX_RQT_GET_STATS             (0xC4)
+
+/* USB vendor request to initialize WRITE to consecutive sectors of SPI FRAM.
+ * The first sector is specified by the wIndex parameter and the number of
+ * sectors by the wValue parameter.  The data of the sectors, 20kBytes
+ * each, is sent by a single BULK transfer following this request.  The
+ * transfer may be terminated early by a short packet or a ZLP.
+ */
+#define CY_FX_RQT_FRAM_WRITE_MULTI      (0xC5)
+
+/* USB vendor request to initialize READ from consecutive sectors of SPI
+ * FRAM.  The first sector is specified by the wIndex parameter and the
+ * number of sectors by the wValue parameter.  The data of the sectors,
+ * 20kBytes each, is read by a single BULK IN transfer following this
+ * request.
+ */
+#define CY_FX_RQT_FRAM_READ_MULTI       (0xC6)
+
+/* USB vendor request to set the burst length of the SuperSpeed endpoints.
+ * The burst length (1 to CY_FX_EP_BURST_MAX) is specified by the wValue
+ * parameter.  The request is queued and the endpoints and DMA channels are
+ * re-configured when it is served, as by CY_FX_RQT_SET_DMA_MODE.
+ */
+#define CY_FX_RQT_SET_BURST             (0xC7)
+
+/* USB vendor request to select the DMA mode of the FRAM READ/WRITE requests
+ * or one of the USB loopback modes.  The mode (CY_FX_DMA_MODE_xxx) is
+ * specified by the wValue parameter.  The request is queued and the
+ * endpoints and DMA channels are re-created when it is served, after the
+ * host has taken the READ data before it.  The requests queued after it
+ * are kept, and the requests with BULK data are stalled until it is served.
+ */
+#define CY_FX_RQT_SET_DMA_MODE          (0xC8)
+
+/* USB vendor request to report or override the SPI clock setting.
+ * IN (0xC0):  The current CyFxBulkLpSpiClock_t is returned in the data stage.
+ * OUT (0x40): wValue is the SPI clock in kHz and wIndex is 1 to use the
+ *             FAST_READ command.  wValue 0 restarts the self-calibration.
+ *             The request is queued.
+ */
+#define CY_FX_RQT_SPI_CLOCK             (0xC9)
+
+/* USB vendor request to get the FRAM geometry.  The geometry structure
+ * CyFxBulkLpFramGeometry_t is returned in the data stage.
+ */
+#define CY_FX_RQT_GET_GEOMETRY          (0xCA)
+
+/* USB vendor requests to initialize WRITE to and READ from a byte range of
+ * SPI FRAM.  The range CyFxBulkLpByteRange_t is sent in the data stage.
+ * A BULK-OUT or BULK-IN transfer of the data follows.
+ */
+#define CY_FX_RQT_FRAM_WRITE_BYTES      (0xCB)
+#define CY_FX_RQT_FRAM_READ_BYTES       (0xCC)
+
+/* USB vendor request to control the sector cache.
+ * IN (0xC0):  The statistics CyFxBulkLpCacheStats_t are returned in the data
+ *             stage.  wValue 1 clears the counters after reading.
+ * OUT (0x40): wValue 1 enables and 0 disables the cache.  The request is queued.
+ */
+#define CY_FX_RQT_SECTOR_CACHE          (0xCD)
+
+/* USB vendor request to compute the CRC32 of FRAM data on the device.
+ * IN (0xC0):  The result CyFxBulkLpCrcResult_t is returned in the data stage.
+ * OUT (0x40): With wLength 0, wIndex is the sector number and wValue is the
+ *             number of bytes from the top of the sector (0 for the whole
+ *             sector).  With wLength 8, the byte range CyFxBulkLpByteRange_t
+ *             is sent in the data stage.  The request is queued.
+ */
+#define CY_FX_RQT_FRAM_CRC              (0xCE)
+
+/* USB vendor request to enable (wValue 1) or disable (wValue 0) the
+ * verification of the written data with a CRC32 of the readback.
+ * The request is queued.
+ */
+#define CY_FX_RQT_SET_VERIFY            (0xCF)
+
+/* USB vendor request to get the performance counters of the FRAM transfer
+ * stages.  The counters CyFxBulkLpPerfStats_t are returned in the data stage
+ * and cleared.
+ */
+#define CY_FX_RQT_GET_PERF              (0xD0)
+
+/* USB vendor request to get the trace ring.  The ring CyFxBulkLpTrace_t is
+ * returned raw in the data stage.
+ */
+#define CY_FX_RQT_GET_TRACE             (0xD1)
+
+/* USB vendor requests to benchmark the USB transfers with a test pattern
+ * instead of the FRAM.  The length of the transfer in bytes is wIndex:wValue
+ * (wIndex is the upper 16 bits).  The requests are queued.
+ * PATTERN_SEND:  The pattern is sent to the IN endpoint.
+ * PATTERN_CHECK: The data from the OUT endpoint is checked with the pattern.
+ *                A transfer of a multiple of the packet size is ended by a
+ *                ZLP. The IN form (0xC0) returns CyFxBulkLpPatternResult_t.
+ */
+#define CY_FX_RQT_PATTERN_SEND          (0xD2)
+#define CY_FX_RQT_PATTERN_CHECK         (0xD3)
+
+/* USB vendor request to get the throughput counters of the loopback modes.
+ * The counters CyFxBulkLpLoopStats_t are returned in the data stage.
+ * wValue 1 clears the counters after reading.
+ */
+#define CY_FX_RQT_GET_LOOP_STATS        (0xD4)
+
+/* USB vendor request to read (IN, 0xC0) or write (OUT, 0x40) a small record
+ * of SPI FRAM in the data stage.  The byte address is wIndex:wValue (wIndex
+ * is the upper 16 bits) and the length is wLength, up to
+ * CY_FX_EP0_FRAM_MAX_SIZE bytes.  The request is served in the setup
+ * callback only when all the queued requests are served, so it is ordered
+ * after them, and stalled otherwise.
+ */
+#define CY_FX_RQT_FRAM_EP0              (0xD5)
+
+#define CY_FX_EP0_FRAM_MAX_SIZE         (512)
+#define CY_FX_EP0_SPI_TIMEOUT           (10)    /* Timeout in ms to wait for the SPI in the setup callback. */
+
+/* DMA modes of the FRAM READ/WRITE requests. */
+#define CY_FX_DMA_MODE_CPU              (0)     /* Data goes through the CPU with MANUAL channels. */
+#define CY_FX_DMA_MODE_DIRECT           (1)     /* Data goes by AUTO channels between USB and SPI. */
+
+/* USB loopback modes.  The data from the OUT endpoint is sent back to the IN
+ * endpoint without the FRAM, and the FRAM READ/WRITE requests are ignored.
+ */
+#define CY_FX_DMA_MODE_LOOP_COPY        (2)     /* The CPU copies the data between MANUAL_IN and MANUAL_OUT channels. */
+#define CY_FX_DMA_MODE_LOOP_HANDOFF     (3)     /* The CPU commits the buffers of a MANUAL channel without a copy. */
+#define CY_FX_DMA_MODE_LOOP_AUTO        (4)     /* Data goes by an AUTO channel without the CPU. */
+
+#define CY_FX_DMA_MODE_IS_LOOP(mode)    (((mode) >= CY_FX_DMA_MODE_LOOP_COPY) && ((mode) <= CY_FX_DMA_MODE_LOOP_AUTO))
+
+/* The channels of the CPU DMA mode with the DMA callbacks enabled.  The
+ * chunks of the FRAM WRITE requests are handed to the SPI by the callbacks,
+ * and completed by the thread.
+ */
+#define CY_FX_DMA_MODE_CALLBACK         (5)
+
+#define CY_FX_DMA_MODE_IS_CPU(mode)     (((mode) == CY_FX_DMA_MODE_CPU) || ((mode) == CY_FX_DMA_MODE_CALLBACK))
+
+#define CY_FX_LOOP_TIMEOUT              (10)    /* Timeout in ms to wait for a loopback buffer. */
+#define CY_FX_ZLP_TIMEOUT               (100)   /* Timeout in ms to wait for the ZLP after a full chunk. */
+#define CY_FX_DRAIN_TIMEOUT             (1000)  /* Timeout in ms to wait for the host to read the IN endpoint. */
+
+/*
+ * Event flags to notify the thread that READ/WRITE requests are queued
+ * by the host or the application has been started or stopped.
+ */
+
+#define CY_FX_FRAM_CMD_READY            (1u << 0)
+#define CY_FX_APPLN_STATE_CHANGE        (1u << 2)
+#define CY_FX_CB_WRITE_DONE             (1u << 3)       /* A chunk of a callback driven WRITE is sent. */
+#define CY_FX_FRAM_EVENTS               (CY_FX_FRAM_CMD_READY | CY_FX_APPLN_STATE_CHANGE)
+
+/* Number of READ/WRITE requests which can be queued for the thread.
+ * A request arriving while the queue is full is stalled.
+ */
+#define CY_FX_CMD_QUEUE_DEPTH           (8)
+
+/* Event flag set by the SPI worker thread when a request is completed. */
+#define CY_FX_SPI_JOB_DONE              (1u << 0)
+
+/* Size of the buffer used for the EP0 data stage. */
+#define CY_FX_EP0_BUF_SIZE              (CY_FX_EP0_FRAM_MAX_SIZE)
+
+/*
+ * Application thread statistics returned by CY_FX_RQT_GET_STATS.
+ * All times are in RTOS ticks (1 ms).
+ */
+typedef struct CyFxBulkLpAppStats_t
+{
+    uint32_t upTime;                    /* Time since the device has booted. */
+    uint32_t idleTime;                  /* Time the thread spent blocked waiting for an event. */
+    uint32_t wakeCount;                 /* Number of times the thread has been woken up. */
+    uint32_t requestCount;              /* Number of READ/WRITE requests dispatched. */
+    uint32_t wakeLatencyTotal;          /* Sum of the latencies from a request to its dispatch. */
+    uint32_t wakeLatencyMax;            /* Maximum latency from a request to its dispatch. */
+    uint32_t cmdQueueLevel;             /* Number of requests in the queue. */
+    uint32_t cmdQueueMax;               /* Maximum number of requests in the queue. */
+    uint32_t cmdOverflow;               /* Number of requests stalled because the queue was full. */
+    uint32_t appStackUsed;              /* High-water mark of the application thread stack in bytes. */
+    uint32_t spiStackUsed;              /* High-water mark of the SPI worker thread stack in bytes. */
+} CyFxBulkLpAppStats_t;
+
+/*
+ * SPI clock setting returned by CY_FX_RQT_SPI_CLOCK.
+ */
+typedef struct CyFxBulkLpSpiClock_t
+{
+    uint32_t clock;                     /* SPI clock in Hz. */
+    uint8_t  fastRead;                  /* 1 when the FAST_READ command is used. */
+    uint8_t  calibrated;                /* 1 when the setting is verified by the calibration. */
+    uint8_t  reserved[2];
+} CyFxBulkLpSpiClock_t;
+
+/*
+ * Sector cache statistics returned by CY_FX_RQT_SECTOR_CACHE.
+ */
+typedef struct CyFxBulkLpCacheStats_t
+{
+    uint32_t hits;                      /* Number of sector reads served from the cache. */
+    uint32_t misses;                    /* Number of sector reads served from the FRAM. */
+    uint32_t evictions;                 /* Number of valid sectors replaced in the cache. */
+    uint16_t entries;                   /* Number of sectors allocated for the cache. */
+    uint8_t  enabled;                   /* 1 when the cache is enabled. */
+    uint8_t  reserved;
+} CyFxBulkLpCacheStats_t;
+
 /*
- * Event flags to notify the thread that a READ/WRITE request arises
- * by the host.
+ * CRC32 result returned by CY_FX_RQT_FRAM_CRC.
  */
+typedef struct CyFxBulkLpCrcResult_t
+{
+    uint32_t crc;                       /* CRC32 of the last requested range. */
+    uint32_t byteAddress;               /* FRAM address of the last requested range. */
+    uint32_t byteCount;                 /* Number of bytes in the last requested range. */
+    uint32_t verifyCount;               /* Number of writes verified. */
+    uint32_t verifyErrors;              /* Number of writes which failed the verification. */
+    uint8_t  ready;                     /* 1 when the CRC of the last requested range is available. */
+    uint8_t  reserved[3];
+} CyFxBulkLpCrcResult_t;
 
-#define CY_FX_FRAM_READ_READY           (1u << 0)
-#define CY_FX_FRAM_WRITE_READY          (1u << 1)
+/* FRAM transfer stages measured by the performance counters */
+#define CY_FX_PERF_GET_BUFFER           (0)     /* Waiting for a USB DMA buffer. */
+#define CY_FX_PERF_SPI_CMD              (1)     /* Sending a READ/WRITE command to the FRAM. */
+#define CY_FX_PERF_SPI_WAIT             (2)     /* Waiting for the SPI block transfer. */
+#define CY_FX_PERF_DMA_WAIT             (3)     /* Waiting for the DMA transfer completion. */
+#define CY_FX_PERF_COMMIT               (4)     /* Committing or discarding a USB DMA buffer. */
+#define CY_FX_PERF_ZLP                  (5)     /* Sending a ZLP. */
+#define CY_FX_PERF_N_STAGES             (6)
+
+/*
+ * Performance counters of a FRAM transfer stage.
+ * All times are in RTOS ticks (1 ms).
+ */
+typedef struct CyFxBulkLpPerfStage_t
+{
+    uint32_t ops;                       /* Number of operations. */
+    uint32_t bytes;                     /* Number of bytes processed. */
+    uint32_t timeTotal;                 /* Total time, divided by ops for the average. */
+    uint32_t timeMin;                   /* Minimum time of an operation. */
+    uint32_t timeMax;                   /* Maximum time of an operation. */
+} CyFxBulkLpPerfStage_t;
+
+/*
+ * Performance counters returned by CY_FX_RQT_GET_PERF.
+ */
+typedef struct CyFxBulkLpPerfStats_t
+{
+    uint32_t period;                    /* Time covered by the counters. Holds the start time while counting. */
+    CyFxBulkLpPerfStage_t stage[CY_FX_PERF_N_STAGES];
+} CyFxBulkLpPerfStats_t;
+
+/*
+ * Trace entry.
+ */
+typedef struct CyFxBulkLpTraceEntry_t
+{
+    uint32_t time;                      /* Time of the event in RTOS ticks (1 ms). */
+    uint16_t id;                        /* Event ID, one of CY_FX_TRACE_*. */
+    uint16_t reserved;
+    uint32_t a;                         /* First argument. */
+    uint32_t b;                         /* Second argument. */
+} CyFxBulkLpTraceEntry_t;
+
+/*
+ * Trace ring returned by CY_FX_RQT_GET_TRACE.  The latest event is
+ * stored at entry[(count - 1) % CY_FX_TRACE_DEPTH].
+ */
+typedef struct CyFxBulkLpTrace_t
+{
+    uint32_t count;                     /* Number of events recorded since boot. */
+    uint32_t depth;                     /* Number of entries in the ring. */
+    uint32_t reserved[2];
+    CyFxBulkLpTraceEntry_t entry[CY_FX_TRACE_DEPTH];
+} CyFxBulkLpTrace_t;
+
+/*
+ * Test pattern results returned by CY_FX_RQT_PATTERN_CHECK.
+ * All times are in RTOS ticks (1 ms).
+ */
+typedef struct CyFxBulkLpPatternResult_t
+{
+    uint32_t sendBytes;                 /* Number of bytes sent by the last PATTERN_SEND. */
+    uint32_t sendTime;                  /* Time of the last PATTERN_SEND. */
+    uint32_t checkBytes;                /* Number of bytes received by the last PATTERN_CHECK. */
+    uint32_t checkTime;                 /* Time of the last PATTERN_CHECK. */
+    uint32_t checkErrors;               /* Number of bytes which did not match the pattern. */
+    uint32_t firstError;                /* Offset of the first byte which did not match. */
+    uint8_t  passed;                    /* 1 when the last PATTERN_CHECK is completed without errors. */
+    uint8_t  reserved[3];
+} CyFxBulkLpPatternResult_t;
+
+/*
+ * Throughput counters of the loopback modes returned by
+ * CY_FX_RQT_GET_LOOP_STATS.  In CY_FX_DMA_MODE_LOOP_AUTO the buffers are
+ * not seen by the CPU, so the byte count is taken from the channel and
+ * the buffer count stays 0.
+ */
+typedef struct CyFxBulkLpLoopStats_t
+{
+    uint32_t bytes;                     /* Number of bytes looped back. */
+    uint32_t buffers;                   /* Number of buffers looped back. */
+    uint32_t period;                    /* Time in RTOS ticks (1 ms) since the counters are cleared. */
+    uint8_t  mode;                      /* Current DMA mode. */
+    uint8_t  reserved[3];
+} CyFxBulkLpLoopStats_t;
+
+/*
+ * Byte range sent in the data stage of CY_FX_RQT_FRAM_WRITE_BYTES and
+ * CY_FX_RQT_FRAM_READ_BYTES.
+ */
+typedef struct CyFxBulkLpByteRange_t
+{
+    uint32_t byteAddress;               /* FRAM address of the first byte. */
+    uint32_t byteCount;                 /* Number of bytes. */
+} CyFxBulkLpByteRange_t;
+
+/*
+ * FRAM geometry discovered by the RDID command and returned by
+ * CY_FX_RQT_GET_GEOMETRY.
+ */
+typedef struct CyFxBulkLpFramGeometry_t
+{
+    uint32_t capacity;                  /* FRAM size in bytes. */
+    uint32_t sectorSize;                /* Sector size in bytes. */
+    uint16_t nSectors;                  /* Number of sectors. */
+    uint8_t  addressBytes;              /* Number of address bytes in the commands. */
+    uint8_t  identified;                /* 1 when the FRAM is identified by RDID. */
+    uint8_t  deviceId[9];               /* Response to the RDID command. */
+    uint8_t  reserved[3];
+} CyFxBulkLpFramGeometry_t;
 
 /* Endpoint and socket definitions for the bulkloop application */
 
@@ -95,6 +515,10 @@ extern const uint8_t CyFxUSBStringLangIDDscr[];
 extern const uint8_t CyFxUSBManufactureDscr[];
 extern const uint8_t CyFxUSBProductDscr[];
 
+/* CRC32 engine */
+extern void CyFxBulkLpCrcInit (void);
+extern uint32_t CyFxBulkLpCrcUpdate (uint32_t crc, const uint8_t *data, uint32_t length);
+
 #include "cyu3externcend.h"
 
 #endif /* _INCLUDED_CYFXBULKLPMANINOUT_H_ */
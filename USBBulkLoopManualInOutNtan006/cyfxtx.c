@@ -200,26 +200,133 @@ CyU3PMemFree (
     CyU3PByteFree (mem_p);
 }
 
+/* The memory functions below move 32 bit words over the word aligned part of
+ * the buffers, 32 bytes at a time using LDM/STM bursts of eight registers
+ * on the ARM926 core. Unaligned heads and tails are handled byte by byte.
+ * DMA buffers are always 32 byte aligned, so only the tail of a transfer
+ * goes through the byte loops for these. */
+#if defined (__arm__) && !defined (__thumb__)
+#define CY_U3P_MEM_USE_LDM_STM
+#endif
+
+/* Number of bytes moved in a single burst. */
+#define CY_U3P_MEM_BURST_SIZE           (32)
+
+/* 32 bit word in a byte buffer. The buffers are accessed as uint8_t by the
+ * callers, so the word accesses are marked to alias them. Without it the
+ * compiler may reorder or drop the word accesses under strict aliasing. */
+typedef uint32_t __attribute__ ((__may_alias__)) CyU3PMemWord_t;
+
+/* Fill count bursts of 32 bytes with the word value. */
+static void
+CyU3PMemSetBurst (
+        CyU3PMemWord_t *ptr,
+        uint32_t        value,
+        uint32_t        count)
+{
+#ifdef CY_U3P_MEM_USE_LDM_STM
+    __asm__ __volatile__ (
+            "mov    r3, %2\n\t"
+            "mov    r4, %2\n\t"
+            "mov    r5, %2\n\t"
+            "mov    r6, %2\n\t"
+            "mov    r7, %2\n\t"
+            "mov    r8, %2\n\t"
+            "mov    r9, %2\n\t"
+            "mov    r10, %2\n"
+            "1:\n\t"
+            "stmia  %0!, {r3-r10}\n\t"
+            "subs   %1, %1, #1\n\t"
+            "bne    1b\n\t"
+            : "+r" (ptr), "+r" (count)
+            : "r" (value)
+            : "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "cc", "memory");
+#else
+    while (count--)
+    {
+        ptr[0] = value;
+        ptr[1] = value;
+        ptr[2] = value;
+        ptr[3] = value;
+        ptr[4] = value;
+        ptr[5] = value;
+        ptr[6] = value;
+        ptr[7] = value;
+        ptr += 8;
+    }
+#endif
+}
+
+/* Copy count bursts of 32 bytes between word aligned buffers. */
+static void
+CyU3PMemCopyBurst (
+        CyU3PMemWord_t       *dest,
+        const CyU3PMemWord_t *src,
+        uint32_t              count)
+{
+#ifdef CY_U3P_MEM_USE_LDM_STM
+    __asm__ __volatile__ (
+            "1:\n\t"
+            "ldmia  %1!, {r3-r10}\n\t"
+            "stmia  %0!, {r3-r10}\n\t"
+            "subs   %2, %2, #1\n\t"
+            "bne    1b\n\t"
+            : "+r" (dest), "+r" (src), "+r" (count)
+            :
+            : "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "cc", "memory");
+#else
+    while (count--)
+    {
+        dest[0] = src[0];
+        dest[1] = src[1];
+        dest[2] = src[2];
+        dest[3] = src[3];
+        dest[4] = src[4];
+        dest[5] = src[5];
+        dest[6] = src[6];
+        dest[7] = src[7];
+        dest += 8;
+        src  += 8;
+    }
+#endif
+}
+
 void
 CyU3PMemSet (
         uint8_t *ptr,
         uint8_t data,
         uint32_t count)
 {
-    /* Loop unrolling for faster operation */
-    while (count >> 3)
+    uint32_t value;
+
+    /* Set the bytes up to the first word boundary. */
+    while ((count) && (((uint32_t)ptr & 3) != 0))
+    {
+        *ptr = data;
+        ptr++;
+        count--;
+    }
+
+    /* Set the aligned part a word at a time. */
+    if (count >= 4)
     {
-        ptr[0] = data;
-        ptr[1] = data;
-        ptr[2] = data;
-        ptr[3] = data;
-        ptr[4] = data;
-        ptr[5] = data;
-        ptr[6] = data;
-        ptr[7] = data;
+        value  = data;
+        value |= (value << 8);
+        value |= (value << 16);
 
-        count -= 8;
-        ptr += 8;
+        if (count >= CY_U3P_MEM_BURST_SIZE)
+        {
+            CyU3PMemSetBurst ((CyU3PMemWord_t *)ptr, value, count / CY_U3P_MEM_BURST_SIZE);
+            ptr   += (count & ~(CY_U3P_MEM_BURST_SIZE - 1));
+            count &= (CY_U3P_MEM_BURST_SIZE - 1);
+        }
+
+        while (count >= 4)
+        {
+            *((CyU3PMemWord_t *)ptr) = value;
+            ptr   += 4;
+            count -= 4;
+        }
     }
 
     while (count--)
@@ -235,6 +342,36 @@ CyU3PMemCopy (
         uint8_t *src,
         uint32_t count)
 {
+    /* Words can be moved only if both buffers have the same alignment. */
+    if ((((uint32_t)dest ^ (uint32_t)src) & 3) == 0)
+    {
+        /* Copy the bytes up to the first word boundary. */
+        while ((count) && (((uint32_t)dest & 3) != 0))
+        {
+            *dest = *src;
+            dest++;
+            src++;
+            count--;
+        }
+
+        /* Copy the aligned part a word at a time. */
+        if (count >= CY_U3P_MEM_BURST_SIZE)
+        {
+            CyU3PMemCopyBurst ((CyU3PMemWord_t *)dest, (const CyU3PMemWord_t *)src, count / CY_U3P_MEM_BURST_SIZE);
+            dest  += (count & ~(CY_U3P_MEM_BURST_SIZE - 1));
+            src   += (count & ~(CY_U3P_MEM_BURST_SIZE - 1));
+            count &= (CY_U3P_MEM_BURST_SIZE - 1);
+        }
+
+        while (count >= 4)
+        {
+            *((CyU3PMemWord_t *)dest) = *((const CyU3PMemWord_t *)src);
+            dest  += 4;
+            src   += 4;
+            count -= 4;
+        }
+    }
+
     /* Loop unrolling for faster operation */
     while (count >> 3)
     {
@@ -268,6 +405,42 @@ CyU3PMemCmp (
 {
     const uint8_t *ptr1 = s1, *ptr2 = s2;
 
+    /* Words can be compared only if both buffers have the same alignment. */
+    if ((((uint32_t)ptr1 ^ (uint32_t)ptr2) & 3) == 0)
+    {
+        while ((n) && (((uint32_t)ptr1 & 3) != 0))
+        {
+            if (*ptr1 != *ptr2)
+            {
+                return *ptr1 - *ptr2;
+            }
+
+            ptr1++;
+            ptr2++;
+            n--;
+        }
+
+        /* Skip the equal words. The differing word is compared
+         * byte by byte below to get the sign of the result. */
+        while ((n >= 16) &&
+                (((const CyU3PMemWord_t *)ptr1)[0] == ((const CyU3PMemWord_t *)ptr2)[0]) &&
+                (((const CyU3PMemWord_t *)ptr1)[1] == ((const CyU3PMemWord_t *)ptr2)[1]) &&
+                (((const CyU3PMemWord_t *)ptr1)[2] == ((const CyU3PMemWord_t *)ptr2)[2]) &&
+                (((const CyU3PMemWord_t *)ptr1)[3] == ((const CyU3PMemWord_t *)ptr2)[3]))
+        {
+            ptr1 += 16;
+            ptr2 += 16;
+            n    -= 16;
+        }
+
+        while ((n >= 4) && (*((const CyU3PMemWord_t *)ptr1) == *((const CyU3PMemWord_t *)ptr2)))
+        {
+            ptr1 += 4;
+            ptr2 += 4;
+            n    -= 4;
+        }
+    }
+
     while(n--)
     {
         if(*ptr1 != *ptr2)
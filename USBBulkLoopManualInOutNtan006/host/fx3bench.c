@@ -0,0 +1,650 @@
+/*
+ * Benchmark of the FRAM WRITE and READ requests
+ *
+ * Each data set is written to every sector with CY_FX_RQT_FRAM_WRITE,
+ * read back with CY_FX_RQT_FRAM_READ and compared. The data sets are the
+ * pattern files 1000.txt to 4000.txt and pseudo random data of the sizes
+ * given with -t, 1 byte to 20 KB by default. One CSV line is printed per
+ * speed, DMA mode and data set with the throughput and the 50th and 99th
+ * percentile of the request latency:
+ *
+ *      fx3bench [-D] [-u fs,hs,ss] [-m cpu,direct,callback] [-r rounds]
+ *               [-p pattern directory] [-t sizes]
+ *
+ * By default the firmware runs on the simulated FX3 with the SPI and USB
+ * timing, once per speed of -u. With -D the benchmark drives a real
+ * device through libusb at the speed it is connected at; this needs a
+ * build with LIBUSB=1. The latency of a WRITE ends when the device has
+ * written the data to FRAM, which the host sees by a one byte
+ * CY_FX_RQT_FRAM_EP0 read. That request is stalled until all the queued
+ * requests are served. The exit status is 1 when a transfer fails or the
+ * data read back differs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "fx3sim.h"
+#include "cyfxbulklpmaninout.h"
+
+#ifdef HAVE_LIBUSB
+#include <libusb.h>
+#endif
+
+#define BENCH_XFER_TIMEOUT      (5000)  /* Time limit of a transfer in ms */
+#define BENCH_POLL_TIMEOUT      (5000)  /* Time limit to wait for a queued request in ms */
+#define BENCH_VID               (0x04B4)
+#define BENCH_PID               (0x00F0)
+
+#define BENCH_RQT_OUT           (0x40)
+#define BENCH_RQT_IN            (0xC0)
+
+#define BENCH_N_PATTERNS        (4)
+#define BENCH_MAX_LIST          (32)
+
+typedef struct BenchSet_t
+{
+    const char  *name;                  /* Pattern file, or "random" */
+    uint8_t     *data;                  /* Content of the pattern file */
+    uint32_t    length;                 /* Bytes per request */
+} BenchSet_t;
+
+typedef struct BenchResult_t
+{
+    double      total;                  /* Sum of the latencies in us */
+    double      p50;                    /* Latency percentiles in us */
+    double      p99;
+} BenchResult_t;
+
+/* Transfer functions of the device, the simulation or libusb. The return
+ * values are the ones of libusb. */
+static int (*glBenchControl) (uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue,
+        uint16_t wIndex, uint8_t *data, uint16_t wLength, uint32_t timeout);
+static int (*glBenchBulkOut) (uint8_t ep, const uint8_t *data, uint32_t length,
+        uint32_t *transferred, uint32_t timeout);
+static int (*glBenchBulkIn) (uint8_t ep, uint8_t *data, uint32_t length,
+        uint32_t *transferred, uint32_t timeout);
+
+static uint16_t glBenchPacketSize;      /* Packet size of the bulk endpoints */
+static uint8_t  glBenchDmaMode;         /* DMA mode of the run */
+static uint32_t glBenchSeed = 1;        /* State of the data generator */
+
+static double
+BenchTime (
+    void
+) {
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Fill a buffer with pseudo random data. */
+static void
+BenchFill (
+    uint8_t     *data,
+    uint32_t    length
+) {
+    while (length-- > 0) {
+        glBenchSeed = glBenchSeed * 1103515245 + 12345;
+        *data++ = (uint8_t)(glBenchSeed >> 16);
+    }
+}
+
+static int
+BenchCompareLatency (
+    const void  *a,
+    const void  *b
+) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Sum and nearest rank percentiles of the latencies. The list is sorted. */
+static void
+BenchStats (
+    double          *latency,
+    uint32_t        count,
+    BenchResult_t   *result
+) {
+    uint32_t i;
+
+    qsort (latency, count, sizeof (double), BenchCompareLatency);
+    result->total = 0;
+    for (i = 0; i < count; i++) {
+        result->total += latency[i];
+    }
+    result->p50 = latency[(count * 50 + 99) / 100 - 1];
+    result->p99 = latency[(count * 99 + 99) / 100 - 1];
+}
+
+/* Send the data of a WRITE request. In the CPU DMA modes the end of a
+ * transfer shorter than the DMA buffer and of a multiple of the packet
+ * size is marked by a ZLP. The direct mode takes the exact length. */
+static int
+BenchWrite (
+    uint16_t        sector,
+    const uint8_t   *data,
+    uint32_t        length
+) {
+    uint32_t transferred = 0;
+    int status;
+
+    status = glBenchControl (BENCH_RQT_OUT, CY_FX_RQT_FRAM_WRITE, length, sector, NULL, 0,
+            BENCH_XFER_TIMEOUT);
+    if (status == 0) {
+        status = glBenchBulkOut (CY_FX_EP_PRODUCER, data, length, &transferred,
+                BENCH_XFER_TIMEOUT);
+    }
+    if ((status == 0) && (transferred == length) && (length < CY_FX_BULKLP_DMA_BUF_SIZE) &&
+            (glBenchDmaMode != CY_FX_DMA_MODE_DIRECT) && ((length % glBenchPacketSize) == 0)) {
+        status = glBenchBulkOut (CY_FX_EP_PRODUCER, NULL, 0, &transferred, BENCH_XFER_TIMEOUT);
+        transferred = length;
+    }
+    if ((status == 0) && (transferred != length)) {
+        status = FX3SIM_ERROR_IO;
+    }
+    if (status != 0) {
+        fprintf (stderr, "WRITE of %u bytes to sector %u failed: %d\n", length, sector, status);
+    }
+    return status;
+}
+
+/* Receive the data of a READ request, and the ZLP which follows a
+ * multiple of the packet size in the CPU DMA modes. */
+static int
+BenchRead (
+    uint16_t    sector,
+    uint8_t     *data,
+    uint32_t    length
+) {
+    uint32_t transferred = 0;
+    int status;
+
+    status = glBenchControl (BENCH_RQT_OUT, CY_FX_RQT_FRAM_READ, length, sector, NULL, 0,
+            BENCH_XFER_TIMEOUT);
+    if (status == 0) {
+        status = glBenchBulkIn (CY_FX_EP_CONSUMER, data, length, &transferred,
+                BENCH_XFER_TIMEOUT);
+    }
+    if ((status == 0) && (transferred == length) &&
+            (glBenchDmaMode != CY_FX_DMA_MODE_DIRECT) && ((length % glBenchPacketSize) == 0)) {
+        status = glBenchBulkIn (CY_FX_EP_CONSUMER, data + length, glBenchPacketSize,
+                &transferred, BENCH_XFER_TIMEOUT);
+        transferred = (transferred == 0) ? length : 0;
+    }
+    if ((status == 0) && (transferred != length)) {
+        status = FX3SIM_ERROR_IO;
+    }
+    if (status != 0) {
+        fprintf (stderr, "READ of %u bytes from sector %u failed: %d\n", length, sector, status);
+    }
+    return status;
+}
+
+/* Wait until the device has served the queued requests. A FRAM_EP0
+ * read is stalled before. */
+static int
+BenchWaitIdle (
+    void
+) {
+    uint8_t data;
+    double start = BenchTime ();
+    int status;
+
+    do {
+        status = glBenchControl (BENCH_RQT_IN, CY_FX_RQT_FRAM_EP0, 0, 0, &data, 1,
+                BENCH_XFER_TIMEOUT);
+        if ((status != 1) && ((status != FX3SIM_ERROR_PIPE) ||
+                    (BenchTime () - start > BENCH_POLL_TIMEOUT * 1000.0))) {
+            fprintf (stderr, "device does not complete the requests: %d\n", status);
+            return -1;
+        }
+    } while (status != 1);
+    return 0;
+}
+
+/* Select the DMA mode and wait until the queued request is served. */
+static int
+BenchSetDmaMode (
+    uint8_t     mode
+) {
+    CyFxBulkLpLoopStats_t stats;
+    double start = BenchTime ();
+
+    if (glBenchControl (BENCH_RQT_OUT, CY_FX_RQT_SET_DMA_MODE, mode, 0, NULL, 0,
+                BENCH_XFER_TIMEOUT) != 0) {
+        return -1;
+    }
+    do {
+        usleep (1000);
+        if ((glBenchControl (BENCH_RQT_IN, CY_FX_RQT_GET_LOOP_STATS, 0, 0, (uint8_t *)&stats,
+                        sizeof (stats), BENCH_XFER_TIMEOUT) != sizeof (stats)) ||
+                (BenchTime () - start > BENCH_POLL_TIMEOUT * 1000.0)) {
+            return -1;
+        }
+    } while (stats.mode != mode);
+    glBenchDmaMode = mode;
+    return 0;
+}
+
+/* Write and read back each data set on all sectors, rounds times, and
+ * print a CSV line per set. Returns the number of errors. */
+static int
+BenchRun (
+    const char      *backend,
+    const char      *speedName,
+    const char      *modeName,
+    uint8_t         mode,
+    const BenchSet_t *sets,
+    int             nSets,
+    uint32_t        rounds
+) {
+    static uint8_t data[CY_FX_BULKLP_DMA_BUF_SIZE];
+    static uint8_t readBack[CY_FX_BULKLP_DMA_BUF_SIZE + 1024];
+    CyFxBulkLpFramGeometry_t geometry;
+    BenchResult_t writeResult;
+    BenchResult_t readResult;
+    double *writeLatency;
+    double *readLatency;
+    double start;
+    uint32_t count;
+    uint32_t errors;
+    uint32_t failed = 0;
+    uint32_t r;
+    uint16_t sector;
+    int i;
+
+    if (glBenchControl (BENCH_RQT_IN, CY_FX_RQT_GET_GEOMETRY, 0, 0, (uint8_t *)&geometry,
+                sizeof (geometry), BENCH_XFER_TIMEOUT) != sizeof (geometry)) {
+        fprintf (stderr, "GET_GEOMETRY failed\n");
+        return 1;
+    }
+    if (BenchSetDmaMode (mode) != 0) {
+        fprintf (stderr, "SET_DMA_MODE %s failed\n", modeName);
+        return 1;
+    }
+
+    writeLatency = malloc (rounds * geometry.nSectors * sizeof (double));
+    readLatency  = malloc (rounds * geometry.nSectors * sizeof (double));
+    if ((writeLatency == NULL) || (readLatency == NULL)) {
+        fprintf (stderr, "out of memory\n");
+        exit (2);
+    }
+
+    for (i = 0; i < nSets; i++) {
+        count  = 0;
+        errors = 0;
+        for (r = 0; r < rounds; r++) {
+            for (sector = 0; sector < geometry.nSectors; sector++) {
+                if (sets[i].data != NULL) {
+                    memcpy (data, sets[i].data, sets[i].length);
+                } else {
+                    BenchFill (data, sets[i].length);
+                }
+
+                start = BenchTime ();
+                if ((BenchWrite (sector, data, sets[i].length) != 0) || (BenchWaitIdle () != 0)) {
+                    goto abort;
+                }
+                writeLatency[count] = BenchTime () - start;
+
+                memset (readBack, 0, sets[i].length);
+                start = BenchTime ();
+                if (BenchRead (sector, readBack, sets[i].length) != 0) {
+                    goto abort;
+                }
+                readLatency[count] = BenchTime () - start;
+                count++;
+
+                if (memcmp (data, readBack, sets[i].length) != 0) {
+                    fprintf (stderr, "%s: data of %u bytes in sector %u differs\n",
+                            sets[i].name, sets[i].length, sector);
+                    errors++;
+                }
+            }
+        }
+
+        BenchStats (writeLatency, count, &writeResult);
+        BenchStats (readLatency, count, &readResult);
+        printf ("%s,%s,%u,%s,%s,%u,%u,%u,%.3f,%.1f,%.1f,%.3f,%.1f,%.1f\n",
+                backend, speedName, glBenchPacketSize, modeName, sets[i].name,
+                sets[i].length, count, errors,
+                (double)sets[i].length * count / writeResult.total, writeResult.p50, writeResult.p99,
+                (double)sets[i].length * count / readResult.total, readResult.p50, readResult.p99);
+        fflush (stdout);
+        failed += errors;
+    }
+
+    free (writeLatency);
+    free (readLatency);
+    return (failed != 0);
+
+abort:
+    free (writeLatency);
+    free (readLatency);
+    return 1;
+}
+
+/* Run the benchmark on the simulated FX3 in a child process, as the
+ * firmware can be booted once. */
+static int
+BenchRunSim (
+    CyU3PUSBSpeed_t     speed,
+    const char          *speedName,
+    const char          *const modeNames[],
+    const uint8_t       modes[],
+    int                 nModes,
+    const BenchSet_t    *sets,
+    int                 nSets,
+    uint32_t            rounds
+) {
+    FX3SimConfig_t config;
+    uint8_t burstLen;
+    uint8_t maxBurst;
+    int failed = 0;
+    int status;
+    int m;
+    pid_t pid;
+
+    fflush (stdout);
+    pid = fork ();
+    if (pid < 0) {
+        perror ("fork");
+        return 1;
+    }
+    if (pid == 0) {
+        FX3SimDefaultConfig (&config);
+        config.usbTiming = CyTrue;
+        if ((FX3SimStart (&config) != FX3SIM_SUCCESS) ||
+                (FX3SimEnumerate (speed) != FX3SIM_SUCCESS) ||
+                (FX3SimEndpointInfo (CY_FX_EP_PRODUCER, &glBenchPacketSize,
+                                     &burstLen, &maxBurst) != FX3SIM_SUCCESS)) {
+            fprintf (stderr, "simulated device does not start\n");
+            _exit (1);
+        }
+        glBenchControl = FX3SimControl;
+        glBenchBulkOut = FX3SimBulkOut;
+        glBenchBulkIn  = FX3SimBulkIn;
+        for (m = 0; m < nModes; m++) {
+            failed |= BenchRun ("sim", speedName, modeNames[modes[m]], modes[m], sets, nSets, rounds);
+        }
+        if (FX3SimErrorCount () != 0) {
+            fprintf (stderr, "%u simulation errors\n", FX3SimErrorCount ());
+            failed = 1;
+        }
+        _exit (failed);
+    }
+
+    if (waitpid (pid, &status, 0) < 0) {
+        perror ("waitpid");
+        return 1;
+    }
+    return !(WIFEXITED (status) && (WEXITSTATUS (status) == 0));
+}
+
+#ifdef HAVE_LIBUSB
+static libusb_device_handle *glBenchHandle;
+
+static int
+BenchUsbControl (
+    uint8_t     bmRequestType,
+    uint8_t     bRequest,
+    uint16_t    wValue,
+    uint16_t    wIndex,
+    uint8_t     *data,
+    uint16_t    wLength,
+    uint32_t    timeout
+) {
+    return libusb_control_transfer (glBenchHandle, bmRequestType, bRequest, wValue, wIndex,
+            data, wLength, timeout);
+}
+
+static int
+BenchUsbBulkOut (
+    uint8_t         ep,
+    const uint8_t   *data,
+    uint32_t        length,
+    uint32_t        *transferred,
+    uint32_t        timeout
+) {
+    int count = 0;
+    int status;
+
+    status = libusb_bulk_transfer (glBenchHandle, ep, (uint8_t *)data, length, &count, timeout);
+    *transferred = count;
+    return status;
+}
+
+static int
+BenchUsbBulkIn (
+    uint8_t     ep,
+    uint8_t     *data,
+    uint32_t    length,
+    uint32_t    *transferred,
+    uint32_t    timeout
+) {
+    int count = 0;
+    int status;
+
+    status = libusb_bulk_transfer (glBenchHandle, ep, data, length, &count, timeout);
+    *transferred = count;
+    return status;
+}
+
+/* Run the benchmark on the device connected by USB. */
+static int
+BenchRunDevice (
+    const char          *const modeNames[],
+    const uint8_t       modes[],
+    int                 nModes,
+    const BenchSet_t    *sets,
+    int                 nSets,
+    uint32_t            rounds
+) {
+    const char *speedName;
+    int failed = 0;
+    int m;
+
+    if (libusb_init (NULL) != 0) {
+        fprintf (stderr, "libusb_init failed\n");
+        return 1;
+    }
+    glBenchHandle = libusb_open_device_with_vid_pid (NULL, BENCH_VID, BENCH_PID);
+    if ((glBenchHandle == NULL) || (libusb_claim_interface (glBenchHandle, 0) != 0)) {
+        fprintf (stderr, "device %04x:%04x not found\n", BENCH_VID, BENCH_PID);
+        libusb_exit (NULL);
+        return 1;
+    }
+
+    switch (libusb_get_device_speed (libusb_get_device (glBenchHandle))) {
+        case LIBUSB_SPEED_FULL:  speedName = "fs"; break;
+        case LIBUSB_SPEED_HIGH:  speedName = "hs"; break;
+        case LIBUSB_SPEED_SUPER: speedName = "ss"; break;
+        default:                 speedName = "unknown"; break;
+    }
+    glBenchPacketSize = libusb_get_max_packet_size (libusb_get_device (glBenchHandle),
+            CY_FX_EP_PRODUCER);
+    glBenchControl = BenchUsbControl;
+    glBenchBulkOut = BenchUsbBulkOut;
+    glBenchBulkIn  = BenchUsbBulkIn;
+
+    for (m = 0; m < nModes; m++) {
+        failed |= BenchRun ("usb", speedName, modeNames[modes[m]], modes[m], sets, nSets, rounds);
+    }
+
+    libusb_release_interface (glBenchHandle, 0);
+    libusb_close (glBenchHandle);
+    libusb_exit (NULL);
+    return failed;
+}
+#endif
+
+/* Load a pattern file. It must not be larger than a DMA buffer. */
+static uint8_t *
+BenchLoad (
+    const char  *path,
+    uint32_t    *length
+) {
+    uint8_t *data;
+    size_t count;
+    FILE *fp;
+
+    fp = fopen (path, "rb");
+    if (fp == NULL) {
+        perror (path);
+        return NULL;
+    }
+    data = malloc (CY_FX_BULKLP_DMA_BUF_SIZE + 1);
+    count = (data != NULL) ? fread (data, 1, CY_FX_BULKLP_DMA_BUF_SIZE + 1, fp) : 0;
+    fclose (fp);
+    if ((count == 0) || (count > CY_FX_BULKLP_DMA_BUF_SIZE)) {
+        fprintf (stderr, "%s: size must be 1 to %u bytes\n", path, CY_FX_BULKLP_DMA_BUF_SIZE);
+        free (data);
+        return NULL;
+    }
+    *length = count;
+    return data;
+}
+
+/* Parse a comma separated list of numbers. Returns the count or -1. */
+static int
+BenchParseList (
+    const char  *text,
+    uint32_t    *list
+) {
+    int count = 0;
+    char *end;
+
+    while ((*text != '\0') && (count < BENCH_MAX_LIST)) {
+        list[count++] = strtoul (text, &end, 0);
+        if ((end == text) || ((*end != ',') && (*end != '\0'))) {
+            return -1;
+        }
+        text = (*end == ',') ? end + 1 : end;
+    }
+    return count;
+}
+
+/* Parse a comma separated list of names into their indices in names[]. */
+static int
+BenchParseNames (
+    const char  *text,
+    const char  *const names[],
+    int         nNames,
+    uint8_t     *list
+) {
+    char copy[256];
+    char *name;
+    int count = 0;
+    int i;
+
+    snprintf (copy, sizeof (copy), "%s", text);
+    for (name = strtok (copy, ","); name != NULL; name = strtok (NULL, ",")) {
+        for (i = 0; (i < nNames) && ((names[i] == NULL) || (strcmp (name, names[i]) != 0)); i++)
+            ;
+        if ((i == nNames) || (count == BENCH_MAX_LIST)) {
+            return -1;
+        }
+        list[count++] = i;
+    }
+    return count;
+}
+
+static void
+BenchUsage (
+    void
+) {
+    fprintf (stderr,
+            "usage: fx3bench [-D] [-u fs,hs,ss] [-m cpu,direct,callback] [-r rounds]\n"
+            "                [-p pattern directory] [-t sizes]\n");
+    exit (2);
+}
+
+int
+main (
+    int     argc,
+    char    *argv[]
+) {
+    /* Names of the DMA modes by their CY_FX_DMA_MODE_xxx value. The loop
+     * back modes do not serve the FRAM requests. */
+    static const char *const modeNames[] = { "cpu", "direct", NULL, NULL, NULL, "callback" };
+    static const char *const speedNames[] = { "fs", "hs", "ss" };
+    static const CyU3PUSBSpeed_t speeds[] = { CY_U3P_FULL_SPEED, CY_U3P_HIGH_SPEED, CY_U3P_SUPER_SPEED };
+    static const char *const patternNames[BENCH_N_PATTERNS] =
+            { "1000.txt", "2000.txt", "3000.txt", "4000.txt" };
+    uint32_t sizes[BENCH_MAX_LIST] = { 1, 63, 64, 512, 1000, 1024, 1025, 4096, 10240,
+                                       16384, 20479, CY_FX_BULKLP_DMA_BUF_SIZE };
+    uint8_t speedList[BENCH_MAX_LIST] = { 0, 1, 2 };
+    uint8_t modeList[BENCH_MAX_LIST] = { CY_FX_DMA_MODE_CPU };
+    BenchSet_t sets[BENCH_N_PATTERNS + BENCH_MAX_LIST];
+    const char *patternDir = "..";
+    char path[1024];
+    int useDevice = 0;
+    int nSizes = 12, nSpeeds = 3, nModes = 1, nSets = 0;
+    uint32_t rounds = 2;
+    int failed = 0;
+    int opt;
+    int i;
+
+    while ((opt = getopt (argc, argv, "Du:m:r:p:t:")) != -1) {
+        switch (opt) {
+            case 'D': useDevice = 1; break;
+            case 'u': nSpeeds = BenchParseNames (optarg, speedNames, 3, speedList); break;
+            case 'm': nModes  = BenchParseNames (optarg, modeNames, 6, modeList); break;
+            case 'r': rounds  = strtoul (optarg, NULL, 0); break;
+            case 'p': patternDir = optarg; break;
+            case 't': nSizes  = BenchParseList (optarg, sizes); break;
+            default:  BenchUsage ();
+        }
+    }
+    if ((optind != argc) || (nSpeeds <= 0) || (nModes <= 0) || (nSizes < 0) || (rounds == 0)) {
+        BenchUsage ();
+    }
+    for (i = 0; i < nSizes; i++) {
+        if ((sizes[i] == 0) || (sizes[i] > CY_FX_BULKLP_DMA_BUF_SIZE)) {
+            BenchUsage ();
+        }
+    }
+
+    for (i = 0; i < BENCH_N_PATTERNS; i++) {
+        snprintf (path, sizeof (path), "%s/%s", patternDir, patternNames[i]);
+        sets[nSets].name = patternNames[i];
+        sets[nSets].data = BenchLoad (path, &sets[nSets].length);
+        if (sets[nSets].data == NULL) {
+            return 2;
+        }
+        nSets++;
+    }
+    for (i = 0; i < nSizes; i++) {
+        sets[nSets].name   = "random";
+        sets[nSets].data   = NULL;
+        sets[nSets].length = sizes[i];
+        nSets++;
+    }
+
+    printf ("backend,speed,packet,mode,data,request_bytes,requests,errors,"
+            "write_mb_s,write_p50_us,write_p99_us,read_mb_s,read_p50_us,read_p99_us\n");
+
+    if (useDevice) {
+#ifdef HAVE_LIBUSB
+        failed = BenchRunDevice (modeNames, modeList, nModes, sets, nSets, rounds);
+#else
+        fprintf (stderr, "fx3bench is built without libusb, use make LIBUSB=1\n");
+        failed = 1;
+#endif
+    } else {
+        for (i = 0; i < nSpeeds; i++) {
+            failed |= BenchRunSim (speeds[speedList[i]], speedNames[speedList[i]],
+                    modeNames, modeList, nModes, sets, nSets, rounds);
+        }
+    }
+
+    return (failed != 0);
+}
@@ -0,0 +1,453 @@
+/*
+ * Discrete-event model of the FRAM READ/WRITE pipeline
+ *
+ * A request moves its data through a ring of DMA buffers between the USB
+ * endpoint and the SPI block. The producer (USB for WRITE, SPI for READ)
+ * fills the empty buffers in order, the CPU hands each full buffer over,
+ * and the consumer drains the handed over buffers in order. The three
+ * stages are servers that take one buffer at a time, so the model shows
+ * how the buffer size and count hide the time of the slower stage.
+ *
+ * The model sweeps the buffer size and count, the SPI clock, the USB
+ * speed (64, 512 or 1024 byte packets), the SuperSpeed burst length and
+ * the DMA mode, and prints one CSV line per point:
+ *
+ *      fx3des [-d read,write] [-m cpu,direct] [-u fs,hs,ss] [-l bursts]
+ *             [-b buffer sizes] [-n buffer counts] [-c SPI clocks in kHz]
+ *             [-t bytes per request] [-r requests]
+ *
+ * All lists are comma separated. The USB time of a packet and a burst is
+ * the one of the USB model in simusb.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+/* USB bus time per byte in ps and per burst in ns */
+#define DES_SS_BYTE_PS          (2200)
+#define DES_SS_BURST_NS         (2000)
+#define DES_HS_BYTE_PS          (22000)
+#define DES_HS_BURST_NS         (1000)
+#define DES_FS_BYTE_PS          (1000000)
+#define DES_FS_BURST_NS         (10000)
+
+/* CPU time to hand a buffer over from the producer to the consumer in
+ * the CPU mode: GetBuffer, Commit and the thread switch. The AUTO
+ * channels of the direct mode take no CPU time. */
+#define DES_CPU_BUFFER_NS       (12000)
+
+/* Time of a request before its first buffer: the control transfer, the
+ * queue and the thread wake up. */
+#define DES_REQUEST_NS          (60000)
+
+/* SPI command and address sent at the start of a request, and the set up
+ * time of each SPI block transfer. */
+#define DES_SPI_CMD_BYTES       (4)
+#define DES_SPI_SETUP_NS        (3000)
+
+#define DES_MAX_BUFFERS         (16)
+#define DES_MAX_LIST            (32)
+
+/* States of a DMA buffer */
+#define DES_BUF_EMPTY           (0)
+#define DES_BUF_FILLING         (1)
+#define DES_BUF_FULL            (2)
+#define DES_BUF_HANDOFF         (3)
+#define DES_BUF_READY           (4)
+#define DES_BUF_DRAINING        (5)
+
+/* Stages of the pipeline, used as the event types */
+#define DES_STAGE_PROD          (0)
+#define DES_STAGE_CPU           (1)
+#define DES_STAGE_CONS          (2)
+#define DES_STAGE_REQUEST       (3)
+#define DES_N_STAGES            (4)
+
+typedef struct DesConfig_t
+{
+    int         isRead;                 /* 1 for READ, 0 for WRITE */
+    int         isDirect;               /* 1 for the direct DMA mode */
+    uint16_t    pcktSize;               /* USB packet size: 64, 512 or 1024 */
+    uint8_t     burstLen;               /* USB burst length in packets */
+    uint32_t    bufSize;                /* DMA buffer size in bytes */
+    uint8_t     bufCount;               /* Number of DMA buffers */
+    uint32_t    spiClock;               /* SPI clock in Hz */
+    uint32_t    xferSize;               /* Bytes per request */
+    uint32_t    nRequests;              /* Number of requests */
+} DesConfig_t;
+
+typedef struct DesResult_t
+{
+    uint64_t    time;                   /* Time of the last request in ns */
+    uint64_t    latencyTotal;           /* Sum of the request latencies in ns */
+    uint64_t    latencyMax;             /* Maximum request latency in ns */
+    uint64_t    busy[DES_N_STAGES];     /* Busy time of the stages in ns */
+} DesResult_t;
+
+typedef struct DesEvent_t
+{
+    uint64_t    time;                   /* Time of the event in ns */
+    int         stage;                  /* Stage which completes, DES_STAGE_xxx */
+    int         buffer;                 /* Buffer index */
+} DesEvent_t;
+
+/* State of the model */
+typedef struct DesState_t
+{
+    const DesConfig_t *config_p;
+    DesResult_t *result_p;
+    uint64_t    now;
+    DesEvent_t  event[DES_N_STAGES];    /* Each stage has at most one pending event */
+    int         nEvents;
+    int         busy[DES_N_STAGES];
+    uint8_t     bufState[DES_MAX_BUFFERS];
+    uint32_t    bufCount[DES_MAX_BUFFERS];
+    int         prodIdx;
+    int         cpuIdx;
+    int         consIdx;
+    uint32_t    request;                /* Number of the current request */
+    uint64_t    requestStart;           /* Time the current request is issued */
+    int         requestActive;
+    uint32_t    produced;               /* Bytes of the request produced */
+    uint32_t    consumed;               /* Bytes of the request consumed */
+} DesState_t;
+
+/* USB time of a buffer. A burst does not cross the buffers. */
+static uint64_t
+DesUsbTime (
+    const DesConfig_t   *config_p,
+    uint32_t            count
+) {
+    uint32_t packets = (count + config_p->pcktSize - 1) / config_p->pcktSize;
+    uint32_t bursts  = (packets + config_p->burstLen - 1) / config_p->burstLen;
+
+    switch (config_p->pcktSize) {
+        case 1024:
+            return (uint64_t)count * DES_SS_BYTE_PS / 1000 + (uint64_t)bursts * DES_SS_BURST_NS;
+        case 512:
+            return (uint64_t)count * DES_HS_BYTE_PS / 1000 + (uint64_t)packets * DES_HS_BURST_NS;
+        default:
+            return (uint64_t)count * DES_FS_BYTE_PS / 1000 + (uint64_t)packets * DES_FS_BURST_NS;
+    }
+}
+
+/* SPI time of a buffer. The command goes with the first buffer of a
+ * request. */
+static uint64_t
+DesSpiTime (
+    const DesConfig_t   *config_p,
+    uint32_t            count,
+    int                 isFirst
+) {
+    uint64_t bits = (uint64_t)count * 8;
+
+    if (isFirst) {
+        bits += DES_SPI_CMD_BYTES * 8;
+    }
+    return bits * 1000000000ULL / config_p->spiClock + DES_SPI_SETUP_NS;
+}
+
+static void
+DesSchedule (
+    DesState_t  *state_p,
+    int         stage,
+    int         buffer,
+    uint64_t    duration
+) {
+    DesEvent_t *event_p = &state_p->event[state_p->nEvents++];
+
+    event_p->time   = state_p->now + duration;
+    event_p->stage  = stage;
+    event_p->buffer = buffer;
+    state_p->busy[stage] = 1;
+    state_p->result_p->busy[stage] += duration;
+}
+
+/* Take the earliest event. The stages are served in the pipeline order
+ * when the events are at the same time. */
+static int
+DesNextEvent (
+    DesState_t  *state_p,
+    DesEvent_t  *event_p
+) {
+    int first = 0;
+    int i;
+
+    if (state_p->nEvents == 0) {
+        return 0;
+    }
+    for (i = 1; i < state_p->nEvents; i++) {
+        if ((state_p->event[i].time < state_p->event[first].time) ||
+                ((state_p->event[i].time == state_p->event[first].time) &&
+                 (state_p->event[i].stage > state_p->event[first].stage))) {
+            first = i;
+        }
+    }
+    *event_p = state_p->event[first];
+    state_p->event[first] = state_p->event[--state_p->nEvents];
+    state_p->busy[event_p->stage] = 0;
+    state_p->now = event_p->time;
+    return 1;
+}
+
+/* Start the work of the idle stages. */
+static void
+DesDispatch (
+    DesState_t  *state_p
+) {
+    const DesConfig_t *config_p = state_p->config_p;
+    uint32_t count;
+    int isFirst;
+    int i;
+
+    if ((!state_p->busy[DES_STAGE_PROD]) && (state_p->requestActive) &&
+            (state_p->produced < config_p->xferSize) &&
+            (state_p->bufState[state_p->prodIdx] == DES_BUF_EMPTY)) {
+        i = state_p->prodIdx;
+        count = config_p->xferSize - state_p->produced;
+        if (count > config_p->bufSize) {
+            count = config_p->bufSize;
+        }
+        isFirst = (state_p->produced == 0);
+        state_p->produced += count;
+        state_p->bufState[i] = DES_BUF_FILLING;
+        state_p->bufCount[i] = count;
+        state_p->prodIdx = (i + 1) % config_p->bufCount;
+        DesSchedule (state_p, DES_STAGE_PROD, i, (config_p->isRead) ?
+                DesSpiTime (config_p, count, isFirst) : DesUsbTime (config_p, count));
+    }
+
+    if ((!state_p->busy[DES_STAGE_CPU]) &&
+            (state_p->bufState[state_p->cpuIdx] == DES_BUF_FULL)) {
+        i = state_p->cpuIdx;
+        state_p->bufState[i] = DES_BUF_HANDOFF;
+        state_p->cpuIdx = (i + 1) % config_p->bufCount;
+        DesSchedule (state_p, DES_STAGE_CPU, i, (config_p->isDirect) ? 0 : DES_CPU_BUFFER_NS);
+    }
+
+    if ((!state_p->busy[DES_STAGE_CONS]) &&
+            (state_p->bufState[state_p->consIdx] == DES_BUF_READY)) {
+        i = state_p->consIdx;
+        count = state_p->bufCount[i];
+        isFirst = (state_p->consumed == 0);
+        state_p->bufState[i] = DES_BUF_DRAINING;
+        state_p->consIdx = (i + 1) % config_p->bufCount;
+        DesSchedule (state_p, DES_STAGE_CONS, i, (config_p->isRead) ?
+                DesUsbTime (config_p, count) : DesSpiTime (config_p, count, isFirst));
+    }
+}
+
+/* Run the requests of a configuration one after the other. */
+static void
+DesRun (
+    const DesConfig_t   *config_p,
+    DesResult_t         *result_p
+) {
+    DesState_t state;
+    DesEvent_t event;
+    uint64_t latency;
+
+    memset (&state, 0, sizeof (state));
+    memset (result_p, 0, sizeof (*result_p));
+    state.config_p = config_p;
+    state.result_p = result_p;
+
+    DesSchedule (&state, DES_STAGE_REQUEST, 0, DES_REQUEST_NS);
+    while (DesNextEvent (&state, &event)) {
+        switch (event.stage) {
+            case DES_STAGE_REQUEST:
+                state.requestActive = 1;
+                state.produced = 0;
+                state.consumed = 0;
+                break;
+            case DES_STAGE_PROD:
+                state.bufState[event.buffer] = DES_BUF_FULL;
+                break;
+            case DES_STAGE_CPU:
+                state.bufState[event.buffer] = DES_BUF_READY;
+                break;
+            case DES_STAGE_CONS:
+                state.bufState[event.buffer] = DES_BUF_EMPTY;
+                state.consumed += state.bufCount[event.buffer];
+                if (state.consumed == config_p->xferSize) {
+                    latency = state.now - state.requestStart;
+                    result_p->latencyTotal += latency;
+                    if (latency > result_p->latencyMax) {
+                        result_p->latencyMax = latency;
+                    }
+                    state.requestActive = 0;
+                    if (++state.request < config_p->nRequests) {
+                        state.requestStart = state.now;
+                        DesSchedule (&state, DES_STAGE_REQUEST, 0, DES_REQUEST_NS);
+                    }
+                }
+                break;
+        }
+        DesDispatch (&state);
+    }
+    result_p->time = state.now;
+}
+
+/* Parse a comma separated list of numbers. */
+static int
+DesParseList (
+    const char  *text,
+    uint32_t    *list
+) {
+    int count = 0;
+    char *end;
+
+    while ((*text != '\0') && (count < DES_MAX_LIST)) {
+        list[count++] = strtoul (text, &end, 0);
+        if ((end == text) || ((*end != ',') && (*end != '\0'))) {
+            return -1;
+        }
+        text = (*end == ',') ? end + 1 : end;
+    }
+    return count;
+}
+
+/* Parse a comma separated list of names into their indices in names[]. */
+static int
+DesParseNames (
+    const char  *text,
+    const char  *const names[],
+    int         nNames,
+    uint32_t    *list
+) {
+    char copy[256];
+    char *name;
+    int count = 0;
+    int i;
+
+    snprintf (copy, sizeof (copy), "%s", text);
+    for (name = strtok (copy, ","); name != NULL; name = strtok (NULL, ",")) {
+        for (i = 0; (i < nNames) && (strcmp (name, names[i]) != 0); i++)
+            ;
+        if ((i == nNames) || (count == DES_MAX_LIST)) {
+            return -1;
+        }
+        list[count++] = i;
+    }
+    return count;
+}
+
+static void
+DesUsage (
+    void
+) {
+    fprintf (stderr,
+            "usage: fx3des [-d read,write] [-m cpu,direct] [-u fs,hs,ss] [-l bursts]\n"
+            "              [-b buffer sizes] [-n buffer counts] [-c SPI clocks in kHz]\n"
+            "              [-t bytes per request] [-r requests]\n");
+    exit (2);
+}
+
+int
+main (
+    int     argc,
+    char    *argv[]
+) {
+    static const char *const dirNames[]   = { "write", "read" };
+    static const char *const modeNames[]  = { "cpu", "direct" };
+    static const char *const speedNames[] = { "fs", "hs", "ss" };
+    static const uint16_t pcktSizes[]     = { 64, 512, 1024 };
+    uint32_t dirs[DES_MAX_LIST]    = { 0, 1 };
+    uint32_t modes[DES_MAX_LIST]   = { 0, 1 };
+    uint32_t speeds[DES_MAX_LIST]  = { 0, 1, 2 };
+    uint32_t bursts[DES_MAX_LIST]  = { 1, 4, 8, 16 };
+    uint32_t sizes[DES_MAX_LIST]   = { 1024, 4096, 10240, 20480 };
+    uint32_t counts[DES_MAX_LIST]  = { 1, 2, 4, 8 };
+    uint32_t clocks[DES_MAX_LIST]  = { 10000, 20000, 33000 };
+    int nDirs = 2, nModes = 2, nSpeeds = 3, nBursts = 4, nSizes = 4, nCounts = 4, nClocks = 3;
+    uint32_t xferSize  = 20480;
+    uint32_t nRequests = 16;
+    DesConfig_t config;
+    DesResult_t result;
+    int d, m, u, l, b, n, c;
+    int opt;
+
+    while ((opt = getopt (argc, argv, "d:m:u:l:b:n:c:t:r:")) != -1) {
+        switch (opt) {
+            case 'd': nDirs   = DesParseNames (optarg, dirNames, 2, dirs); break;
+            case 'm': nModes  = DesParseNames (optarg, modeNames, 2, modes); break;
+            case 'u': nSpeeds = DesParseNames (optarg, speedNames, 3, speeds); break;
+            case 'l': nBursts = DesParseList (optarg, bursts); break;
+            case 'b': nSizes  = DesParseList (optarg, sizes); break;
+            case 'n': nCounts = DesParseList (optarg, counts); break;
+            case 'c': nClocks = DesParseList (optarg, clocks); break;
+            case 't': xferSize  = strtoul (optarg, NULL, 0); break;
+            case 'r': nRequests = strtoul (optarg, NULL, 0); break;
+            default:  DesUsage ();
+        }
+    }
+    if ((nDirs <= 0) || (nModes <= 0) || (nSpeeds <= 0) || (nBursts <= 0) || (nSizes <= 0) ||
+            (nCounts <= 0) || (nClocks <= 0) || (xferSize == 0) || (nRequests == 0)) {
+        DesUsage ();
+    }
+    for (n = 0; n < nCounts; n++) {
+        if ((counts[n] == 0) || (counts[n] > DES_MAX_BUFFERS)) {
+            DesUsage ();
+        }
+    }
+    for (l = 0; l < nBursts; l++) {
+        if ((bursts[l] == 0) || (bursts[l] > 16)) {
+            DesUsage ();
+        }
+    }
+    for (b = 0; b < nSizes; b++) {
+        if (sizes[b] == 0) {
+            DesUsage ();
+        }
+    }
+    for (c = 0; c < nClocks; c++) {
+        if (clocks[c] == 0) {
+            DesUsage ();
+        }
+    }
+
+    printf ("direction,mode,speed,packet,burst,buf_size,buf_count,spi_khz,request_bytes,requests,"
+            "time_us,throughput_mb_s,latency_avg_us,latency_max_us,usb_busy,spi_busy,cpu_busy\n");
+
+    memset (&config, 0, sizeof (config));
+    config.xferSize  = xferSize;
+    config.nRequests = nRequests;
+    for (d = 0; d < nDirs; d++)
+    for (m = 0; m < nModes; m++)
+    for (u = 0; u < nSpeeds; u++)
+    for (l = 0; l < nBursts; l++) {
+        /* The burst length only applies to SuperSpeed. */
+        if ((speeds[u] != 2) && (l > 0)) {
+            continue;
+        }
+        for (b = 0; b < nSizes; b++)
+        for (n = 0; n < nCounts; n++)
+        for (c = 0; c < nClocks; c++) {
+            config.isRead   = dirs[d];
+            config.isDirect = modes[m];
+            config.pcktSize = pcktSizes[speeds[u]];
+            config.burstLen = (speeds[u] == 2) ? bursts[l] : 1;
+            config.bufSize  = sizes[b];
+            config.bufCount = counts[n];
+            config.spiClock = clocks[c] * 1000;
+            DesRun (&config, &result);
+
+            printf ("%s,%s,%s,%u,%u,%u,%u,%u,%u,%u,%.1f,%.3f,%.1f,%.1f,%.3f,%.3f,%.3f\n",
+                    dirNames[config.isRead], modeNames[config.isDirect], speedNames[speeds[u]],
+                    config.pcktSize, config.burstLen, config.bufSize, config.bufCount,
+                    clocks[c], xferSize, nRequests,
+                    result.time / 1000.0,
+                    (double)xferSize * nRequests * 1000.0 / result.time,
+                    result.latencyTotal / 1000.0 / nRequests,
+                    result.latencyMax / 1000.0,
+                    (double)result.busy[config.isRead ? DES_STAGE_CONS : DES_STAGE_PROD] / result.time,
+                    (double)result.busy[config.isRead ? DES_STAGE_PROD : DES_STAGE_CONS] / result.time,
+                    (double)result.busy[DES_STAGE_CPU] / result.time);
+        }
+    }
+
+    return 0;
+}
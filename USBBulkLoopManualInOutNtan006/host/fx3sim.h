@@ -0,0 +1,83 @@
+/*
+ * Host side of the FX3 simulation
+ *
+ * The firmware sources are built on the host against the stand-in SDK
+ * headers in include/, and run on a simulated FX3 with an SPI FRAM. The
+ * functions below take the role of the USB host: they enumerate the
+ * device and issue control and bulk transfers. The return values follow
+ * libusb, so a host tool can drive the simulated device and a real one
+ * through the same code.
+ */
+
+#ifndef _INCLUDED_FX3SIM_H_
+#define _INCLUDED_FX3SIM_H_
+
+#include "cyu3types.h"
+#include "cyu3usb.h"
+
+/* Return values, same as the libusb error codes */
+#define FX3SIM_SUCCESS                  (0)
+#define FX3SIM_ERROR_IO                 (-1)
+#define FX3SIM_ERROR_INVALID_PARAM      (-2)
+#define FX3SIM_ERROR_NO_DEVICE          (-4)
+#define FX3SIM_ERROR_TIMEOUT            (-7)
+#define FX3SIM_ERROR_OVERFLOW           (-8)
+#define FX3SIM_ERROR_PIPE               (-9)
+
+/* Identification of the simulated FRAM */
+#define FX3SIM_FRAM_CYPRESS             (0)     /* 7F x 6, C2, density */
+#define FX3SIM_FRAM_FUJITSU             (1)     /* 04, 7F, density */
+#define FX3SIM_FRAM_UNKNOWN             (2)     /* RDID returns all zeros */
+
+typedef struct FX3SimConfig_t
+{
+    uint32_t    framSize;               /* FRAM capacity in bytes, a power of 2 */
+    uint8_t     framVendor;             /* One of FX3SIM_FRAM_xxx */
+    uint32_t    framMaxClock;           /* Fastest SPI clock for READ, 0 for no limit */
+    uint32_t    framMaxFastClock;       /* Fastest SPI clock for FAST_READ, 0 for no limit */
+    CyBool_t    spiTiming;              /* Take the SPI wire time for the transfers */
+    CyBool_t    usbTiming;              /* Take the USB bus time for the transfers */
+    CyBool_t    verbose;                /* Print the debug messages of the firmware */
+} FX3SimConfig_t;
+
+/* Fill the configuration with the defaults: 256KB Cypress FRAM working
+ * up to the maximum clock, SPI timing on, USB timing off. */
+extern void FX3SimDefaultConfig (FX3SimConfig_t *config);
+
+/* Boot the firmware and wait until it connects to the bus. */
+extern int FX3SimStart (const FX3SimConfig_t *config);
+
+/* Reset the bus at the given speed and select the configuration. */
+extern int FX3SimEnumerate (CyU3PUSBSpeed_t speed);
+
+/* Issue a control transfer. Returns the number of bytes transferred in
+ * the data stage, or an error. */
+extern int FX3SimControl (uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue,
+        uint16_t wIndex, uint8_t *data, uint16_t wLength, uint32_t timeout);
+
+/* Issue a bulk OUT transfer. A length of 0 sends a ZLP. */
+extern int FX3SimBulkOut (uint8_t ep, const uint8_t *data, uint32_t length,
+        uint32_t *transferred, uint32_t timeout);
+
+/* Issue a bulk IN transfer. The transfer ends when length bytes are
+ * received or with a short packet or a ZLP. */
+extern int FX3SimBulkIn (uint8_t ep, uint8_t *data, uint32_t length,
+        uint32_t *transferred, uint32_t timeout);
+
+/* Packet size and burst length of an endpoint as configured by the
+ * firmware, and the burst length advertised by the descriptors. */
+extern int FX3SimEndpointInfo (uint8_t ep, uint16_t *pcktSize, uint8_t *burstLen,
+        uint8_t *maxBurst);
+
+/* Access the FRAM content directly. */
+extern void FX3SimFramRead (uint32_t address, uint8_t *data, uint32_t length);
+extern void FX3SimFramWrite (uint32_t address, const uint8_t *data, uint32_t length);
+
+/* Number of protocol errors detected by the simulation, such as a SPI
+ * transfer started in the wrong state. */
+extern uint32_t FX3SimErrorCount (void);
+
+/* Time of the simulation in ms. */
+extern uint32_t FX3SimGetTime (void);
+
+#endif /* _INCLUDED_FX3SIM_H_ */
@@ -0,0 +1,142 @@
+/*
+ * Host stand-in for the FX3 SDK header cyu3dma.h
+ *
+ * The DMA channels are implemented by the host simulation (simdma.c).
+ */
+
+#ifndef _INCLUDED_CYU3DMA_H_
+#define _INCLUDED_CYU3DMA_H_
+
+#include "cyu3types.h"
+#include "cyu3os.h"
+#include "cyu3externcstart.h"
+
+/* Socket IDs: the IP number in the upper byte and the socket number
+ * in the lower byte. */
+typedef uint16_t CyU3PDmaSocketId_t;
+
+#define CY_U3P_LPP_SOCKET_I2S_LEFT      (0x0100)
+#define CY_U3P_LPP_SOCKET_I2S_RIGHT     (0x0101)
+#define CY_U3P_LPP_SOCKET_I2C_CONS      (0x0102)
+#define CY_U3P_LPP_SOCKET_UART_CONS     (0x0103)
+#define CY_U3P_LPP_SOCKET_SPI_CONS      (0x0104)
+#define CY_U3P_LPP_SOCKET_I2C_PROD      (0x0105)
+#define CY_U3P_LPP_SOCKET_UART_PROD     (0x0106)
+#define CY_U3P_LPP_SOCKET_SPI_PROD      (0x0107)
+
+#define CY_U3P_UIB_SOCKET_CONS_0        (0x0300)
+#define CY_U3P_UIB_SOCKET_CONS_1        (0x0301)
+#define CY_U3P_UIB_SOCKET_CONS_2        (0x0302)
+#define CY_U3P_UIB_SOCKET_CONS_3        (0x0303)
+#define CY_U3P_UIB_SOCKET_PROD_0        (0x0400)
+#define CY_U3P_UIB_SOCKET_PROD_1        (0x0401)
+#define CY_U3P_UIB_SOCKET_PROD_2        (0x0402)
+#define CY_U3P_UIB_SOCKET_PROD_3        (0x0403)
+
+#define CY_U3P_CPU_SOCKET_CONS          (0x3F00)
+#define CY_U3P_CPU_SOCKET_PROD          (0x3F01)
+
+typedef enum CyU3PDmaType_t
+{
+    CY_U3P_DMA_TYPE_AUTO = 0,
+    CY_U3P_DMA_TYPE_AUTO_SIGNAL,
+    CY_U3P_DMA_TYPE_MANUAL,
+    CY_U3P_DMA_TYPE_MANUAL_IN,
+    CY_U3P_DMA_TYPE_MANUAL_OUT
+} CyU3PDmaType_t;
+
+typedef enum CyU3PDmaMode_t
+{
+    CY_U3P_DMA_MODE_BYTE = 0,
+    CY_U3P_DMA_MODE_BUFFER
+} CyU3PDmaMode_t;
+
+typedef enum CyU3PDmaState_t
+{
+    CY_U3P_DMA_NOT_CONFIGURED = 0,
+    CY_U3P_DMA_CONFIGURED,
+    CY_U3P_DMA_ACTIVE,
+    CY_U3P_DMA_PROD_OVERRIDE,
+    CY_U3P_DMA_CONS_OVERRIDE,
+    CY_U3P_DMA_ERROR,
+    CY_U3P_DMA_IN_COMPLETION,
+    CY_U3P_DMA_ABORTED
+} CyU3PDmaState_t;
+
+typedef enum CyU3PDmaCbType_t
+{
+    CY_U3P_DMA_CB_XFER_CPLT  = (1 << 0),
+    CY_U3P_DMA_CB_SEND_CPLT  = (1 << 1),
+    CY_U3P_DMA_CB_RECV_CPLT  = (1 << 2),
+    CY_U3P_DMA_CB_PROD_EVENT = (1 << 3),
+    CY_U3P_DMA_CB_CONS_EVENT = (1 << 4),
+    CY_U3P_DMA_CB_ABORTED    = (1 << 5),
+    CY_U3P_DMA_CB_ERROR      = (1 << 6)
+} CyU3PDmaCbType_t;
+
+/* Buffer status bits */
+#define CY_U3P_DMA_BUFFER_EOP           (1 << 10)
+#define CY_U3P_DMA_BUFFER_ERROR         (1 << 11)
+#define CY_U3P_DMA_BUFFER_OCCUPIED      (1 << 12)
+
+typedef struct CyU3PDmaBuffer_t
+{
+    uint8_t         *buffer;
+    uint16_t        count;
+    uint16_t        size;
+    uint16_t        status;
+} CyU3PDmaBuffer_t;
+
+typedef union CyU3PDmaCBInput_t
+{
+    CyU3PDmaBuffer_t buffer_p;
+} CyU3PDmaCBInput_t;
+
+typedef struct CyU3PDmaChannel CyU3PDmaChannel;
+
+typedef void (*CyU3PDmaCallback_t) (CyU3PDmaChannel *handle, CyU3PDmaCbType_t type,
+        CyU3PDmaCBInput_t *input);
+
+typedef struct CyU3PDmaChannelConfig_t
+{
+    uint16_t            size;
+    uint16_t            count;
+    CyU3PDmaSocketId_t  prodSckId;
+    CyU3PDmaSocketId_t  consSckId;
+    uint16_t            prodAvailCount;
+    uint16_t            prodHeader;
+    uint16_t            prodFooter;
+    uint16_t            consHeader;
+    CyU3PDmaMode_t      dmaMode;
+    uint32_t            notification;
+    CyU3PDmaCallback_t  cb;
+} CyU3PDmaChannelConfig_t;
+
+struct CyU3PDmaChannel
+{
+    struct SimDmaChannel *sim_p;        /* State kept by the simulation */
+};
+
+extern CyU3PReturnStatus_t CyU3PDmaChannelCreate (CyU3PDmaChannel *handle,
+        CyU3PDmaType_t type, CyU3PDmaChannelConfig_t *config);
+extern CyU3PReturnStatus_t CyU3PDmaChannelDestroy (CyU3PDmaChannel *handle);
+extern CyU3PReturnStatus_t CyU3PDmaChannelSetXfer (CyU3PDmaChannel *handle, uint32_t count);
+extern CyU3PReturnStatus_t CyU3PDmaChannelGetBuffer (CyU3PDmaChannel *handle,
+        CyU3PDmaBuffer_t *buffer_p, uint32_t waitOption);
+extern CyU3PReturnStatus_t CyU3PDmaChannelCommitBuffer (CyU3PDmaChannel *handle,
+        uint16_t count, uint16_t bufStatus);
+extern CyU3PReturnStatus_t CyU3PDmaChannelDiscardBuffer (CyU3PDmaChannel *handle);
+extern CyU3PReturnStatus_t CyU3PDmaChannelSetupSendBuffer (CyU3PDmaChannel *handle,
+        CyU3PDmaBuffer_t *buffer_p);
+extern CyU3PReturnStatus_t CyU3PDmaChannelSetupRecvBuffer (CyU3PDmaChannel *handle,
+        CyU3PDmaBuffer_t *buffer_p);
+extern CyU3PReturnStatus_t CyU3PDmaChannelWaitForCompletion (CyU3PDmaChannel *handle,
+        uint32_t waitOption);
+extern CyU3PReturnStatus_t CyU3PDmaChannelSetWrapUp (CyU3PDmaChannel *handle);
+extern CyU3PReturnStatus_t CyU3PDmaChannelReset (CyU3PDmaChannel *handle);
+extern CyU3PReturnStatus_t CyU3PDmaChannelGetStatus (CyU3PDmaChannel *handle,
+        CyU3PDmaState_t *state, uint32_t *prodXferCount, uint32_t *consXferCount);
+
+#include "cyu3externcend.h"
+
+#endif /* _INCLUDED_CYU3DMA_H_ */
@@ -0,0 +1,53 @@
+/*
+ * Host stand-in for the FX3 SDK header cyu3error.h
+ *
+ * The RTOS error codes follow the ThreadX values, and the driver error
+ * codes start at 0x40.
+ */
+
+#ifndef _INCLUDED_CYU3ERROR_H_
+#define _INCLUDED_CYU3ERROR_H_
+
+#include "cyu3types.h"
+
+#define CY_U3P_SUCCESS                  (0x00)
+
+/* RTOS errors */
+#define CY_U3P_ERROR_DELETED            (0x01)
+#define CY_U3P_ERROR_BAD_POOL           (0x02)
+#define CY_U3P_ERROR_BAD_POINTER        (0x03)
+#define CY_U3P_ERROR_INVALID_WAIT       (0x04)
+#define CY_U3P_ERROR_BAD_SIZE           (0x05)
+#define CY_U3P_ERROR_BAD_EVENT_GROUP    (0x06)
+#define CY_U3P_ERROR_NO_EVENTS          (0x07)
+#define CY_U3P_ERROR_BAD_OPTION         (0x08)
+#define CY_U3P_ERROR_BAD_QUEUE          (0x09)
+#define CY_U3P_ERROR_QUEUE_EMPTY        (0x0A)
+#define CY_U3P_ERROR_QUEUE_FULL         (0x0B)
+#define CY_U3P_ERROR_BAD_THREAD         (0x0E)
+#define CY_U3P_ERROR_BAD_PRIORITY       (0x0F)
+#define CY_U3P_ERROR_NO_MEMORY          (0x10)
+#define CY_U3P_ERROR_BAD_MUTEX          (0x1C)
+#define CY_U3P_ERROR_MUTEX_FAILURE      (0x1D)
+#define CY_U3P_ERROR_NOT_OWNED          (0x1E)
+
+/* Driver errors */
+#define CY_U3P_ERROR_BAD_ARGUMENT       (0x40)
+#define CY_U3P_ERROR_NULL_POINTER       (0x41)
+#define CY_U3P_ERROR_NOT_STARTED        (0x42)
+#define CY_U3P_ERROR_ALREADY_STARTED    (0x43)
+#define CY_U3P_ERROR_NOT_CONFIGURED     (0x44)
+#define CY_U3P_ERROR_TIMEOUT            (0x45)
+#define CY_U3P_ERROR_NOT_SUPPORTED      (0x46)
+#define CY_U3P_ERROR_INVALID_SEQUENCE   (0x47)
+#define CY_U3P_ERROR_ABORTED            (0x48)
+#define CY_U3P_ERROR_DMA_FAILURE        (0x49)
+#define CY_U3P_ERROR_FAILURE            (0x4A)
+#define CY_U3P_ERROR_BAD_INDEX          (0x4B)
+#define CY_U3P_ERROR_INVALID_CONFIGURATION (0x4D)
+#define CY_U3P_ERROR_CHANNEL_CREATE_FAILED (0x4E)
+#define CY_U3P_ERROR_CHANNEL_DESTROY_FAILED (0x4F)
+#define CY_U3P_ERROR_MEMORY_ERROR       (0x5E)
+#define CY_U3P_ERROR_XFER_CANCELLED     (0x5F)
+
+#endif /* _INCLUDED_CYU3ERROR_H_ */
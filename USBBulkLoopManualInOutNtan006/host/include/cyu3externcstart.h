@@ -0,0 +1,7 @@
+/*
+ * Host stand-in for the FX3 SDK header cyu3externcstart.h
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
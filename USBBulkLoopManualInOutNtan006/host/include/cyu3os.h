@@ -0,0 +1,144 @@
+/*
+ * Host stand-in for the FX3 SDK header cyu3os.h
+ *
+ * The RTOS objects are implemented by the host simulation (simos.c) on
+ * top of POSIX threads. Each object keeps its state in the structure
+ * declared here, so the application can define the objects statically
+ * as it does on the device.
+ */
+
+#ifndef _INCLUDED_CYU3OS_H_
+#define _INCLUDED_CYU3OS_H_
+
+#include "cyu3types.h"
+#include "cyu3externcstart.h"
+
+#define CYU3P_NO_WAIT                   (0)
+#define CYU3P_WAIT_FOREVER              (0xFFFFFFFF)
+
+#define CYU3P_EVENT_OR                  (0)
+#define CYU3P_EVENT_OR_CLEAR            (1)
+#define CYU3P_EVENT_AND                 (2)
+#define CYU3P_EVENT_AND_CLEAR           (3)
+
+#define CYU3P_NO_TIME_SLICE             (0)
+#define CYU3P_DONT_START                (0)
+#define CYU3P_AUTO_START                (1)
+
+#define CYU3P_NO_INHERIT                (0)
+#define CYU3P_INHERIT                   (1)
+
+typedef void (*CyU3PThreadEntry_t) (uint32_t input);
+
+typedef struct CyU3PThread
+{
+    struct SimThread *sim_p;            /* State kept by the simulation */
+    char            *name;
+    uint8_t         *stackStart;
+    uint32_t        stackSize;
+    uint32_t        priority;
+} CyU3PThread;
+
+typedef struct CyU3PEvent
+{
+    uint32_t        flags;
+    CyBool_t        isValid;
+} CyU3PEvent;
+
+typedef struct CyU3PMutex
+{
+    const void      *owner;             /* Context holding the mutex */
+    uint32_t        count;
+    CyBool_t        isValid;
+} CyU3PMutex;
+
+typedef struct CyU3PQueue
+{
+    uint32_t        *start;
+    uint32_t        msgWords;           /* Message size in 32 bit words */
+    uint32_t        capacity;           /* Number of messages */
+    uint32_t        head;
+    uint32_t        level;
+    CyBool_t        isValid;
+} CyU3PQueue;
+
+typedef struct CyU3PBytePool
+{
+    uint8_t         *start;
+    uint32_t        size;
+    uint32_t        available;
+    CyBool_t        isValid;
+} CyU3PBytePool;
+
+/* DMA buffer manager used by cyfxtx.c */
+typedef struct CyU3PDmaBufMgr_t
+{
+    CyU3PMutex      lock;
+    uint32_t        startAddr;
+    uint32_t        regionSize;
+    uint32_t        *usedStatus;
+    uint32_t        statusSize;
+    uint32_t        searchPos;
+} CyU3PDmaBufMgr_t;
+
+/* Kernel */
+extern void CyU3PKernelEntry (void);
+extern void CyU3PApplicationDefine (void);
+extern void tx_application_define (void *unusedMem);
+
+/* Threads */
+extern uint32_t CyU3PThreadCreate (CyU3PThread *thread_p, char *threadName,
+        CyU3PThreadEntry_t entryFn, uint32_t entryInput, void *stackStart,
+        uint32_t stackSize, uint32_t priority, uint32_t preemptThreshold,
+        uint32_t timeSlice, uint32_t autoStart);
+extern CyU3PThread *CyU3PThreadIdentify (void);
+extern uint32_t CyU3PThreadSleep (uint32_t timerTicks);
+extern uint32_t CyU3PThreadRelinquish (void);
+
+/* Events */
+extern uint32_t CyU3PEventCreate (CyU3PEvent *event_p);
+extern uint32_t CyU3PEventDestroy (CyU3PEvent *event_p);
+extern uint32_t CyU3PEventSet (CyU3PEvent *event_p, uint32_t rqtFlag, uint32_t setOption);
+extern uint32_t CyU3PEventGet (CyU3PEvent *event_p, uint32_t rqtFlag, uint32_t getOption,
+        uint32_t *flag_p, uint32_t waitOption);
+
+/* Mutexes */
+extern uint32_t CyU3PMutexCreate (CyU3PMutex *mutex_p, uint32_t priorityInherit);
+extern uint32_t CyU3PMutexDestroy (CyU3PMutex *mutex_p);
+extern uint32_t CyU3PMutexGet (CyU3PMutex *mutex_p, uint32_t waitOption);
+extern uint32_t CyU3PMutexPut (CyU3PMutex *mutex_p);
+
+/* Queues */
+extern uint32_t CyU3PQueueCreate (CyU3PQueue *queue_p, uint32_t messageSize,
+        void *queueStart, uint32_t queueSize);
+extern uint32_t CyU3PQueueDestroy (CyU3PQueue *queue_p);
+extern uint32_t CyU3PQueueSend (CyU3PQueue *queue_p, void *src_p, uint32_t waitOption);
+extern uint32_t CyU3PQueueReceive (CyU3PQueue *queue_p, void *dest_p, uint32_t waitOption);
+extern uint32_t CyU3PQueueFlush (CyU3PQueue *queue_p);
+
+/* Byte pools */
+extern uint32_t CyU3PBytePoolCreate (CyU3PBytePool *pool_p, void *poolStart, uint32_t poolSize);
+extern uint32_t CyU3PBytePoolDestroy (CyU3PBytePool *pool_p);
+extern uint32_t CyU3PByteAlloc (CyU3PBytePool *pool_p, void **mem_p, uint32_t memSize,
+        uint32_t waitOption);
+extern uint32_t CyU3PByteFree (void *mem_p);
+
+/* Time in RTOS ticks (1 ms) */
+extern uint32_t CyU3PGetTime (void);
+
+/* Memory functions implemented in cyfxtx.c */
+extern void CyU3PMemInit (void);
+extern void *CyU3PMemAlloc (uint32_t size);
+extern void CyU3PMemFree (void *mem_p);
+extern void CyU3PMemSet (uint8_t *ptr, uint8_t data, uint32_t count);
+extern void CyU3PMemCopy (uint8_t *dest, uint8_t *src, uint32_t count);
+extern int32_t CyU3PMemCmp (const void *s1, const void *s2, uint32_t n);
+extern void CyU3PDmaBufferInit (void);
+extern void CyU3PDmaBufferDeInit (void);
+extern void *CyU3PDmaBufferAlloc (uint16_t size);
+extern int CyU3PDmaBufferFree (void *buffer);
+extern void CyU3PFreeHeaps (void);
+
+#include "cyu3externcend.h"
+
+#endif /* _INCLUDED_CYU3OS_H_ */
@@ -0,0 +1,62 @@
+/*
+ * Host stand-in for the FX3 SDK header cyu3spi.h
+ *
+ * The SPI block is implemented by the host simulation (simspi.c) with an
+ * in-memory FRAM on the slave select line.
+ */
+
+#ifndef _INCLUDED_CYU3SPI_H_
+#define _INCLUDED_CYU3SPI_H_
+
+#include "cyu3types.h"
+#include "cyu3externcstart.h"
+
+/* Range of the SPI clock accepted by CyU3PSpiSetConfig */
+#define CY_U3P_SPI_MIN_CLOCK            (10000)
+#define CY_U3P_SPI_MAX_CLOCK            (33000000)
+
+typedef enum CyU3PSpiSsnCtrl_t
+{
+    CY_U3P_SPI_SSN_CTRL_FW = 0,
+    CY_U3P_SPI_SSN_CTRL_HW_END_OF_XFER,
+    CY_U3P_SPI_SSN_CTRL_HW_EACH_WORD,
+    CY_U3P_SPI_SSN_CTRL_HW_CPHA_BASED,
+    CY_U3P_SPI_SSN_CTRL_NONE
+} CyU3PSpiSsnCtrl_t;
+
+typedef enum CyU3PSpiSsnLagLead_t
+{
+    CY_U3P_SPI_SSN_LAG_LEAD_ZERO_CLK = 0,
+    CY_U3P_SPI_SSN_LAG_LEAD_HALF_CLK,
+    CY_U3P_SPI_SSN_LAG_LEAD_ONE_CLK,
+    CY_U3P_SPI_SSN_LAG_LEAD_ONE_HALF_CLK
+} CyU3PSpiSsnLagLead_t;
+
+typedef struct CyU3PSpiConfig_t
+{
+    CyBool_t                isLsbFirst;
+    CyBool_t                cpol;
+    CyBool_t                cpha;
+    CyBool_t                ssnPol;
+    CyU3PSpiSsnCtrl_t       ssnCtrl;
+    CyU3PSpiSsnLagLead_t    leadTime;
+    CyU3PSpiSsnLagLead_t    lagTime;
+    uint32_t                clock;
+    uint8_t                 wordLen;
+} CyU3PSpiConfig_t;
+
+typedef void (*CyU3PSpiIntrCb_t) (uint32_t evt, uint32_t error);
+
+extern CyU3PReturnStatus_t CyU3PSpiInit (void);
+extern CyU3PReturnStatus_t CyU3PSpiDeInit (void);
+extern CyU3PReturnStatus_t CyU3PSpiSetConfig (CyU3PSpiConfig_t *config, CyU3PSpiIntrCb_t cb);
+extern CyU3PReturnStatus_t CyU3PSpiSetSsnLine (CyBool_t isHigh);
+extern CyU3PReturnStatus_t CyU3PSpiTransmitWords (uint8_t *data, uint32_t byteCount);
+extern CyU3PReturnStatus_t CyU3PSpiReceiveWords (uint8_t *data, uint32_t byteCount);
+extern CyU3PReturnStatus_t CyU3PSpiSetBlockXfer (uint32_t txSize, uint32_t rxSize);
+extern CyU3PReturnStatus_t CyU3PSpiWaitForBlockXfer (CyBool_t isRead);
+extern CyU3PReturnStatus_t CyU3PSpiDisableBlockXfer (CyBool_t rxDisable, CyBool_t txDisable);
+
+#include "cyu3externcend.h"
+
+#endif /* _INCLUDED_CYU3SPI_H_ */
@@ -0,0 +1,55 @@
+/*
+ * Host stand-in for the FX3 SDK header cyu3system.h
+ */
+
+#ifndef _INCLUDED_CYU3SYSTEM_H_
+#define _INCLUDED_CYU3SYSTEM_H_
+
+#include "cyu3types.h"
+#include "cyu3dma.h"
+#include "cyu3externcstart.h"
+
+typedef enum CyU3PSportMode_t
+{
+    CY_U3P_SPORT_INACTIVE = 0,
+    CY_U3P_SPORT_8BIT,
+    CY_U3P_SPORT_16BIT,
+    CY_U3P_SPORT_32BIT
+} CyU3PSportMode_t;
+
+typedef enum CyU3PIoMatrixLppMode_t
+{
+    CY_U3P_IO_MATRIX_LPP_DEFAULT = 0,
+    CY_U3P_IO_MATRIX_LPP_UART_ONLY,
+    CY_U3P_IO_MATRIX_LPP_SPI_ONLY,
+    CY_U3P_IO_MATRIX_LPP_I2S_ONLY
+} CyU3PIoMatrixLppMode_t;
+
+typedef struct CyU3PIoMatrixConfig_t
+{
+    CyBool_t                isDQ32Bit;
+    CyU3PSportMode_t        s0Mode;
+    CyU3PSportMode_t        s1Mode;
+    CyBool_t                useUart;
+    CyBool_t                useI2C;
+    CyBool_t                useI2S;
+    CyBool_t                useSpi;
+    CyU3PIoMatrixLppMode_t  lppMode;
+    uint32_t                gpioSimpleEn[2];
+    uint32_t                gpioComplexEn[2];
+} CyU3PIoMatrixConfig_t;
+
+extern CyU3PReturnStatus_t CyU3PDeviceInit (void *clkCfg);
+extern CyU3PReturnStatus_t CyU3PDeviceCacheControl (CyBool_t isICacheEnable,
+        CyBool_t isDCacheEnable, CyBool_t isDmaHandleDCache);
+extern CyU3PReturnStatus_t CyU3PDeviceConfigureIOMatrix (CyU3PIoMatrixConfig_t *cfg_p);
+extern CyU3PReturnStatus_t CyU3PDebugInit (CyU3PDmaSocketId_t destSckId, uint8_t traceLevel);
+extern CyU3PReturnStatus_t CyU3PDebugPrint (uint8_t priority, char *message, ...);
+
+/* Disable all interrupts and return the previous mask, and restore it. */
+extern uint32_t CyU3PVicDisableAllInterrupts (void);
+extern void CyU3PVicEnableInterrupts (uint32_t mask);
+
+#include "cyu3externcend.h"
+
+#endif /* _INCLUDED_CYU3SYSTEM_H_ */
@@ -0,0 +1,22 @@
+/*
+ * Host stand-in for the FX3 SDK header cyu3types.h
+ *
+ * The host simulation in this directory builds the application sources
+ * with gcc on Linux. Only the definitions used by the application are
+ * provided.
+ */
+
+#ifndef _INCLUDED_CYU3TYPES_H_
+#define _INCLUDED_CYU3TYPES_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int CyBool_t;
+
+#define CyTrue                          (1)
+#define CyFalse                         (0)
+
+typedef uint32_t CyU3PReturnStatus_t;
+
+#endif /* _INCLUDED_CYU3TYPES_H_ */
@@ -0,0 +1,52 @@
+/*
+ * Host stand-in for the FX3 SDK header cyu3uart.h
+ *
+ * The UART only carries the debug prints, which the simulation writes
+ * to the standard error.
+ */
+
+#ifndef _INCLUDED_CYU3UART_H_
+#define _INCLUDED_CYU3UART_H_
+
+#include "cyu3types.h"
+#include "cyu3externcstart.h"
+
+typedef enum CyU3PUartBaudrate_t
+{
+    CY_U3P_UART_BAUDRATE_9600   = 9600,
+    CY_U3P_UART_BAUDRATE_115200 = 115200
+} CyU3PUartBaudrate_t;
+
+typedef enum CyU3PUartStopBit_t
+{
+    CY_U3P_UART_ONE_STOP_BIT = 1,
+    CY_U3P_UART_TWO_STOP_BIT = 2
+} CyU3PUartStopBit_t;
+
+typedef enum CyU3PUartParity_t
+{
+    CY_U3P_UART_NO_PARITY = 0,
+    CY_U3P_UART_EVEN_PARITY,
+    CY_U3P_UART_ODD_PARITY
+} CyU3PUartParity_t;
+
+typedef struct CyU3PUartConfig_t
+{
+    CyBool_t            txEnable;
+    CyBool_t            rxEnable;
+    CyBool_t            flowCtrl;
+    CyBool_t            isDma;
+    CyU3PUartBaudrate_t baudRate;
+    CyU3PUartStopBit_t  stopBit;
+    CyU3PUartParity_t   parity;
+} CyU3PUartConfig_t;
+
+typedef void (*CyU3PUartIntrCb_t) (uint32_t evt, uint32_t error);
+
+extern CyU3PReturnStatus_t CyU3PUartInit (void);
+extern CyU3PReturnStatus_t CyU3PUartSetConfig (CyU3PUartConfig_t *config, CyU3PUartIntrCb_t cb);
+extern CyU3PReturnStatus_t CyU3PUartTxSetBlockXfer (uint32_t txSize);
+
+#include "cyu3externcend.h"
+
+#endif /* _INCLUDED_CYU3UART_H_ */
@@ -0,0 +1,108 @@
+/*
+ * Host stand-in for the FX3 SDK header cyu3usb.h
+ *
+ * The USB device is implemented by the host simulation (simusb.c), and
+ * the host side of the bus is driven through fx3sim.h.
+ */
+
+#ifndef _INCLUDED_CYU3USB_H_
+#define _INCLUDED_CYU3USB_H_
+
+#include "cyu3types.h"
+#include "cyu3usbconst.h"
+#include "cyu3externcstart.h"
+
+/* Fields of the setup packet passed to the setup callback */
+#define CY_U3P_USB_REQUEST_TYPE_MASK    (0x000000FF)
+#define CY_U3P_USB_REQUEST_MASK         (0x0000FF00)
+#define CY_U3P_USB_REQUEST_POS          (8)
+#define CY_U3P_USB_VALUE_MASK           (0xFFFF0000)
+#define CY_U3P_USB_VALUE_POS            (16)
+#define CY_U3P_USB_INDEX_MASK           (0x0000FFFF)
+#define CY_U3P_USB_INDEX_POS            (0)
+#define CY_U3P_USB_LENGTH_MASK          (0xFFFF0000)
+#define CY_U3P_USB_LENGTH_POS           (16)
+
+/* Fields of bmRequestType */
+#define CY_U3P_USB_TYPE_MASK            (0x60)
+#define CY_U3P_USB_STANDARD_RQT         (0x00)
+#define CY_U3P_USB_CLASS_RQT            (0x20)
+#define CY_U3P_USB_VENDOR_RQT           (0x40)
+#define CY_U3P_USB_TARGET_MASK          (0x03)
+#define CY_U3P_USB_TARGET_DEVICE        (0x00)
+#define CY_U3P_USB_TARGET_INTF          (0x01)
+#define CY_U3P_USB_TARGET_ENDPT         (0x02)
+#define CY_U3P_USB_TARGET_OTHER         (0x03)
+
+typedef enum CyU3PUSBSpeed_t
+{
+    CY_U3P_NOT_CONNECTED = 0,
+    CY_U3P_FULL_SPEED,
+    CY_U3P_HIGH_SPEED,
+    CY_U3P_SUPER_SPEED
+} CyU3PUSBSpeed_t;
+
+typedef enum CyU3PUsbEventType_t
+{
+    CY_U3P_USB_EVENT_CONNECT = 0,
+    CY_U3P_USB_EVENT_DISCONNECT,
+    CY_U3P_USB_EVENT_SUSPEND,
+    CY_U3P_USB_EVENT_RESUME,
+    CY_U3P_USB_EVENT_RESET,
+    CY_U3P_USB_EVENT_SETCONF,
+    CY_U3P_USB_EVENT_SPEED
+} CyU3PUsbEventType_t;
+
+typedef enum CyU3PUsbLinkPowerMode
+{
+    CyU3PUsbLPM_U0 = 0,
+    CyU3PUsbLPM_U1,
+    CyU3PUsbLPM_U2,
+    CyU3PUsbLPM_U3
+} CyU3PUsbLinkPowerMode;
+
+typedef enum CyU3PUSBSetDescType_t
+{
+    CY_U3P_USB_SET_SS_DEVICE_DESCR = 0,
+    CY_U3P_USB_SET_HS_DEVICE_DESCR,
+    CY_U3P_USB_SET_DEVQUAL_DESCR,
+    CY_U3P_USB_SET_FS_CONFIG_DESCR,
+    CY_U3P_USB_SET_HS_CONFIG_DESCR,
+    CY_U3P_USB_SET_STRING_DESCR,
+    CY_U3P_USB_SET_SS_CONFIG_DESCR,
+    CY_U3P_USB_SET_SS_BOS_DESCR
+} CyU3PUSBSetDescType_t;
+
+typedef struct CyU3PEpConfig_t
+{
+    CyBool_t            enable;
+    CyU3PUsbEpType_t    epType;
+    uint16_t            streams;
+    uint16_t            pcktSize;
+    uint8_t             burstLen;
+    uint8_t             isoPkts;
+} CyU3PEpConfig_t;
+
+typedef CyBool_t (*CyU3PUSBSetupCb_t) (uint32_t setupdat0, uint32_t setupdat1);
+typedef void (*CyU3PUSBEventCb_t) (CyU3PUsbEventType_t evType, uint16_t evData);
+typedef CyBool_t (*CyU3PUsbLPMReqCb_t) (CyU3PUsbLinkPowerMode link_mode);
+
+extern CyU3PReturnStatus_t CyU3PUsbStart (void);
+extern void CyU3PUsbRegisterSetupCallback (CyU3PUSBSetupCb_t callback, CyBool_t fastEnum);
+extern void CyU3PUsbRegisterEventCallback (CyU3PUSBEventCb_t callback);
+extern void CyU3PUsbRegisterLPMRequestCallback (CyU3PUsbLPMReqCb_t callback);
+extern CyU3PReturnStatus_t CyU3PUsbSetDesc (CyU3PUSBSetDescType_t desc_type, uint8_t desc_index,
+        uint8_t *desc);
+extern CyU3PReturnStatus_t CyU3PConnectState (CyBool_t connect, CyBool_t ssEnable);
+extern CyU3PUSBSpeed_t CyU3PUsbGetSpeed (void);
+extern CyU3PReturnStatus_t CyU3PSetEpConfig (uint8_t ep, CyU3PEpConfig_t *epinfo);
+extern CyU3PReturnStatus_t CyU3PUsbFlushEp (uint8_t ep);
+extern CyU3PReturnStatus_t CyU3PUsbResetEp (uint8_t ep);
+extern CyU3PReturnStatus_t CyU3PUsbAckSetup (void);
+extern CyU3PReturnStatus_t CyU3PUsbStall (uint8_t ep, CyBool_t stall, CyBool_t toggle);
+extern CyU3PReturnStatus_t CyU3PUsbSendEP0Data (uint16_t count, uint8_t *buffer);
+extern CyU3PReturnStatus_t CyU3PUsbGetEP0Data (uint16_t count, uint8_t *buffer, uint16_t *readCount);
+
+#include "cyu3externcend.h"
+
+#endif /* _INCLUDED_CYU3USB_H_ */
@@ -0,0 +1,54 @@
+/*
+ * Host stand-in for the FX3 SDK header cyu3usbconst.h
+ */
+
+#ifndef _INCLUDED_CYU3USBCONST_H_
+#define _INCLUDED_CYU3USBCONST_H_
+
+#include "cyu3types.h"
+#include "cyu3externcstart.h"
+
+/* Descriptor types */
+#define CY_U3P_USB_DEVICE_DESCR         (0x01)
+#define CY_U3P_USB_CONFIG_DESCR         (0x02)
+#define CY_U3P_USB_STRING_DESCR         (0x03)
+#define CY_U3P_USB_INTRFC_DESCR         (0x04)
+#define CY_U3P_USB_ENDPNT_DESCR         (0x05)
+#define CY_U3P_USB_DEVQUAL_DESCR        (0x06)
+#define CY_U3P_USB_OTHERSPEED_DESCR     (0x07)
+#define CY_U3P_BOS_DESCR                (0x0F)
+#define CY_U3P_DEVICE_CAPB_DESCR        (0x10)
+#define CY_U3P_SS_EP_COMPN_DESCR        (0x30)
+
+/* Device capability types in the BOS descriptor */
+#define CY_U3P_USB2_EXTN_CAPB_TYPE      (0x02)
+#define CY_U3P_SS_USB_CAPB_TYPE         (0x03)
+#define CY_U3P_CONTAINER_ID_CAPBD_TYPE  (0x04)
+
+/* Endpoint types */
+typedef enum CyU3PUsbEpType_t
+{
+    CY_U3P_USB_EP_CONTROL = 0,
+    CY_U3P_USB_EP_ISO,
+    CY_U3P_USB_EP_BULK,
+    CY_U3P_USB_EP_INTR
+} CyU3PUsbEpType_t;
+
+/* Standard request codes */
+#define CY_U3P_USB_SC_GET_STATUS        (0x00)
+#define CY_U3P_USB_SC_CLEAR_FEATURE     (0x01)
+#define CY_U3P_USB_SC_SET_FEATURE       (0x03)
+#define CY_U3P_USB_SC_SET_ADDRESS       (0x05)
+#define CY_U3P_USB_SC_GET_DESCRIPTOR    (0x06)
+#define CY_U3P_USB_SC_SET_DESCRIPTOR    (0x07)
+#define CY_U3P_USB_SC_GET_CONFIGURATION (0x08)
+#define CY_U3P_USB_SC_SET_CONFIGURATION (0x09)
+#define CY_U3P_USB_SC_GET_INTERFACE     (0x0A)
+#define CY_U3P_USB_SC_SET_INTERFACE     (0x0B)
+
+/* Feature selectors */
+#define CY_U3P_USBX_FS_EP_HALT          (0x00)
+
+#include "cyu3externcend.h"
+
+#endif /* _INCLUDED_CYU3USBCONST_H_ */
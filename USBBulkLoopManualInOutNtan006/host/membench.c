@@ -0,0 +1,28 @@
+/*
+ * Host run of the memory microbenchmark
+ *
+ * The application is built with CY_FX_MEM_BENCHMARK set, so the
+ * benchmark runs in the application thread before the USB is connected.
+ * The debug prints of the firmware are enabled to show the results.
+ * The cycles per byte are counted at a nominal clock, so only the ratio
+ * to the byte loops is meaningful on the host.
+ */
+
+#include <stdio.h>
+
+#include "fx3sim.h"
+
+int
+main (
+    void
+) {
+    FX3SimConfig_t config;
+
+    FX3SimDefaultConfig (&config);
+    config.verbose = CyTrue;
+    if (FX3SimStart (&config) != FX3SIM_SUCCESS) {
+        fprintf (stderr, "membench: the firmware did not start\n");
+        return 1;
+    }
+    return (FX3SimErrorCount () == 0) ? 0 : 1;
+}
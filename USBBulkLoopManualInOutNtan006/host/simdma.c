@@ -0,0 +1,773 @@
+/*
+ * FX3 host simulation: DMA channels
+ *
+ * A channel is a ring of buffers allocated from the DMA buffer heap of
+ * cyfxtx.c. Each buffer is EMPTY, PRODUCED (waiting for the CPU of a
+ * MANUAL or MANUAL_IN channel) or COMMITTED (waiting for the consumer
+ * socket). The peripheral models move the data through the socket
+ * functions declared in simint.h, and the CPU side is the SDK API.
+ *
+ * prodIdx is the next buffer filled by the producer, the socket or the
+ * CPU of a MANUAL_OUT channel. cpuIdx is the next buffer inspected by
+ * the CPU of a MANUAL channel. consIdx is the next buffer drained by
+ * the consumer, the socket or the CPU of a MANUAL_IN channel.
+ *
+ * The callbacks are called in order by the DMA driver context, as the
+ * DMA thread of the SDK does.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cyu3dma.h"
+#include "cyu3error.h"
+#include "simint.h"
+
+#define SIM_DMA_MAX_BUFFERS             (16)
+#define SIM_DMA_CB_QUEUE_SIZE           (64)
+
+#define SIM_BUF_EMPTY                   (0)
+#define SIM_BUF_PRODUCED                (1)
+#define SIM_BUF_COMMITTED               (2)
+
+struct SimDmaChannel
+{
+    CyU3PDmaChannel         *handle;
+    CyU3PDmaType_t          type;
+    CyU3PDmaChannelConfig_t config;
+    CyU3PDmaState_t         state;
+    CyBool_t                isDestroyed;
+    uint16_t                dataSize;               /* Size of the buffers without header and footer */
+
+    uint8_t                 *mem[SIM_DMA_MAX_BUFFERS];
+    uint16_t                fill[SIM_DMA_MAX_BUFFERS];
+    uint8_t                 bufState[SIM_DMA_MAX_BUFFERS];
+    uint16_t                prodIdx;
+    uint16_t                cpuIdx;
+    uint16_t                consIdx;
+    uint32_t                consOffset;             /* Bytes drained from the buffer at consIdx */
+
+    uint32_t                xferSize;               /* 0 for an infinite transfer */
+    uint32_t                prodCount;
+    uint32_t                consCount;
+
+    CyU3PDmaBuffer_t        ovrBuf;                 /* Buffer of the override mode */
+    uint32_t                ovrOffset;
+
+    SimDmaChannel           *next;
+};
+
+typedef struct SimDmaCb
+{
+    SimDmaChannel           *ch;
+    CyU3PDmaCbType_t        type;
+    CyU3PDmaCBInput_t       input;
+} SimDmaCb;
+
+static SimDmaChannel *simChannels = NULL;
+
+static SimDmaCb simCbQueue[SIM_DMA_CB_QUEUE_SIZE];
+static uint32_t simCbHead = 0;
+static uint32_t simCbLevel = 0;
+
+static CyU3PThread simDmaThread = {NULL, "sim:dma", NULL, 0, 0};
+
+static void
+SimDmaNotify (
+        SimDmaChannel *ch,
+        CyU3PDmaCbType_t type,
+        CyU3PDmaBuffer_t *buffer_p)
+{
+    SimDmaCb *cb_p;
+
+    if (((ch->config.notification & type) == 0) || (ch->config.cb == NULL))
+    {
+        return;
+    }
+    if (simCbLevel == SIM_DMA_CB_QUEUE_SIZE)
+    {
+        SimError ("DMA callback queue overflow");
+        return;
+    }
+
+    cb_p = &simCbQueue[(simCbHead + simCbLevel) % SIM_DMA_CB_QUEUE_SIZE];
+    cb_p->ch   = ch;
+    cb_p->type = type;
+    memset (&cb_p->input, 0, sizeof (cb_p->input));
+    if (buffer_p != NULL)
+    {
+        cb_p->input.buffer_p = *buffer_p;
+    }
+    simCbLevel++;
+    SimSignal ();
+}
+
+static void *
+SimDmaThreadEntry (
+        void *arg)
+{
+    SimDmaCb cb;
+
+    (void) arg;
+
+    pthread_mutex_lock (&simLock);
+    SimSetContext (&simDmaThread);
+    for (;;)
+    {
+        while (simCbLevel == 0)
+        {
+            SimWait (NULL, CYU3P_WAIT_FOREVER);
+        }
+
+        cb = simCbQueue[simCbHead];
+        simCbHead = (simCbHead + 1) % SIM_DMA_CB_QUEUE_SIZE;
+        simCbLevel--;
+
+        /* No callback is called for a channel destroyed meanwhile. */
+        if (!cb.ch->isDestroyed)
+        {
+            cb.ch->config.cb (cb.ch->handle, cb.type, &cb.input);
+        }
+    }
+    return NULL;
+}
+
+void
+SimDmaStart (
+        void)
+{
+    SimThreadStart (SimDmaThreadEntry, NULL);
+}
+
+static SimDmaChannel *
+SimDmaGet (
+        CyU3PDmaChannel *handle)
+{
+    if ((handle == NULL) || (handle->sim_p == NULL) || (handle->sim_p->isDestroyed))
+    {
+        return NULL;
+    }
+    return handle->sim_p;
+}
+
+static void
+SimDmaClear (
+        SimDmaChannel *ch)
+{
+    memset (ch->fill, 0, sizeof (ch->fill));
+    memset (ch->bufState, SIM_BUF_EMPTY, sizeof (ch->bufState));
+    ch->prodIdx    = 0;
+    ch->cpuIdx     = 0;
+    ch->consIdx    = 0;
+    ch->consOffset = 0;
+    ch->prodCount  = 0;
+    ch->consCount  = 0;
+}
+
+/* Complete the buffer at prodIdx. */
+static void
+SimDmaComplete (
+        SimDmaChannel *ch)
+{
+    CyU3PDmaBuffer_t buffer;
+    uint16_t index = ch->prodIdx;
+
+    ch->prodIdx = (index + 1) % ch->config.count;
+    if (ch->type == CY_U3P_DMA_TYPE_AUTO)
+    {
+        ch->bufState[index] = SIM_BUF_COMMITTED;
+    }
+    else
+    {
+        ch->bufState[index] = SIM_BUF_PRODUCED;
+        buffer.buffer = ch->mem[index] + ch->config.prodHeader;
+        buffer.count  = ch->fill[index];
+        buffer.size   = ch->dataSize;
+        buffer.status = (ch->fill[index] < ch->dataSize) ? CY_U3P_DMA_BUFFER_EOP : 0;
+        SimDmaNotify (ch, CY_U3P_DMA_CB_PROD_EVENT, &buffer);
+    }
+    SimSignal ();
+}
+
+/* Move the channel to the configured state when the transfer is done. */
+static void
+SimDmaCheckDone (
+        SimDmaChannel *ch)
+{
+    if ((ch->state == CY_U3P_DMA_ACTIVE) && (ch->xferSize != 0) && (ch->consCount >= ch->xferSize))
+    {
+        ch->state = CY_U3P_DMA_CONFIGURED;
+        SimDmaNotify (ch, CY_U3P_DMA_CB_XFER_CPLT, NULL);
+    }
+    SimSignal ();
+}
+
+/* Socket side */
+
+SimDmaChannel *
+SimDmaFindProducer (
+        CyU3PDmaSocketId_t sckId)
+{
+    SimDmaChannel *ch;
+
+    for (ch = simChannels; ch != NULL; ch = ch->next)
+    {
+        if (ch->config.prodSckId == sckId)
+        {
+            return ch;
+        }
+    }
+    return NULL;
+}
+
+SimDmaChannel *
+SimDmaFindConsumer (
+        CyU3PDmaSocketId_t sckId)
+{
+    SimDmaChannel *ch;
+
+    for (ch = simChannels; ch != NULL; ch = ch->next)
+    {
+        if (ch->config.consSckId == sckId)
+        {
+            return ch;
+        }
+    }
+    return NULL;
+}
+
+uint8_t *
+SimDmaProdSpace (
+        SimDmaChannel *ch,
+        uint32_t *space)
+{
+    uint16_t index = ch->prodIdx;
+
+    *space = 0;
+    if (ch->state == CY_U3P_DMA_PROD_OVERRIDE)
+    {
+        *space = ch->ovrBuf.count - ch->ovrOffset;
+        return ch->ovrBuf.buffer + ch->ovrOffset;
+    }
+
+    if ((ch->state != CY_U3P_DMA_ACTIVE) || (ch->bufState[index] != SIM_BUF_EMPTY))
+    {
+        return NULL;
+    }
+    if ((ch->xferSize != 0) && (ch->prodCount >= ch->xferSize))
+    {
+        return NULL;
+    }
+
+    *space = ch->dataSize - ch->fill[index];
+    if ((ch->xferSize != 0) && (*space > ch->xferSize - ch->prodCount))
+    {
+        *space = ch->xferSize - ch->prodCount;
+    }
+    return ch->mem[index] + ch->config.prodHeader + ch->fill[index];
+}
+
+void
+SimDmaProduce (
+        SimDmaChannel *ch,
+        uint32_t count,
+        CyBool_t isEop)
+{
+    uint16_t index = ch->prodIdx;
+
+    if (ch->state == CY_U3P_DMA_PROD_OVERRIDE)
+    {
+        ch->ovrOffset += count;
+        if (ch->ovrOffset >= ch->ovrBuf.count)
+        {
+            ch->ovrBuf.count = ch->ovrOffset;
+            ch->state = CY_U3P_DMA_CONFIGURED;
+            SimDmaNotify (ch, CY_U3P_DMA_CB_RECV_CPLT, &ch->ovrBuf);
+        }
+        SimSignal ();
+        return;
+    }
+
+    ch->fill[index] += count;
+    ch->prodCount   += count;
+    if ((isEop) || (ch->fill[index] >= ch->dataSize) ||
+            ((ch->xferSize != 0) && (ch->prodCount >= ch->xferSize)))
+    {
+        SimDmaComplete (ch);
+    }
+}
+
+uint8_t *
+SimDmaConsData (
+        SimDmaChannel *ch,
+        uint32_t *count,
+        CyBool_t *isEop)
+{
+    uint16_t index = ch->consIdx;
+
+    *count = 0;
+    *isEop = CyFalse;
+    if (ch->state == CY_U3P_DMA_CONS_OVERRIDE)
+    {
+        *count = ch->ovrBuf.count - ch->ovrOffset;
+        return ch->ovrBuf.buffer + ch->ovrOffset;
+    }
+
+    if ((ch->state != CY_U3P_DMA_ACTIVE) || (ch->bufState[index] != SIM_BUF_COMMITTED))
+    {
+        return NULL;
+    }
+
+    *count = ch->fill[index] - ch->consOffset;
+    *isEop = (ch->fill[index] < ch->dataSize);
+    return ch->mem[index] + ch->config.prodHeader + ch->consOffset;
+}
+
+void
+SimDmaConsume (
+        SimDmaChannel *ch,
+        uint32_t count)
+{
+    CyU3PDmaBuffer_t buffer;
+    uint16_t index = ch->consIdx;
+
+    if (ch->state == CY_U3P_DMA_CONS_OVERRIDE)
+    {
+        ch->ovrOffset += count;
+        if (ch->ovrOffset >= ch->ovrBuf.count)
+        {
+            ch->state = CY_U3P_DMA_CONFIGURED;
+            SimDmaNotify (ch, CY_U3P_DMA_CB_SEND_CPLT, &ch->ovrBuf);
+        }
+        SimSignal ();
+        return;
+    }
+
+    ch->consOffset += count;
+    ch->consCount  += count;
+    if (ch->consOffset >= ch->fill[index])
+    {
+        /* A ZLP is a buffer of its own, so it is signaled as well. */
+        if (ch->type != CY_U3P_DMA_TYPE_AUTO)
+        {
+            buffer.buffer = ch->mem[index] + ch->config.prodHeader;
+            buffer.count  = ch->fill[index];
+            buffer.size   = ch->dataSize;
+            buffer.status = 0;
+            SimDmaNotify (ch, CY_U3P_DMA_CB_CONS_EVENT, &buffer);
+        }
+        ch->bufState[index] = SIM_BUF_EMPTY;
+        ch->fill[index]     = 0;
+        ch->consOffset      = 0;
+        ch->consIdx         = (index + 1) % ch->config.count;
+    }
+    SimDmaCheckDone (ch);
+}
+
+/* CPU side */
+
+CyU3PReturnStatus_t
+CyU3PDmaChannelCreate (
+        CyU3PDmaChannel *handle,
+        CyU3PDmaType_t type,
+        CyU3PDmaChannelConfig_t *config)
+{
+    SimDmaChannel *ch;
+    uint16_t i;
+
+    if ((handle == NULL) || (config == NULL))
+    {
+        return CY_U3P_ERROR_NULL_POINTER;
+    }
+    if ((config->count > SIM_DMA_MAX_BUFFERS) || (type > CY_U3P_DMA_TYPE_MANUAL_OUT) ||
+            (type == CY_U3P_DMA_TYPE_AUTO_SIGNAL) ||
+            (config->size <= config->prodHeader + config->prodFooter))
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    ch = (SimDmaChannel *)calloc (1, sizeof (SimDmaChannel));
+    ch->handle   = handle;
+    ch->type     = type;
+    ch->config   = *config;
+    ch->dataSize = config->size - config->prodHeader - config->prodFooter;
+    for (i = 0; i < config->count; i++)
+    {
+        ch->mem[i] = (uint8_t *)CyU3PDmaBufferAlloc (config->size);
+        if (ch->mem[i] == NULL)
+        {
+            while (i > 0)
+            {
+                CyU3PDmaBufferFree (ch->mem[--i]);
+            }
+            free (ch);
+            return CY_U3P_ERROR_MEMORY_ERROR;
+        }
+    }
+    SimDmaClear (ch);
+    ch->state = CY_U3P_DMA_CONFIGURED;
+
+    ch->next    = simChannels;
+    simChannels = ch;
+    handle->sim_p = ch;
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PDmaChannelDestroy (
+        CyU3PDmaChannel *handle)
+{
+    SimDmaChannel *ch = SimDmaGet (handle);
+    SimDmaChannel **link_p;
+    uint16_t i;
+
+    if (ch == NULL)
+    {
+        return CY_U3P_ERROR_NOT_CONFIGURED;
+    }
+
+    for (link_p = &simChannels; *link_p != ch; link_p = &(*link_p)->next)
+        ;
+    *link_p = ch->next;
+    for (i = 0; i < ch->config.count; i++)
+    {
+        CyU3PDmaBufferFree (ch->mem[i]);
+    }
+
+    /* The structure is kept, so a context waiting on the channel sees
+     * that the channel is gone. */
+    ch->isDestroyed = CyTrue;
+    ch->state = CY_U3P_DMA_NOT_CONFIGURED;
+    handle->sim_p = NULL;
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PDmaChannelSetXfer (
+        CyU3PDmaChannel *handle,
+        uint32_t count)
+{
+    SimDmaChannel *ch = SimDmaGet (handle);
+
+    if (ch == NULL)
+    {
+        return CY_U3P_ERROR_NOT_CONFIGURED;
+    }
+    if (ch->state != CY_U3P_DMA_CONFIGURED)
+    {
+        return CY_U3P_ERROR_ALREADY_STARTED;
+    }
+    if (ch->config.count == 0)
+    {
+        return CY_U3P_ERROR_NOT_SUPPORTED;
+    }
+
+    SimDmaClear (ch);
+    ch->xferSize = count;
+    ch->state    = CY_U3P_DMA_ACTIVE;
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PDmaChannelGetBuffer (
+        CyU3PDmaChannel *handle,
+        CyU3PDmaBuffer_t *buffer_p,
+        uint32_t waitOption)
+{
+    SimDmaChannel *ch = SimDmaGet (handle);
+    struct timespec deadline;
+    uint16_t index = 0;
+
+    if (ch == NULL)
+    {
+        return CY_U3P_ERROR_NOT_CONFIGURED;
+    }
+    if (ch->type == CY_U3P_DMA_TYPE_AUTO)
+    {
+        return CY_U3P_ERROR_NOT_SUPPORTED;
+    }
+
+    SimDeadline (&deadline, waitOption);
+    for (;;)
+    {
+        if (ch->isDestroyed)
+        {
+            return CY_U3P_ERROR_ABORTED;
+        }
+        if (ch->state == CY_U3P_DMA_ACTIVE)
+        {
+            switch (ch->type)
+            {
+                case CY_U3P_DMA_TYPE_MANUAL_OUT:
+                    index = ch->prodIdx;
+                    break;
+                case CY_U3P_DMA_TYPE_MANUAL:
+                    index = ch->cpuIdx;
+                    break;
+                default:
+                    index = ch->consIdx;
+                    break;
+            }
+            if (ch->bufState[index] == ((ch->type == CY_U3P_DMA_TYPE_MANUAL_OUT) ?
+                        SIM_BUF_EMPTY : SIM_BUF_PRODUCED))
+            {
+                break;
+            }
+        }
+        if (!SimWait (&deadline, waitOption))
+        {
+            return CY_U3P_ERROR_TIMEOUT;
+        }
+    }
+
+    buffer_p->buffer = ch->mem[index] + ch->config.prodHeader;
+    buffer_p->count  = ch->fill[index];
+    buffer_p->size   = ch->dataSize;
+    buffer_p->status = ((ch->type != CY_U3P_DMA_TYPE_MANUAL_OUT) &&
+            (ch->fill[index] < ch->dataSize)) ? CY_U3P_DMA_BUFFER_EOP : 0;
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PDmaChannelCommitBuffer (
+        CyU3PDmaChannel *handle,
+        uint16_t count,
+        uint16_t bufStatus)
+{
+    SimDmaChannel *ch = SimDmaGet (handle);
+    uint16_t index;
+
+    (void) bufStatus;
+
+    if (ch == NULL)
+    {
+        return CY_U3P_ERROR_NOT_CONFIGURED;
+    }
+    if (ch->state != CY_U3P_DMA_ACTIVE)
+    {
+        return CY_U3P_ERROR_NOT_STARTED;
+    }
+    if (count > ch->dataSize)
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    if (ch->type == CY_U3P_DMA_TYPE_MANUAL_OUT)
+    {
+        index = ch->prodIdx;
+        if (ch->bufState[index] != SIM_BUF_EMPTY)
+        {
+            return CY_U3P_ERROR_INVALID_SEQUENCE;
+        }
+        ch->prodIdx = (index + 1) % ch->config.count;
+        ch->prodCount += count;
+    }
+    else if (ch->type == CY_U3P_DMA_TYPE_MANUAL)
+    {
+        index = ch->cpuIdx;
+        if (ch->bufState[index] != SIM_BUF_PRODUCED)
+        {
+            return CY_U3P_ERROR_INVALID_SEQUENCE;
+        }
+        ch->cpuIdx = (index + 1) % ch->config.count;
+    }
+    else
+    {
+        return CY_U3P_ERROR_NOT_SUPPORTED;
+    }
+
+    ch->fill[index]     = count;
+    ch->bufState[index] = SIM_BUF_COMMITTED;
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PDmaChannelDiscardBuffer (
+        CyU3PDmaChannel *handle)
+{
+    SimDmaChannel *ch = SimDmaGet (handle);
+    uint16_t index;
+
+    if (ch == NULL)
+    {
+        return CY_U3P_ERROR_NOT_CONFIGURED;
+    }
+    if (ch->state != CY_U3P_DMA_ACTIVE)
+    {
+        return CY_U3P_ERROR_NOT_STARTED;
+    }
+
+    /* A buffer discarded from a MANUAL channel would have to be skipped
+     * by the consumer socket, which the simulation does not support. */
+    if (ch->type != CY_U3P_DMA_TYPE_MANUAL_IN)
+    {
+        return CY_U3P_ERROR_NOT_SUPPORTED;
+    }
+
+    index = ch->consIdx;
+    if (ch->bufState[index] != SIM_BUF_PRODUCED)
+    {
+        return CY_U3P_ERROR_INVALID_SEQUENCE;
+    }
+    ch->consCount      += ch->fill[index];
+    ch->fill[index]     = 0;
+    ch->bufState[index] = SIM_BUF_EMPTY;
+    ch->consIdx = (index + 1) % ch->config.count;
+    SimDmaCheckDone (ch);
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PDmaChannelSetupSendBuffer (
+        CyU3PDmaChannel *handle,
+        CyU3PDmaBuffer_t *buffer_p)
+{
+    SimDmaChannel *ch = SimDmaGet (handle);
+
+    if (ch == NULL)
+    {
+        return CY_U3P_ERROR_NOT_CONFIGURED;
+    }
+    if (ch->state != CY_U3P_DMA_CONFIGURED)
+    {
+        return CY_U3P_ERROR_ALREADY_STARTED;
+    }
+    if ((buffer_p == NULL) || (buffer_p->buffer == NULL) || (buffer_p->count > buffer_p->size))
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+    if (((uintptr_t)buffer_p->buffer & 0x03) != 0)
+    {
+        SimError ("send buffer %p is not word aligned", buffer_p->buffer);
+    }
+
+    ch->ovrBuf    = *buffer_p;
+    ch->ovrOffset = 0;
+    ch->state     = CY_U3P_DMA_CONS_OVERRIDE;
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PDmaChannelSetupRecvBuffer (
+        CyU3PDmaChannel *handle,
+        CyU3PDmaBuffer_t *buffer_p)
+{
+    SimDmaChannel *ch = SimDmaGet (handle);
+
+    if (ch == NULL)
+    {
+        return CY_U3P_ERROR_NOT_CONFIGURED;
+    }
+    if (ch->state != CY_U3P_DMA_CONFIGURED)
+    {
+        return CY_U3P_ERROR_ALREADY_STARTED;
+    }
+    if ((buffer_p == NULL) || (buffer_p->buffer == NULL) || (buffer_p->count > buffer_p->size))
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    ch->ovrBuf    = *buffer_p;
+    ch->ovrOffset = 0;
+    ch->state     = CY_U3P_DMA_PROD_OVERRIDE;
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PDmaChannelWaitForCompletion (
+        CyU3PDmaChannel *handle,
+        uint32_t waitOption)
+{
+    SimDmaChannel *ch = SimDmaGet (handle);
+    struct timespec deadline;
+
+    if (ch == NULL)
+    {
+        return CY_U3P_ERROR_NOT_CONFIGURED;
+    }
+
+    SimDeadline (&deadline, waitOption);
+    for (;;)
+    {
+        if (ch->isDestroyed)
+        {
+            return CY_U3P_ERROR_ABORTED;
+        }
+        if ((ch->state == CY_U3P_DMA_CONFIGURED) || (ch->state == CY_U3P_DMA_NOT_CONFIGURED))
+        {
+            return CY_U3P_SUCCESS;
+        }
+        if (!SimWait (&deadline, waitOption))
+        {
+            return CY_U3P_ERROR_TIMEOUT;
+        }
+    }
+}
+
+CyU3PReturnStatus_t
+CyU3PDmaChannelSetWrapUp (
+        CyU3PDmaChannel *handle)
+{
+    SimDmaChannel *ch = SimDmaGet (handle);
+
+    if (ch == NULL)
+    {
+        return CY_U3P_ERROR_NOT_CONFIGURED;
+    }
+
+    if (ch->state == CY_U3P_DMA_PROD_OVERRIDE)
+    {
+        ch->ovrBuf.count = ch->ovrOffset;
+        ch->state = CY_U3P_DMA_CONFIGURED;
+        SimDmaNotify (ch, CY_U3P_DMA_CB_RECV_CPLT, &ch->ovrBuf);
+        SimSignal ();
+    }
+    else if ((ch->state == CY_U3P_DMA_ACTIVE) && (ch->bufState[ch->prodIdx] == SIM_BUF_EMPTY) &&
+            (ch->fill[ch->prodIdx] > 0))
+    {
+        SimDmaComplete (ch);
+    }
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PDmaChannelReset (
+        CyU3PDmaChannel *handle)
+{
+    SimDmaChannel *ch = SimDmaGet (handle);
+
+    if (ch == NULL)
+    {
+        return CY_U3P_ERROR_NOT_CONFIGURED;
+    }
+
+    SimDmaClear (ch);
+    ch->state = CY_U3P_DMA_CONFIGURED;
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PDmaChannelGetStatus (
+        CyU3PDmaChannel *handle,
+        CyU3PDmaState_t *state,
+        uint32_t *prodXferCount,
+        uint32_t *consXferCount)
+{
+    SimDmaChannel *ch = SimDmaGet (handle);
+
+    if (ch == NULL)
+    {
+        return CY_U3P_ERROR_NOT_CONFIGURED;
+    }
+
+    *state         = ch->state;
+    *prodXferCount = ch->prodCount;
+    *consXferCount = ch->consCount;
+    return CY_U3P_SUCCESS;
+}
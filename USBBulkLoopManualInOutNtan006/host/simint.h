@@ -0,0 +1,95 @@
+/*
+ * Internal definitions shared by the modules of the FX3 host simulation
+ *
+ * The simulation runs each firmware thread and each driver context on a
+ * POSIX thread, but only one of them runs at a time: all of them hold
+ * simLock while they run and release it only while they are blocked.
+ * This is how the single ARM core of the FX3 serializes the threads, so
+ * the application sees the same interleaving at its blocking calls as
+ * on the device. Every state change is announced by SimSignal, and the
+ * blocked contexts re-check their condition when they wake up.
+ */
+
+#ifndef _INCLUDED_SIMINT_H_
+#define _INCLUDED_SIMINT_H_
+
+#include <pthread.h>
+#include <time.h>
+
+#include "cyu3types.h"
+#include "cyu3os.h"
+#include "cyu3dma.h"
+#include "cyu3usb.h"
+#include "fx3sim.h"
+
+/* FX3 system RAM mapped at its device address */
+#define SIM_RAM_BASE                    (0x40000000UL)
+#define SIM_RAM_SIZE                    (0x80000UL)
+
+extern pthread_mutex_t simLock;
+extern FX3SimConfig_t simConfig;
+
+/* Wake up all the blocked contexts to re-check their conditions. */
+extern void SimSignal (void);
+
+/* Convert a wait option in ms to an absolute deadline. */
+extern void SimDeadline (struct timespec *deadline, uint32_t waitOption);
+
+/* Block until signaled or until the deadline. Returns CyFalse when the
+ * deadline has passed. */
+extern CyBool_t SimWait (const struct timespec *deadline, uint32_t waitOption);
+
+/* Release the CPU for the given time in ns, as a transfer on a bus does. */
+extern void SimBusDelay (uint64_t ns);
+
+/* Release the CPU for the delays collected by SimBusDelay, so that they
+ * are charged to the transfer which caused them. */
+extern void SimBusFlush (void);
+
+/* Enter and leave the simulation from a host context. */
+extern void SimEnter (void);
+extern void SimLeave (void);
+
+/* Start a driver context and mark the calling thread as that context. */
+extern void SimThreadStart (void *(*entry) (void *), void *arg);
+extern void SimSetContext (CyU3PThread *thread_p);
+
+/* Debug output of the simulation */
+extern void SimLog (const char *format, ...) __attribute__ ((format (printf, 1, 2)));
+
+/* Report a misuse of the simulated hardware by the firmware. */
+extern void SimError (const char *format, ...) __attribute__ ((format (printf, 1, 2)));
+
+/* DMA sockets served by the peripheral models (simdma.c) */
+typedef struct SimDmaChannel SimDmaChannel;
+
+/* Find the active channel served by a producer or consumer socket. */
+extern SimDmaChannel *SimDmaFindProducer (CyU3PDmaSocketId_t sckId);
+extern SimDmaChannel *SimDmaFindConsumer (CyU3PDmaSocketId_t sckId);
+
+/* Get the space the producer socket can write to. Returns NULL when no
+ * buffer is free. */
+extern uint8_t *SimDmaProdSpace (SimDmaChannel *ch, uint32_t *space);
+
+/* Account count bytes written to the space by the producer socket. The
+ * buffer is completed when it is full, when isEop is set, or when the
+ * transfer size is reached. */
+extern void SimDmaProduce (SimDmaChannel *ch, uint32_t count, CyBool_t isEop);
+
+/* Get the data the consumer socket can read. Returns NULL when no buffer
+ * is ready, and sets *isEop when a short buffer ends at *count. */
+extern uint8_t *SimDmaConsData (SimDmaChannel *ch, uint32_t *count, CyBool_t *isEop);
+
+/* Account count bytes read from the data by the consumer socket. */
+extern void SimDmaConsume (SimDmaChannel *ch, uint32_t count);
+
+/* Start the DMA driver context which calls the channel callbacks. */
+extern void SimDmaStart (void);
+
+/* Start the SPI block model (simspi.c). */
+extern void SimSpiStart (void);
+
+/* USB device state (simusb.c) */
+extern CyBool_t SimUsbIsConnected (void);
+
+#endif /* _INCLUDED_SIMINT_H_ */
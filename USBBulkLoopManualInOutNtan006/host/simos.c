@@ -0,0 +1,943 @@
+/*
+ * FX3 host simulation: RTOS services and system functions
+ *
+ * The ThreadX services used by the application are implemented on top
+ * of the CPU lock described in simint.h. Times are in ms, the length of
+ * an RTOS tick on the FX3.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "cyu3system.h"
+#include "cyu3os.h"
+#include "cyu3error.h"
+#include "cyu3uart.h"
+#include "simint.h"
+
+/* Provided by the application and by cyfxtx.c */
+extern void CyFxApplicationDefine (void);
+extern int CyFxFirmwareMain (void);
+
+pthread_mutex_t simLock = PTHREAD_MUTEX_INITIALIZER;
+FX3SimConfig_t simConfig;
+
+static pthread_cond_t simCond;
+static struct timespec simBootTime;
+static CyBool_t simKernelStarted = CyFalse;
+static uint32_t simErrors = 0;
+
+/* Context of the calling thread. NULL before the kernel is started. */
+static __thread CyU3PThread *simSelf = NULL;
+
+/* Identifies the calling thread as the owner of a mutex. */
+static __thread char simContextId;
+
+/* Bus time not taken yet by the calling thread */
+static __thread uint64_t simBusDebt = 0;
+
+/* Context of the host calls, which act as the USB driver thread. */
+static CyU3PThread simHostThread = {NULL, "sim:usb", NULL, 0, 0};
+
+typedef struct SimThread
+{
+    CyU3PThread         *thread_p;
+    CyU3PThreadEntry_t  entryFn;
+    uint32_t            entryInput;
+} SimThread;
+
+/* Header of a byte pool block. The data follows the header. */
+typedef struct SimBlock
+{
+    struct SimBlock     *next;          /* Next block in the address order */
+    CyU3PBytePool       *pool_p;
+    uint32_t            size;           /* Size of the data */
+    uint32_t            isFree;
+} SimBlock;
+
+#define SIM_BLOCK_ALIGN                 (32)
+#define SIM_BLOCK_HEADER                ((sizeof (SimBlock) + SIM_BLOCK_ALIGN - 1) & ~(SIM_BLOCK_ALIGN - 1))
+
+void
+SimLog (
+        const char *format, ...)
+{
+    va_list args;
+
+    if (!simConfig.verbose)
+    {
+        return;
+    }
+    va_start (args, format);
+    fprintf (stderr, "[sim %6u] ", FX3SimGetTime ());
+    vfprintf (stderr, format, args);
+    fputc ('\n', stderr);
+    va_end (args);
+}
+
+void
+SimError (
+        const char *format, ...)
+{
+    va_list args;
+
+    simErrors++;
+    va_start (args, format);
+    fprintf (stderr, "[sim %6u] error: ", FX3SimGetTime ());
+    vfprintf (stderr, format, args);
+    fputc ('\n', stderr);
+    va_end (args);
+}
+
+uint32_t
+FX3SimErrorCount (
+        void)
+{
+    return simErrors;
+}
+
+void
+SimSignal (
+        void)
+{
+    pthread_cond_broadcast (&simCond);
+}
+
+void
+SimDeadline (
+        struct timespec *deadline,
+        uint32_t waitOption)
+{
+    clock_gettime (CLOCK_MONOTONIC, deadline);
+    if ((waitOption == CYU3P_NO_WAIT) || (waitOption == CYU3P_WAIT_FOREVER))
+    {
+        return;
+    }
+    deadline->tv_sec  += waitOption / 1000;
+    deadline->tv_nsec += (long)(waitOption % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L)
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+CyBool_t
+SimWait (
+        const struct timespec *deadline,
+        uint32_t waitOption)
+{
+    if (waitOption == CYU3P_NO_WAIT)
+    {
+        return CyFalse;
+    }
+    if (waitOption == CYU3P_WAIT_FOREVER)
+    {
+        pthread_cond_wait (&simCond, &simLock);
+        return CyTrue;
+    }
+    return (pthread_cond_timedwait (&simCond, &simLock, deadline) != ETIMEDOUT);
+}
+
+void
+SimBusDelay (
+        uint64_t ns)
+{
+    /* Short delays are collected to keep the timer resolution. */
+    simBusDebt += ns;
+    if (simBusDebt >= 200000)
+    {
+        SimBusFlush ();
+    }
+}
+
+void
+SimBusFlush (
+        void)
+{
+    struct timespec deadline;
+
+    if (simBusDebt == 0)
+    {
+        return;
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec  += simBusDebt / 1000000000UL;
+    deadline.tv_nsec += simBusDebt % 1000000000UL;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    simBusDebt = 0;
+    while (pthread_cond_timedwait (&simCond, &simLock, &deadline) != ETIMEDOUT)
+        ;
+}
+
+void
+SimEnter (
+        void)
+{
+    pthread_mutex_lock (&simLock);
+    if (simSelf == NULL)
+    {
+        simSelf = &simHostThread;
+    }
+}
+
+void
+SimLeave (
+        void)
+{
+    pthread_mutex_unlock (&simLock);
+}
+
+void
+SimSetContext (
+        CyU3PThread *thread_p)
+{
+    simSelf = thread_p;
+}
+
+void
+SimThreadStart (
+        void *(*entry) (void *),
+        void *arg)
+{
+    pthread_t      thread;
+    pthread_attr_t attr;
+
+    pthread_attr_init (&attr);
+    pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create (&thread, &attr, entry, arg) != 0)
+    {
+        perror ("pthread_create");
+        abort ();
+    }
+    pthread_attr_destroy (&attr);
+}
+
+uint32_t
+FX3SimGetTime (
+        void)
+{
+    struct timespec now;
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (uint32_t)((now.tv_sec - simBootTime.tv_sec) * 1000 +
+            (now.tv_nsec - simBootTime.tv_nsec) / 1000000);
+}
+
+uint32_t
+CyU3PGetTime (
+        void)
+{
+    return FX3SimGetTime ();
+}
+
+/* Kernel */
+
+void
+CyU3PApplicationDefine (
+        void)
+{
+    CyU3PMemInit ();
+    CyU3PDmaBufferInit ();
+    CyFxApplicationDefine ();
+}
+
+void
+CyU3PKernelEntry (
+        void)
+{
+    tx_application_define (NULL);
+
+    SimDmaStart ();
+    SimSpiStart ();
+
+    simKernelStarted = CyTrue;
+    SimSignal ();
+
+    /* The threads run from here on. */
+    for (;;)
+    {
+        pthread_cond_wait (&simCond, &simLock);
+    }
+}
+
+/* Threads */
+
+static void *
+SimThreadEntry (
+        void *arg)
+{
+    SimThread *sim_p = (SimThread *)arg;
+
+    pthread_mutex_lock (&simLock);
+    SimSetContext (sim_p->thread_p);
+    while (!simKernelStarted)
+    {
+        pthread_cond_wait (&simCond, &simLock);
+    }
+
+    sim_p->entryFn (sim_p->entryInput);
+
+    SimLog ("thread %s returned", sim_p->thread_p->name);
+    pthread_mutex_unlock (&simLock);
+    return NULL;
+}
+
+uint32_t
+CyU3PThreadCreate (
+        CyU3PThread *thread_p,
+        char *threadName,
+        CyU3PThreadEntry_t entryFn,
+        uint32_t entryInput,
+        void *stackStart,
+        uint32_t stackSize,
+        uint32_t priority,
+        uint32_t preemptThreshold,
+        uint32_t timeSlice,
+        uint32_t autoStart)
+{
+    SimThread *sim_p;
+
+    (void) preemptThreshold;
+    (void) timeSlice;
+
+    if ((thread_p == NULL) || (entryFn == NULL) || (stackStart == NULL))
+    {
+        return CY_U3P_ERROR_BAD_POINTER;
+    }
+    if (autoStart != CYU3P_AUTO_START)
+    {
+        return CY_U3P_ERROR_NOT_SUPPORTED;
+    }
+
+    /* The thread runs on the host stack, and the given stack is not used. */
+    sim_p = (SimThread *)calloc (1, sizeof (SimThread));
+    sim_p->thread_p   = thread_p;
+    sim_p->entryFn    = entryFn;
+    sim_p->entryInput = entryInput;
+
+    thread_p->sim_p      = (struct SimThread *)sim_p;
+    thread_p->name       = threadName;
+    thread_p->stackStart = (uint8_t *)stackStart;
+    thread_p->stackSize  = stackSize;
+    thread_p->priority   = priority;
+
+    SimThreadStart (SimThreadEntry, sim_p);
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PThread *
+CyU3PThreadIdentify (
+        void)
+{
+    return simSelf;
+}
+
+uint32_t
+CyU3PThreadSleep (
+        uint32_t timerTicks)
+{
+    struct timespec deadline;
+
+    SimDeadline (&deadline, timerTicks);
+    while ((timerTicks != CYU3P_NO_WAIT) && (SimWait (&deadline, timerTicks)))
+        ;
+    return CY_U3P_SUCCESS;
+}
+
+uint32_t
+CyU3PThreadRelinquish (
+        void)
+{
+    pthread_mutex_unlock (&simLock);
+    sched_yield ();
+    pthread_mutex_lock (&simLock);
+    return CY_U3P_SUCCESS;
+}
+
+/* Event groups */
+
+uint32_t
+CyU3PEventCreate (
+        CyU3PEvent *event_p)
+{
+    event_p->flags   = 0;
+    event_p->isValid = CyTrue;
+    return CY_U3P_SUCCESS;
+}
+
+uint32_t
+CyU3PEventDestroy (
+        CyU3PEvent *event_p)
+{
+    event_p->isValid = CyFalse;
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+uint32_t
+CyU3PEventSet (
+        CyU3PEvent *event_p,
+        uint32_t rqtFlag,
+        uint32_t setOption)
+{
+    if (!event_p->isValid)
+    {
+        return CY_U3P_ERROR_BAD_EVENT_GROUP;
+    }
+    if (setOption == CYU3P_EVENT_AND)
+    {
+        event_p->flags &= rqtFlag;
+    }
+    else
+    {
+        event_p->flags |= rqtFlag;
+    }
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+uint32_t
+CyU3PEventGet (
+        CyU3PEvent *event_p,
+        uint32_t rqtFlag,
+        uint32_t getOption,
+        uint32_t *flag_p,
+        uint32_t waitOption)
+{
+    struct timespec deadline;
+    CyBool_t isAnd = ((getOption & CYU3P_EVENT_AND) != 0);
+
+    SimDeadline (&deadline, waitOption);
+    for (;;)
+    {
+        if (!event_p->isValid)
+        {
+            return CY_U3P_ERROR_DELETED;
+        }
+        if ((isAnd) ? ((event_p->flags & rqtFlag) == rqtFlag) : ((event_p->flags & rqtFlag) != 0))
+        {
+            break;
+        }
+        if (!SimWait (&deadline, waitOption))
+        {
+            return CY_U3P_ERROR_NO_EVENTS;
+        }
+    }
+
+    *flag_p = event_p->flags;
+    if ((getOption & 1) != 0)
+    {
+        event_p->flags &= ~rqtFlag;
+    }
+    return CY_U3P_SUCCESS;
+}
+
+/* Mutexes. Priority inheritance has no effect without priorities. */
+
+uint32_t
+CyU3PMutexCreate (
+        CyU3PMutex *mutex_p,
+        uint32_t priorityInherit)
+{
+    (void) priorityInherit;
+
+    mutex_p->owner   = NULL;
+    mutex_p->count   = 0;
+    mutex_p->isValid = CyTrue;
+    return CY_U3P_SUCCESS;
+}
+
+uint32_t
+CyU3PMutexDestroy (
+        CyU3PMutex *mutex_p)
+{
+    mutex_p->isValid = CyFalse;
+    mutex_p->owner   = NULL;
+    mutex_p->count   = 0;
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+uint32_t
+CyU3PMutexGet (
+        CyU3PMutex *mutex_p,
+        uint32_t waitOption)
+{
+    struct timespec deadline;
+
+    SimDeadline (&deadline, waitOption);
+    for (;;)
+    {
+        if (!mutex_p->isValid)
+        {
+            return CY_U3P_ERROR_BAD_MUTEX;
+        }
+        if ((mutex_p->owner == NULL) || (mutex_p->owner == &simContextId))
+        {
+            break;
+        }
+        if (!SimWait (&deadline, waitOption))
+        {
+            return CY_U3P_ERROR_MUTEX_FAILURE;
+        }
+    }
+
+    mutex_p->owner = &simContextId;
+    mutex_p->count++;
+    return CY_U3P_SUCCESS;
+}
+
+uint32_t
+CyU3PMutexPut (
+        CyU3PMutex *mutex_p)
+{
+    if (!mutex_p->isValid)
+    {
+        return CY_U3P_ERROR_BAD_MUTEX;
+    }
+    if (mutex_p->owner != &simContextId)
+    {
+        return CY_U3P_ERROR_NOT_OWNED;
+    }
+    if (--mutex_p->count == 0)
+    {
+        mutex_p->owner = NULL;
+        SimSignal ();
+    }
+    return CY_U3P_SUCCESS;
+}
+
+/* Message queues */
+
+uint32_t
+CyU3PQueueCreate (
+        CyU3PQueue *queue_p,
+        uint32_t messageSize,
+        void *queueStart,
+        uint32_t queueSize)
+{
+    if (queueStart == NULL)
+    {
+        return CY_U3P_ERROR_BAD_POINTER;
+    }
+    if ((messageSize == 0) || (queueSize < messageSize * 4))
+    {
+        return CY_U3P_ERROR_BAD_SIZE;
+    }
+
+    queue_p->start    = (uint32_t *)queueStart;
+    queue_p->msgWords = messageSize;
+    queue_p->capacity = queueSize / (messageSize * 4);
+    queue_p->head     = 0;
+    queue_p->level    = 0;
+    queue_p->isValid  = CyTrue;
+    return CY_U3P_SUCCESS;
+}
+
+uint32_t
+CyU3PQueueDestroy (
+        CyU3PQueue *queue_p)
+{
+    queue_p->isValid = CyFalse;
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+uint32_t
+CyU3PQueueSend (
+        CyU3PQueue *queue_p,
+        void *src_p,
+        uint32_t waitOption)
+{
+    struct timespec deadline;
+    uint32_t index;
+
+    SimDeadline (&deadline, waitOption);
+    for (;;)
+    {
+        if (!queue_p->isValid)
+        {
+            return CY_U3P_ERROR_BAD_QUEUE;
+        }
+        if (queue_p->level < queue_p->capacity)
+        {
+            break;
+        }
+        if (!SimWait (&deadline, waitOption))
+        {
+            return CY_U3P_ERROR_QUEUE_FULL;
+        }
+    }
+
+    index = (queue_p->head + queue_p->level) % queue_p->capacity;
+    memcpy (queue_p->start + index * queue_p->msgWords, src_p, queue_p->msgWords * 4);
+    queue_p->level++;
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+uint32_t
+CyU3PQueueReceive (
+        CyU3PQueue *queue_p,
+        void *dest_p,
+        uint32_t waitOption)
+{
+    struct timespec deadline;
+
+    SimDeadline (&deadline, waitOption);
+    for (;;)
+    {
+        if (!queue_p->isValid)
+        {
+            return CY_U3P_ERROR_BAD_QUEUE;
+        }
+        if (queue_p->level > 0)
+        {
+            break;
+        }
+        if (!SimWait (&deadline, waitOption))
+        {
+            return CY_U3P_ERROR_QUEUE_EMPTY;
+        }
+    }
+
+    memcpy (dest_p, queue_p->start + queue_p->head * queue_p->msgWords, queue_p->msgWords * 4);
+    queue_p->head = (queue_p->head + 1) % queue_p->capacity;
+    queue_p->level--;
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+uint32_t
+CyU3PQueueFlush (
+        CyU3PQueue *queue_p)
+{
+    queue_p->head  = 0;
+    queue_p->level = 0;
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+/* Byte pools. The blocks are kept in the address order and the free
+ * neighbours are merged. */
+
+uint32_t
+CyU3PBytePoolCreate (
+        CyU3PBytePool *pool_p,
+        void *poolStart,
+        uint32_t poolSize)
+{
+    uintptr_t start = ((uintptr_t)poolStart + SIM_BLOCK_ALIGN - 1) & ~(uintptr_t)(SIM_BLOCK_ALIGN - 1);
+    uintptr_t end   = ((uintptr_t)poolStart + poolSize) & ~(uintptr_t)(SIM_BLOCK_ALIGN - 1);
+    SimBlock *block_p = (SimBlock *)start;
+
+    if (end < start + SIM_BLOCK_HEADER + SIM_BLOCK_ALIGN)
+    {
+        return CY_U3P_ERROR_BAD_SIZE;
+    }
+
+    block_p->next   = NULL;
+    block_p->pool_p = pool_p;
+    block_p->size   = (uint32_t)(end - start - SIM_BLOCK_HEADER);
+    block_p->isFree = CyTrue;
+
+    pool_p->start     = (uint8_t *)start;
+    pool_p->size      = (uint32_t)(end - start);
+    pool_p->available = block_p->size;
+    pool_p->isValid   = CyTrue;
+    return CY_U3P_SUCCESS;
+}
+
+uint32_t
+CyU3PBytePoolDestroy (
+        CyU3PBytePool *pool_p)
+{
+    pool_p->isValid = CyFalse;
+    return CY_U3P_SUCCESS;
+}
+
+uint32_t
+CyU3PByteAlloc (
+        CyU3PBytePool *pool_p,
+        void **mem_p,
+        uint32_t memSize,
+        uint32_t waitOption)
+{
+    struct timespec deadline;
+    SimBlock *block_p, *rest_p;
+    uint32_t size = (memSize + SIM_BLOCK_ALIGN - 1) & ~(SIM_BLOCK_ALIGN - 1);
+
+    *mem_p = NULL;
+    SimDeadline (&deadline, waitOption);
+    for (;;)
+    {
+        if (!pool_p->isValid)
+        {
+            return CY_U3P_ERROR_BAD_POOL;
+        }
+        for (block_p = (SimBlock *)pool_p->start; block_p != NULL; block_p = block_p->next)
+        {
+            if ((block_p->isFree) && (block_p->size >= size))
+            {
+                break;
+            }
+        }
+        if (block_p != NULL)
+        {
+            break;
+        }
+        if (!SimWait (&deadline, waitOption))
+        {
+            return CY_U3P_ERROR_NO_MEMORY;
+        }
+    }
+
+    /* Split the block when the rest is large enough for another one. */
+    if (block_p->size >= size + SIM_BLOCK_HEADER + SIM_BLOCK_ALIGN)
+    {
+        rest_p = (SimBlock *)((uint8_t *)block_p + SIM_BLOCK_HEADER + size);
+        rest_p->next   = block_p->next;
+        rest_p->pool_p = pool_p;
+        rest_p->size   = block_p->size - size - SIM_BLOCK_HEADER;
+        rest_p->isFree = CyTrue;
+        block_p->next  = rest_p;
+        block_p->size  = size;
+        pool_p->available -= SIM_BLOCK_HEADER;
+    }
+
+    block_p->isFree = CyFalse;
+    pool_p->available -= block_p->size;
+    *mem_p = (uint8_t *)block_p + SIM_BLOCK_HEADER;
+    return CY_U3P_SUCCESS;
+}
+
+uint32_t
+CyU3PByteFree (
+        void *mem_p)
+{
+    SimBlock *block_p;
+    CyU3PBytePool *pool_p;
+
+    if (mem_p == NULL)
+    {
+        return CY_U3P_ERROR_BAD_POINTER;
+    }
+
+    block_p = (SimBlock *)((uint8_t *)mem_p - SIM_BLOCK_HEADER);
+    pool_p  = block_p->pool_p;
+    if (block_p->isFree)
+    {
+        SimError ("byte pool block %p freed twice", mem_p);
+        return CY_U3P_ERROR_BAD_POINTER;
+    }
+    block_p->isFree = CyTrue;
+    pool_p->available += block_p->size;
+
+    /* Merge the free neighbours. */
+    for (block_p = (SimBlock *)pool_p->start; block_p != NULL; block_p = block_p->next)
+    {
+        while ((block_p->isFree) && (block_p->next != NULL) && (block_p->next->isFree))
+        {
+            block_p->size += SIM_BLOCK_HEADER + block_p->next->size;
+            block_p->next  = block_p->next->next;
+            pool_p->available += SIM_BLOCK_HEADER;
+        }
+    }
+
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+/* System */
+
+CyU3PReturnStatus_t
+CyU3PDeviceInit (
+        void *clkCfg)
+{
+    void *ram;
+
+    (void) clkCfg;
+
+    /* The application and cyfxtx.c keep the addresses in 32 bits, so the
+     * system RAM is mapped at its device address. */
+    ram = mmap ((void *)SIM_RAM_BASE, SIM_RAM_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (ram != (void *)SIM_RAM_BASE)
+    {
+        SimError ("system RAM cannot be mapped at 0x%lx", SIM_RAM_BASE);
+        return CY_U3P_ERROR_MEMORY_ERROR;
+    }
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PDeviceCacheControl (
+        CyBool_t isICacheEnable,
+        CyBool_t isDCacheEnable,
+        CyBool_t isDmaHandleDCache)
+{
+    (void) isICacheEnable;
+    (void) isDCacheEnable;
+    (void) isDmaHandleDCache;
+    return CY_U3P_SUCCESS;
+}
+
+/* The simulation runs one context at a time under the CPU lock, so the
+ * interrupts have nothing to mask. */
+uint32_t
+CyU3PVicDisableAllInterrupts (
+        void)
+{
+    return 0;
+}
+
+void
+CyU3PVicEnableInterrupts (
+        uint32_t mask)
+{
+    (void) mask;
+}
+
+CyU3PReturnStatus_t
+CyU3PDeviceConfigureIOMatrix (
+        CyU3PIoMatrixConfig_t *cfg_p)
+{
+    if (!cfg_p->useSpi)
+    {
+        SimError ("SPI is not enabled in the IO matrix");
+    }
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PDebugInit (
+        CyU3PDmaSocketId_t destSckId,
+        uint8_t traceLevel)
+{
+    (void) destSckId;
+    (void) traceLevel;
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PDebugPrint (
+        uint8_t priority,
+        char *message, ...)
+{
+    va_list args;
+
+    (void) priority;
+
+    if (simConfig.verbose)
+    {
+        va_start (args, message);
+        fprintf (stderr, "[fx3 %6u] ", FX3SimGetTime ());
+        vfprintf (stderr, message, args);
+        va_end (args);
+    }
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PUartInit (
+        void)
+{
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PUartSetConfig (
+        CyU3PUartConfig_t *config,
+        CyU3PUartIntrCb_t cb)
+{
+    (void) config;
+    (void) cb;
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PUartTxSetBlockXfer (
+        uint32_t txSize)
+{
+    (void) txSize;
+    return CY_U3P_SUCCESS;
+}
+
+/* Host interface */
+
+void
+FX3SimDefaultConfig (
+        FX3SimConfig_t *config)
+{
+    memset (config, 0, sizeof (FX3SimConfig_t));
+    config->framSize   = 256 * 1024;
+    config->framVendor = FX3SIM_FRAM_CYPRESS;
+    config->spiTiming  = CyTrue;
+}
+
+static void *
+SimFirmwareEntry (
+        void *arg)
+{
+    (void) arg;
+
+    pthread_mutex_lock (&simLock);
+    CyFxFirmwareMain ();
+
+    SimError ("firmware main returned");
+    pthread_mutex_unlock (&simLock);
+    return NULL;
+}
+
+int
+FX3SimStart (
+        const FX3SimConfig_t *config)
+{
+    pthread_condattr_t attr;
+    struct timespec deadline;
+    int status = FX3SIM_SUCCESS;
+
+    if (config != NULL)
+    {
+        simConfig = *config;
+    }
+    else
+    {
+        FX3SimDefaultConfig (&simConfig);
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, &simBootTime);
+    pthread_condattr_init (&attr);
+    pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
+    pthread_cond_init (&simCond, &attr);
+    pthread_condattr_destroy (&attr);
+
+    SimThreadStart (SimFirmwareEntry, NULL);
+
+    /* The firmware connects to the bus at the end of its initialization. */
+    SimEnter ();
+    SimDeadline (&deadline, 5000);
+    while (!SimUsbIsConnected ())
+    {
+        if (!SimWait (&deadline, 5000))
+        {
+            status = FX3SIM_ERROR_NO_DEVICE;
+            break;
+        }
+    }
+    SimLeave ();
+    return status;
+}
+
+/* [ ] */
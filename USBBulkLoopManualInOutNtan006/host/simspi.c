@@ -0,0 +1,566 @@
+/*
+ * FX3 host simulation: SPI block and SPI FRAM
+ *
+ * The register mode moves the words right away in the calling context.
+ * The block mode is served by the SPI engine context, which moves the
+ * data between the FRAM and the DMA channels of the SPI sockets in
+ * slices. With spiTiming set, each slice takes its wire time at the
+ * configured clock with the CPU released, so the firmware threads run
+ * while the SPI shifts, as on the device.
+ *
+ * The FRAM decodes the commands used by the application. Its READ data
+ * is corrupted above the clock limits of the configuration, which lets
+ * the clock calibration of the firmware find its limit.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cyu3spi.h"
+#include "cyu3error.h"
+#include "simint.h"
+
+#define SIM_SPI_SLICE_SIZE              (4096)
+#define SIM_SPI_BLOCK_TIMEOUT           (10000)
+
+#define SIM_FRAM_WREN                   (0x06)
+#define SIM_FRAM_WRDI                   (0x04)
+#define SIM_FRAM_RDSR                   (0x05)
+#define SIM_FRAM_WRITE                  (0x02)
+#define SIM_FRAM_READ                   (0x03)
+#define SIM_FRAM_FAST_READ              (0x0B)
+#define SIM_FRAM_RDID                   (0x9F)
+
+/* SPI block state */
+static CyBool_t simSpiStarted = CyFalse;
+static uint32_t simSpiClock = 0;
+static CyBool_t simSsnLow = CyFalse;
+static uint32_t simTxRemain = 0;
+static uint32_t simRxRemain = 0;
+
+static CyU3PThread simSpiThread = {NULL, "sim:spi", NULL, 0, 0};
+
+/* FRAM state */
+static uint8_t  *simFramMem = NULL;
+static uint8_t  simFramAddrBytes;
+static uint8_t  simFramId[9];
+static CyBool_t simFramWel = CyFalse;
+static uint8_t  simFramCmd;
+static uint32_t simFramPhase;           /* Bytes received in the transaction */
+static uint32_t simFramAddr;
+static CyBool_t simFramFault;           /* The transaction is already reported */
+
+static void
+SimFramInit (
+        void)
+{
+    uint32_t size = simConfig.framSize;
+    uint8_t density = 0;
+
+    if (simFramMem != NULL)
+    {
+        return;
+    }
+    if (size == 0)
+    {
+        size = simConfig.framSize = 256 * 1024;
+    }
+
+    simFramMem = (uint8_t *)malloc (size);
+    memset (simFramMem, 0xFF, size);
+    simFramAddrBytes = (size <= 0x10000UL) ? 2 : (size <= 0x1000000UL) ? 3 : 4;
+
+    memset (simFramId, 0, sizeof (simFramId));
+    switch (simConfig.framVendor)
+    {
+        case FX3SIM_FRAM_CYPRESS:
+            while ((8192UL << density) < size)
+            {
+                density++;
+            }
+            memset (simFramId, 0x7F, 6);
+            simFramId[6] = 0xC2;
+            simFramId[7] = 0x20 | density;
+            simFramId[8] = 0x08;
+            break;
+        case FX3SIM_FRAM_FUJITSU:
+            while ((1024UL << density) < size)
+            {
+                density++;
+            }
+            simFramId[0] = 0x04;
+            simFramId[1] = 0x7F;
+            simFramId[2] = density;
+            simFramId[3] = 0x09;
+            break;
+        default:
+            break;
+    }
+}
+
+/* Report a protocol error once per transaction. */
+static void
+SimFramFault (
+        const char *message)
+{
+    if (!simFramFault)
+    {
+        SimError ("FRAM: %s (command 0x%02X)", message, simFramCmd);
+        simFramFault = CyTrue;
+    }
+}
+
+/* Shift one byte in and out of the FRAM. */
+static uint8_t
+SimFramShift (
+        uint8_t in)
+{
+    uint32_t limit;
+    uint32_t header;
+    uint8_t out = 0xFF;
+
+    if (!simSsnLow)
+    {
+        SimError ("SPI data shifted with SSN deasserted");
+        return out;
+    }
+
+    if (simFramPhase++ == 0)
+    {
+        simFramCmd = in;
+        simFramAddr = 0;
+        if (in == SIM_FRAM_WREN)
+        {
+            simFramWel = CyTrue;
+        }
+        else if (in == SIM_FRAM_WRDI)
+        {
+            simFramWel = CyFalse;
+        }
+        return out;
+    }
+
+    switch (simFramCmd)
+    {
+        case SIM_FRAM_RDSR:
+            out = (simFramWel) ? 0x02 : 0x00;
+            break;
+
+        case SIM_FRAM_RDID:
+            out = (simFramPhase - 2 < sizeof (simFramId)) ? simFramId[simFramPhase - 2] : 0;
+            break;
+
+        case SIM_FRAM_WRITE:
+        case SIM_FRAM_READ:
+        case SIM_FRAM_FAST_READ:
+            header = 1 + simFramAddrBytes + ((simFramCmd == SIM_FRAM_FAST_READ) ? 1 : 0);
+            if (simFramPhase <= 1 + simFramAddrBytes)
+            {
+                simFramAddr = (simFramAddr << 8) | in;
+                break;
+            }
+            if (simFramPhase <= header)
+            {
+                /* Dummy byte of FAST_READ */
+                break;
+            }
+
+            simFramAddr &= (simConfig.framSize - 1);
+            if (simFramCmd == SIM_FRAM_WRITE)
+            {
+                if (simFramWel)
+                {
+                    simFramMem[simFramAddr] = in;
+                }
+                else
+                {
+                    SimFramFault ("WRITE without WREN");
+                }
+            }
+            else
+            {
+                out = simFramMem[simFramAddr];
+                limit = (simFramCmd == SIM_FRAM_FAST_READ) ? simConfig.framMaxFastClock :
+                    simConfig.framMaxClock;
+                if ((limit != 0) && (simSpiClock > limit))
+                {
+                    out ^= 0x80;
+                }
+            }
+            simFramAddr++;
+            break;
+
+        case SIM_FRAM_WREN:
+        case SIM_FRAM_WRDI:
+            SimFramFault ("data after a single byte command");
+            break;
+
+        default:
+            SimFramFault ("unknown command");
+            break;
+    }
+    return out;
+}
+
+/* End the FRAM transaction when SSN is deasserted. */
+static void
+SimFramEnd (
+        void)
+{
+    if ((simFramCmd == SIM_FRAM_WRITE) && (simFramPhase > 1))
+    {
+        simFramWel = CyFalse;
+    }
+    simFramCmd   = 0;
+    simFramPhase = 0;
+    simFramFault = CyFalse;
+}
+
+/* SPI engine */
+
+/* Get the next slice of the block transfer. Returns the DMA channel
+ * and the data, or NULL when no data can be moved now. */
+static uint8_t *
+SimSpiSlice (
+        SimDmaChannel **ch_p,
+        uint32_t *count,
+        CyBool_t *isTx)
+{
+    SimDmaChannel *ch;
+    uint8_t *data = NULL;
+    CyBool_t isEop;
+
+    *count = 0;
+    if (simTxRemain > 0)
+    {
+        ch = SimDmaFindConsumer (CY_U3P_LPP_SOCKET_SPI_CONS);
+        if (ch != NULL)
+        {
+            data = SimDmaConsData (ch, count, &isEop);
+        }
+        if (*count > simTxRemain)
+        {
+            *count = simTxRemain;
+        }
+        *isTx = CyTrue;
+    }
+    else if (simRxRemain > 0)
+    {
+        ch = SimDmaFindProducer (CY_U3P_LPP_SOCKET_SPI_PROD);
+        if (ch != NULL)
+        {
+            data = SimDmaProdSpace (ch, count);
+        }
+        if (*count > simRxRemain)
+        {
+            *count = simRxRemain;
+        }
+        *isTx = CyFalse;
+    }
+    else
+    {
+        return NULL;
+    }
+
+    if ((data == NULL) || (*count == 0))
+    {
+        return NULL;
+    }
+    if (*count > SIM_SPI_SLICE_SIZE)
+    {
+        *count = SIM_SPI_SLICE_SIZE;
+    }
+    *ch_p = ch;
+    return data;
+}
+
+static void *
+SimSpiThreadEntry (
+        void *arg)
+{
+    SimDmaChannel *ch;
+    uint8_t *data;
+    uint32_t count, limit, i;
+    CyBool_t isTx;
+
+    (void) arg;
+
+    pthread_mutex_lock (&simLock);
+    SimSetContext (&simSpiThread);
+    for (;;)
+    {
+        data = SimSpiSlice (&ch, &count, &isTx);
+        if (data == NULL)
+        {
+            SimWait (NULL, CYU3P_WAIT_FOREVER);
+            continue;
+        }
+
+        if ((simConfig.spiTiming) && (simSpiClock != 0))
+        {
+            SimBusDelay ((uint64_t)count * 8 * 1000000000ULL / simSpiClock);
+
+            /* The transfer may be changed while the data is shifted. */
+            limit = count;
+            data  = SimSpiSlice (&ch, &count, &isTx);
+            if (data == NULL)
+            {
+                continue;
+            }
+            if (count > limit)
+            {
+                count = limit;
+            }
+        }
+
+        if (isTx)
+        {
+            for (i = 0; i < count; i++)
+            {
+                SimFramShift (data[i]);
+            }
+            simTxRemain -= count;
+            SimDmaConsume (ch, count);
+        }
+        else
+        {
+            for (i = 0; i < count; i++)
+            {
+                data[i] = SimFramShift (0);
+            }
+            simRxRemain -= count;
+            SimDmaProduce (ch, count, CyFalse);
+        }
+        SimSignal ();
+    }
+    return NULL;
+}
+
+void
+SimSpiStart (
+        void)
+{
+    SimFramInit ();
+    SimThreadStart (SimSpiThreadEntry, NULL);
+}
+
+/* SPI driver API */
+
+CyU3PReturnStatus_t
+CyU3PSpiInit (
+        void)
+{
+    if (simSpiStarted)
+    {
+        return CY_U3P_ERROR_ALREADY_STARTED;
+    }
+    simSpiStarted = CyTrue;
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PSpiDeInit (
+        void)
+{
+    if (!simSpiStarted)
+    {
+        return CY_U3P_ERROR_NOT_STARTED;
+    }
+    simSpiStarted = CyFalse;
+    simSpiClock   = 0;
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PSpiSetConfig (
+        CyU3PSpiConfig_t *config,
+        CyU3PSpiIntrCb_t cb)
+{
+    (void) cb;
+
+    if (!simSpiStarted)
+    {
+        return CY_U3P_ERROR_NOT_STARTED;
+    }
+    if (config == NULL)
+    {
+        return CY_U3P_ERROR_NULL_POINTER;
+    }
+    if ((config->clock < CY_U3P_SPI_MIN_CLOCK) || (config->clock > CY_U3P_SPI_MAX_CLOCK) ||
+            (config->wordLen != 8))
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+    if ((simTxRemain != 0) || (simRxRemain != 0))
+    {
+        SimError ("SPI configured during a block transfer");
+        return CY_U3P_ERROR_INVALID_SEQUENCE;
+    }
+
+    simSpiClock = config->clock;
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PSpiSetSsnLine (
+        CyBool_t isHigh)
+{
+    if (!simSpiStarted)
+    {
+        return CY_U3P_ERROR_NOT_STARTED;
+    }
+
+    if ((isHigh) && (simSsnLow))
+    {
+        SimFramEnd ();
+    }
+    else if ((!isHigh) && (!simSsnLow))
+    {
+        simFramPhase = 0;
+        simFramFault = CyFalse;
+    }
+    simSsnLow = !isHigh;
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PSpiTransmitWords (
+        uint8_t *data,
+        uint32_t byteCount)
+{
+    uint32_t i;
+
+    if (simSpiClock == 0)
+    {
+        return CY_U3P_ERROR_NOT_CONFIGURED;
+    }
+    if ((simTxRemain != 0) || (simRxRemain != 0))
+    {
+        SimError ("SPI register transfer during a block transfer");
+        return CY_U3P_ERROR_INVALID_SEQUENCE;
+    }
+
+    for (i = 0; i < byteCount; i++)
+    {
+        SimFramShift (data[i]);
+    }
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PSpiReceiveWords (
+        uint8_t *data,
+        uint32_t byteCount)
+{
+    uint32_t i;
+
+    if (simSpiClock == 0)
+    {
+        return CY_U3P_ERROR_NOT_CONFIGURED;
+    }
+    if ((simTxRemain != 0) || (simRxRemain != 0))
+    {
+        SimError ("SPI register transfer during a block transfer");
+        return CY_U3P_ERROR_INVALID_SEQUENCE;
+    }
+
+    for (i = 0; i < byteCount; i++)
+    {
+        data[i] = SimFramShift (0);
+    }
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PSpiSetBlockXfer (
+        uint32_t txSize,
+        uint32_t rxSize)
+{
+    if (simSpiClock == 0)
+    {
+        return CY_U3P_ERROR_NOT_CONFIGURED;
+    }
+    if ((txSize != 0) && (rxSize != 0))
+    {
+        return CY_U3P_ERROR_NOT_SUPPORTED;
+    }
+    if ((simTxRemain != 0) || (simRxRemain != 0))
+    {
+        SimError ("SPI block transfer started during a block transfer");
+    }
+
+    simTxRemain = txSize;
+    simRxRemain = rxSize;
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PSpiWaitForBlockXfer (
+        CyBool_t isRead)
+{
+    struct timespec deadline;
+
+    SimDeadline (&deadline, SIM_SPI_BLOCK_TIMEOUT);
+    while (((isRead) ? simRxRemain : simTxRemain) != 0)
+    {
+        if (!SimWait (&deadline, SIM_SPI_BLOCK_TIMEOUT))
+        {
+            return CY_U3P_ERROR_TIMEOUT;
+        }
+    }
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PSpiDisableBlockXfer (
+        CyBool_t rxDisable,
+        CyBool_t txDisable)
+{
+    if (rxDisable)
+    {
+        simRxRemain = 0;
+    }
+    if (txDisable)
+    {
+        simTxRemain = 0;
+    }
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+/* Host access to the FRAM */
+
+void
+FX3SimFramRead (
+        uint32_t address,
+        uint8_t *data,
+        uint32_t length)
+{
+    uint32_t i;
+
+    SimEnter ();
+    SimFramInit ();
+    for (i = 0; i < length; i++)
+    {
+        data[i] = simFramMem[(address + i) & (simConfig.framSize - 1)];
+    }
+    SimLeave ();
+}
+
+void
+FX3SimFramWrite (
+        uint32_t address,
+        const uint8_t *data,
+        uint32_t length)
+{
+    uint32_t i;
+
+    SimEnter ();
+    SimFramInit ();
+    for (i = 0; i < length; i++)
+    {
+        simFramMem[(address + i) & (simConfig.framSize - 1)] = data[i];
+    }
+    SimLeave ();
+}
@@ -0,0 +1,876 @@
+/*
+ * Regression tests of the bulkloop application on the simulated FX3
+ *
+ * Each test boots the firmware in a child process, enumerates it and
+ * drives the vendor requests through the USB model like the host
+ * application. The FRAM content is checked through the USB and directly
+ * in the FRAM model. A test fails on a wrong result, a protocol error
+ * detected by the simulation, or when it does not finish in
+ * TEST_TIMEOUT seconds.
+ *
+ *      simtest             run all tests
+ *      simtest name...     run the named tests
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "fx3sim.h"
+#include "cyfxbulklpmaninout.h"
+
+#define TEST_TIMEOUT            (60)    /* Time limit of a test in seconds */
+#define TEST_XFER_TIMEOUT       (5000)  /* Time limit of a transfer in ms */
+#define TEST_POLL_TIMEOUT       (5000)  /* Time limit to wait for a queued request in ms */
+
+#define TEST_RQT_OUT            (0x40)
+#define TEST_RQT_IN             (0xC0)
+
+#define TEST_CHECK(cond)        do { if (!(cond)) TestFail (__FILE__, __LINE__, #cond); } while (0)
+
+typedef struct TestCase_t
+{
+    const char  *name;
+    void        (*run) (void);
+} TestCase_t;
+
+static uint16_t glTestPacketSize;       /* Packet size of the bulk endpoints */
+static uint8_t  glTestDmaMode;          /* DMA mode selected by the test */
+static uint32_t glTestSeed = 1;         /* State of the data generator */
+
+static void
+TestFail (
+    const char  *file,
+    int         line,
+    const char  *expr
+) {
+    fprintf (stderr, "%s:%d: check failed: %s\n", file, line, expr);
+    exit (1);
+}
+
+/* Fill a buffer with pseudo random data. */
+static void
+TestFill (
+    uint8_t     *data,
+    uint32_t    length
+) {
+    while (length-- > 0) {
+        glTestSeed = glTestSeed * 1103515245 + 12345;
+        *data++ = (uint8_t)(glTestSeed >> 16);
+    }
+}
+
+/* Fill a buffer with the test pattern of the firmware, same as 1000.txt. */
+static void
+TestPattern (
+    uint8_t     *data,
+    uint32_t    offset,
+    uint32_t    length
+) {
+    static const char hex[] = "0123456789ABCDEF";
+    uint32_t column;
+    uint32_t line;
+
+    for (; length > 0; length--, offset++) {
+        column = offset % CY_FX_PATTERN_LINE_SIZE;
+        line   = offset - column;
+        if (column == 0) {
+            *data++ = ' ';
+        } else if (column <= 4) {
+            *data++ = hex[(line >> (4 * (4 - column))) & 0x0F];
+        } else if (column == 5) {
+            *data++ = ' ';
+        } else if (column == CY_FX_PATTERN_LINE_SIZE - 2) {
+            *data++ = '\r';
+        } else if (column == CY_FX_PATTERN_LINE_SIZE - 1) {
+            *data++ = '\n';
+        } else {
+            *data++ = '0' + ((column + 1) % 10);
+        }
+    }
+}
+
+/* CRC32 of zlib, computed bit by bit. */
+static uint32_t
+TestCrc32 (
+    const uint8_t   *data,
+    uint32_t        length
+) {
+    uint32_t crc = 0xFFFFFFFF;
+    int i;
+
+    while (length-- > 0) {
+        crc ^= *data++;
+        for (i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? CY_FX_CRC32_POLY : 0);
+        }
+    }
+    return ~crc;
+}
+
+static void
+TestVendorOut (
+    uint8_t     request,
+    uint16_t    wValue,
+    uint16_t    wIndex,
+    void        *data,
+    uint16_t    length
+) {
+    TEST_CHECK (FX3SimControl (TEST_RQT_OUT, request, wValue, wIndex, data, length,
+                TEST_XFER_TIMEOUT) == length);
+}
+
+static void
+TestVendorIn (
+    uint8_t     request,
+    uint16_t    wValue,
+    uint16_t    wIndex,
+    void        *data,
+    uint16_t    length
+) {
+    TEST_CHECK (FX3SimControl (TEST_RQT_IN, request, wValue, wIndex, data, length,
+                TEST_XFER_TIMEOUT) == length);
+}
+
+/* Send the data of a WRITE request. In the CPU DMA modes the end of a
+ * transfer of a multiple of the packet size is marked by a ZLP when
+ * isEnd is set. The direct mode takes the exact length. */
+static void
+TestBulkWrite (
+    const uint8_t   *data,
+    uint32_t        length,
+    CyBool_t        isEnd
+) {
+    uint32_t transferred = 0;
+
+    TEST_CHECK (FX3SimBulkOut (CY_FX_EP_PRODUCER, data, length, &transferred,
+                TEST_XFER_TIMEOUT) == FX3SIM_SUCCESS);
+    TEST_CHECK (transferred == length);
+    if ((isEnd) && (glTestDmaMode != CY_FX_DMA_MODE_DIRECT) &&
+            ((length % glTestPacketSize) == 0)) {
+        TEST_CHECK (FX3SimBulkOut (CY_FX_EP_PRODUCER, NULL, 0, &transferred,
+                    TEST_XFER_TIMEOUT) == FX3SIM_SUCCESS);
+    }
+}
+
+/* Receive the data of a READ request, and the ZLP which follows a
+ * multiple of the packet size in the CPU DMA modes. */
+static void
+TestBulkRead (
+    uint8_t     *data,
+    uint32_t    length
+) {
+    uint32_t transferred = 0;
+
+    TEST_CHECK (FX3SimBulkIn (CY_FX_EP_CONSUMER, data, length, &transferred,
+                TEST_XFER_TIMEOUT) == FX3SIM_SUCCESS);
+    TEST_CHECK (transferred == length);
+    if ((glTestDmaMode != CY_FX_DMA_MODE_DIRECT) && ((length % glTestPacketSize) == 0)) {
+        TEST_CHECK (FX3SimBulkIn (CY_FX_EP_CONSUMER, data, glTestPacketSize, &transferred,
+                    TEST_XFER_TIMEOUT) == FX3SIM_SUCCESS);
+        TEST_CHECK (transferred == 0);
+    }
+}
+
+/* Boot the firmware and enumerate it at the given speed. */
+static void
+TestBoot (
+    const FX3SimConfig_t    *config,
+    CyU3PUSBSpeed_t         speed
+) {
+    FX3SimConfig_t defaultConfig;
+    uint8_t burstLen;
+    uint8_t maxBurst;
+
+    if (config == NULL) {
+        FX3SimDefaultConfig (&defaultConfig);
+        config = &defaultConfig;
+    }
+    TEST_CHECK (FX3SimStart (config) == FX3SIM_SUCCESS);
+    TEST_CHECK (FX3SimEnumerate (speed) == FX3SIM_SUCCESS);
+    TEST_CHECK (FX3SimEndpointInfo (CY_FX_EP_PRODUCER, &glTestPacketSize,
+                &burstLen, &maxBurst) == FX3SIM_SUCCESS);
+    glTestDmaMode = CY_FX_DMA_MODE_CPU;
+}
+
+/* Select a DMA mode and wait until the queued request is served. */
+static void
+TestSetDmaMode (
+    uint8_t     mode
+) {
+    CyFxBulkLpLoopStats_t stats;
+    uint32_t start = FX3SimGetTime ();
+
+    TestVendorOut (CY_FX_RQT_SET_DMA_MODE, mode, 0, NULL, 0);
+    do {
+        usleep (1000);
+        TestVendorIn (CY_FX_RQT_GET_LOOP_STATS, 0, 0, &stats, sizeof (stats));
+        TEST_CHECK (FX3SimGetTime () - start < TEST_POLL_TIMEOUT);
+    } while (stats.mode != mode);
+    glTestDmaMode = mode;
+}
+
+static void
+TestGetGeometry (
+    CyFxBulkLpFramGeometry_t    *geometry
+) {
+    TestVendorIn (CY_FX_RQT_GET_GEOMETRY, 0, 0, geometry, sizeof (*geometry));
+}
+
+/* Write a sector with random data and read it back. */
+static void
+TestSectorRoundTrip (
+    uint16_t    sector,
+    uint32_t    length
+) {
+    static uint8_t data[CY_FX_BULKLP_DMA_BUF_SIZE];
+    static uint8_t readBack[CY_FX_BULKLP_DMA_BUF_SIZE];
+    static uint8_t fram[CY_FX_BULKLP_DMA_BUF_SIZE];
+
+    TestFill (data, length);
+    TestVendorOut (CY_FX_RQT_FRAM_WRITE, length, sector, NULL, 0);
+    TestBulkWrite (data, length, (length < CY_FX_BULKLP_DMA_BUF_SIZE));
+
+    memset (readBack, 0, length);
+    TestVendorOut (CY_FX_RQT_FRAM_READ, length, sector, NULL, 0);
+    TestBulkRead (readBack, length);
+    TEST_CHECK (memcmp (data, readBack, length) == 0);
+
+    FX3SimFramRead (CY_FX_SECTOR_SIZE * sector, fram, length);
+    TEST_CHECK (memcmp (data, fram, length) == 0);
+}
+
+/* Queue a READ, a request which re-creates the channels and a WRITE
+ * without waiting for the requests. The data of the READ is not flushed,
+ * the WRITE is stalled until the channels are re-created, and a request
+ * without BULK data queued meanwhile is served. The READ sector is written
+ * to the FRAM model directly, so it must not be in the sector cache. */
+static void
+TestReconfig (
+    uint8_t     request,
+    uint16_t    wValue,
+    uint8_t     mode
+) {
+    static uint8_t data[CY_FX_BULKLP_DMA_BUF_SIZE];
+    static uint8_t readBack[CY_FX_BULKLP_DMA_BUF_SIZE];
+    static uint8_t fram[CY_FX_BULKLP_DMA_BUF_SIZE];
+    CyFxBulkLpCrcResult_t result;
+    uint32_t start;
+    int status;
+
+    TestFill (data, sizeof (data));
+    FX3SimFramWrite (CY_FX_SECTOR_SIZE * 4, data, sizeof (data));
+
+    TestVendorOut (CY_FX_RQT_FRAM_READ, sizeof (data), 4, NULL, 0);
+    TestVendorOut (request, wValue, 0, NULL, 0);
+    TestVendorOut (CY_FX_RQT_FRAM_CRC, 0, 4, NULL, 0);
+
+    /* The channels are not re-created before the READ data is taken. */
+    TEST_CHECK (FX3SimControl (TEST_RQT_OUT, CY_FX_RQT_FRAM_WRITE, sizeof (data), 5, NULL, 0,
+                TEST_XFER_TIMEOUT) == FX3SIM_ERROR_PIPE);
+    TestBulkRead (readBack, sizeof (readBack));
+    TEST_CHECK (memcmp (data, readBack, sizeof (data)) == 0);
+    glTestDmaMode = mode;
+
+    TestFill (data, sizeof (data));
+    start = FX3SimGetTime ();
+    do {
+        status = FX3SimControl (TEST_RQT_OUT, CY_FX_RQT_FRAM_WRITE, sizeof (data), 5, NULL, 0,
+                TEST_XFER_TIMEOUT);
+        TEST_CHECK ((status == 0) || (status == FX3SIM_ERROR_PIPE));
+        TEST_CHECK (FX3SimGetTime () - start < TEST_POLL_TIMEOUT);
+    } while (status != 0);
+    TestBulkWrite (data, sizeof (data), CyFalse);
+
+    TestVendorOut (CY_FX_RQT_FRAM_READ, sizeof (data), 5, NULL, 0);
+    TestBulkRead (readBack, sizeof (readBack));
+    TEST_CHECK (memcmp (data, readBack, sizeof (data)) == 0);
+    FX3SimFramRead (CY_FX_SECTOR_SIZE * 5, fram, sizeof (fram));
+    TEST_CHECK (memcmp (data, fram, sizeof (data)) == 0);
+
+    TestVendorIn (CY_FX_RQT_FRAM_CRC, 0, 0, &result, sizeof (result));
+    TEST_CHECK (result.ready);
+    TEST_CHECK (result.byteAddress == CY_FX_SECTOR_SIZE * 4);
+}
+
+static void
+TestBootDefault (
+    void
+) {
+    CyFxBulkLpFramGeometry_t geometry;
+    CyFxBulkLpSpiClock_t clock;
+    CyFxBulkLpAppStats_t stats;
+    uint16_t pcktSize;
+    uint8_t burstLen;
+    uint8_t maxBurst;
+
+    TestBoot (NULL, CY_U3P_SUPER_SPEED);
+
+    TestGetGeometry (&geometry);
+    TEST_CHECK (geometry.capacity == 256 * 1024);
+    TEST_CHECK (geometry.sectorSize == CY_FX_SECTOR_SIZE);
+    TEST_CHECK (geometry.nSectors == (256 * 1024 - CY_FX_FRAM_SCRATCH_SIZE) / CY_FX_SECTOR_SIZE);
+    TEST_CHECK (geometry.addressBytes == 3);
+    TEST_CHECK (geometry.identified == 1);
+
+    TestVendorIn (CY_FX_RQT_SPI_CLOCK, 0, 0, &clock, sizeof (clock));
+    TEST_CHECK (clock.calibrated == 1);
+    TEST_CHECK (clock.clock == CY_FX_SPI_CLOCK_MAX);
+
+    TEST_CHECK (FX3SimEndpointInfo (CY_FX_EP_CONSUMER, &pcktSize, &burstLen, &maxBurst) == 0);
+    TEST_CHECK (pcktSize == 1024);
+    TEST_CHECK (burstLen == CY_FX_EP_BURST_LENGTH);
+    TEST_CHECK (maxBurst == CY_FX_EP_BURST_MAX);
+
+    /* The simulated threads run on the host stacks, so the firmware
+     * stacks keep their fill. */
+    TestVendorIn (CY_FX_RQT_GET_STATS, 0, 0, &stats, sizeof (stats));
+    TEST_CHECK (stats.appStackUsed == 0);
+    TEST_CHECK (stats.spiStackUsed == 0);
+}
+
+static void
+TestClockLimit (
+    void
+) {
+    FX3SimConfig_t config;
+    CyFxBulkLpSpiClock_t clock;
+    uint32_t start;
+
+    FX3SimDefaultConfig (&config);
+    config.framMaxClock     = 20000000;
+    config.framMaxFastClock = 24000000;
+    TestBoot (&config, CY_U3P_SUPER_SPEED);
+
+    TestVendorIn (CY_FX_RQT_SPI_CLOCK, 0, 0, &clock, sizeof (clock));
+    TEST_CHECK (clock.calibrated == 1);
+    TEST_CHECK (clock.clock <= ((clock.fastRead) ? config.framMaxFastClock : config.framMaxClock));
+    TEST_CHECK (clock.clock >= 20000000);
+
+    TestSectorRoundTrip (1, CY_FX_BULKLP_DMA_BUF_SIZE);
+
+    /* The clock is set in the range of the calibration only. */
+    TEST_CHECK (FX3SimControl (TEST_RQT_OUT, CY_FX_RQT_SPI_CLOCK, CY_FX_SPI_CLOCK_MIN / 1000 - 1, 0,
+                NULL, 0, TEST_XFER_TIMEOUT) == FX3SIM_ERROR_PIPE);
+    TEST_CHECK (FX3SimControl (TEST_RQT_OUT, CY_FX_RQT_SPI_CLOCK, CY_FX_SPI_CLOCK_MAX / 1000 + 1, 0,
+                NULL, 0, TEST_XFER_TIMEOUT) == FX3SIM_ERROR_PIPE);
+
+    TestVendorOut (CY_FX_RQT_SPI_CLOCK, 16000, 0, NULL, 0);
+    start = FX3SimGetTime ();
+    do {
+        usleep (1000);
+        TestVendorIn (CY_FX_RQT_SPI_CLOCK, 0, 0, &clock, sizeof (clock));
+        TEST_CHECK (FX3SimGetTime () - start < TEST_POLL_TIMEOUT);
+    } while (clock.clock != 16000000);
+    TEST_CHECK ((clock.fastRead == 0) && (clock.calibrated == 0));
+    TestSectorRoundTrip (2, CY_FX_BULKLP_DMA_BUF_SIZE);
+}
+
+static void
+TestSector (
+    void
+) {
+    TestBoot (NULL, CY_U3P_SUPER_SPEED);
+    TestSectorRoundTrip (3, CY_FX_BULKLP_DMA_BUF_SIZE);
+    TestSectorRoundTrip (4, 777);
+    TestSectorRoundTrip (5, 3 * 1024 + 1);
+}
+
+static void
+TestSectorLimits (
+    void
+) {
+    CyFxBulkLpFramGeometry_t geometry;
+
+    TestBoot (NULL, CY_U3P_SUPER_SPEED);
+    TestGetGeometry (&geometry);
+
+    /* The length of a sector READ is at most the sector data size. */
+    TEST_CHECK (FX3SimControl (TEST_RQT_OUT, CY_FX_RQT_FRAM_READ, CY_FX_BULKLP_DMA_BUF_SIZE + 1, 0,
+                NULL, 0, TEST_XFER_TIMEOUT) == FX3SIM_ERROR_PIPE);
+    TEST_CHECK (FX3SimControl (TEST_RQT_OUT, CY_FX_RQT_FRAM_READ, 0xFFFF, 0,
+                NULL, 0, TEST_XFER_TIMEOUT) == FX3SIM_ERROR_PIPE);
+    TEST_CHECK (FX3SimControl (TEST_RQT_OUT, CY_FX_RQT_FRAM_WRITE, CY_FX_BULKLP_DMA_BUF_SIZE + 1, 0,
+                NULL, 0, TEST_XFER_TIMEOUT) == FX3SIM_ERROR_PIPE);
+    TEST_CHECK (FX3SimControl (TEST_RQT_OUT, CY_FX_RQT_FRAM_READ, 100, geometry.nSectors,
+                NULL, 0, TEST_XFER_TIMEOUT) == FX3SIM_ERROR_PIPE);
+
+    /* The device still serves the valid requests. */
+    TestSectorRoundTrip (geometry.nSectors - 1, CY_FX_BULKLP_DMA_BUF_SIZE);
+}
+
+static void
+TestMulti (
+    void
+) {
+    static uint8_t data[3 * CY_FX_BULKLP_DMA_BUF_SIZE];
+    static uint8_t readBack[3 * CY_FX_BULKLP_DMA_BUF_SIZE];
+
+    TestBoot (NULL, CY_U3P_SUPER_SPEED);
+
+    TestFill (data, sizeof (data));
+    TestVendorOut (CY_FX_RQT_FRAM_WRITE_MULTI, 3, 6, NULL, 0);
+    TestBulkWrite (data, sizeof (data), CyFalse);
+
+    TestVendorOut (CY_FX_RQT_FRAM_READ_MULTI, 3, 6, NULL, 0);
+    TestBulkRead (readBack, sizeof (readBack));
+    TEST_CHECK (memcmp (data, readBack, sizeof (data)) == 0);
+}
+
+/* Write a byte range with random data and read it back. */
+static void
+TestBytesRoundTrip (
+    uint32_t    byteAddress,
+    uint32_t    byteCount
+) {
+    static uint8_t data[3 * CY_FX_BULKLP_DMA_CHUNK_SIZE];
+    static uint8_t readBack[3 * CY_FX_BULKLP_DMA_CHUNK_SIZE];
+    CyFxBulkLpByteRange_t range;
+
+    range.byteAddress = byteAddress;
+    range.byteCount   = byteCount;
+    TestFill (data, byteCount);
+    TestVendorOut (CY_FX_RQT_FRAM_WRITE_BYTES, 0, 0, &range, sizeof (range));
+    TestBulkWrite (data, byteCount, CyTrue);
+
+    memset (readBack, 0, byteCount);
+    TestVendorOut (CY_FX_RQT_FRAM_READ_BYTES, 0, 0, &range, sizeof (range));
+    TestBulkRead (readBack, byteCount);
+    TEST_CHECK (memcmp (data, readBack, byteCount) == 0);
+
+    FX3SimFramRead (byteAddress, readBack, byteCount);
+    TEST_CHECK (memcmp (data, readBack, byteCount) == 0);
+}
+
+static void
+TestBytes (
+    void
+) {
+    CyFxBulkLpByteRange_t range;
+
+    TestBoot (NULL, CY_U3P_SUPER_SPEED);
+
+    /* The range crosses the boundary of sectors 0 and 1. */
+    TestBytesRoundTrip (CY_FX_SECTOR_SIZE - 1001, 5000);
+
+    /* Multiples of the packet size end with a ZLP, also when the last
+     * chunk is full. */
+    TestBytesRoundTrip (1000, 2 * glTestPacketSize);
+    TestBytesRoundTrip (2000, CY_FX_BULKLP_DMA_CHUNK_SIZE);
+    TestBytesRoundTrip (3000, 2 * CY_FX_BULKLP_DMA_CHUNK_SIZE + glTestPacketSize);
+    TestBytesRoundTrip (4000, 17);
+
+    /* The same in the direct mode, where no ZLP is sent. */
+    TestSetDmaMode (CY_FX_DMA_MODE_DIRECT);
+    TestBytesRoundTrip (5000, 2 * glTestPacketSize);
+    TestBytesRoundTrip (6000, 333);
+
+    /* The scratch area is not part of the ranges. */
+    range.byteAddress = 256 * 1024 - CY_FX_FRAM_SCRATCH_SIZE;
+    range.byteCount   = 1;
+    TEST_CHECK (FX3SimControl (TEST_RQT_OUT, CY_FX_RQT_FRAM_READ_BYTES, 0, 0,
+                (uint8_t *)&range, sizeof (range), TEST_XFER_TIMEOUT) == FX3SIM_ERROR_PIPE);
+}
+
+static void
+TestBytesCallback (
+    void
+) {
+    TestBoot (NULL, CY_U3P_SUPER_SPEED);
+    TestSetDmaMode (CY_FX_DMA_MODE_CALLBACK);
+    TestBytesRoundTrip (1000, 2 * glTestPacketSize);
+    TestBytesRoundTrip (2000, CY_FX_BULKLP_DMA_CHUNK_SIZE);
+    TestBytesRoundTrip (3000, 999);
+}
+
+static void
+TestEp0 (
+    void
+) {
+    static uint8_t sector[CY_FX_BULKLP_DMA_BUF_SIZE];
+    uint8_t data[CY_FX_EP0_FRAM_MAX_SIZE];
+    uint8_t readBack[CY_FX_EP0_FRAM_MAX_SIZE];
+    uint8_t fram[CY_FX_EP0_FRAM_MAX_SIZE];
+    uint32_t start;
+    int status;
+
+    TestBoot (NULL, CY_U3P_SUPER_SPEED);
+
+    TestFill (data, sizeof (data));
+    TestVendorOut (CY_FX_RQT_FRAM_EP0, 0x2345, 0x0001, data, sizeof (data));
+    TestVendorIn (CY_FX_RQT_FRAM_EP0, 0x2345, 0x0001, readBack, sizeof (readBack));
+    TEST_CHECK (memcmp (data, readBack, sizeof (data)) == 0);
+
+    FX3SimFramRead (0x12345, fram, sizeof (fram));
+    TEST_CHECK (memcmp (data, fram, sizeof (data)) == 0);
+
+    /* Records larger than the EP0 buffer are stalled. */
+    TEST_CHECK (FX3SimControl (TEST_RQT_IN, CY_FX_RQT_FRAM_EP0, 0, 0, readBack,
+                CY_FX_EP0_FRAM_MAX_SIZE + 1, TEST_XFER_TIMEOUT) == FX3SIM_ERROR_PIPE);
+
+    /* A record is stalled while a WRITE queued before waits for its data,
+     * and is read after the WRITE. */
+    TestFill (sector, sizeof (sector));
+    TestVendorOut (CY_FX_RQT_FRAM_WRITE, sizeof (sector), 1, NULL, 0);
+    TEST_CHECK (FX3SimControl (TEST_RQT_OUT, CY_FX_RQT_FRAM_EP0, CY_FX_SECTOR_SIZE & 0xFFFF,
+                CY_FX_SECTOR_SIZE >> 16, data, sizeof (data), TEST_XFER_TIMEOUT) == FX3SIM_ERROR_PIPE);
+    TEST_CHECK (FX3SimControl (TEST_RQT_IN, CY_FX_RQT_FRAM_EP0, CY_FX_SECTOR_SIZE & 0xFFFF,
+                CY_FX_SECTOR_SIZE >> 16, readBack, sizeof (readBack), TEST_XFER_TIMEOUT) == FX3SIM_ERROR_PIPE);
+    TestBulkWrite (sector, sizeof (sector), CyFalse);
+
+    start = FX3SimGetTime ();
+    do {
+        status = FX3SimControl (TEST_RQT_IN, CY_FX_RQT_FRAM_EP0, CY_FX_SECTOR_SIZE & 0xFFFF,
+                CY_FX_SECTOR_SIZE >> 16, readBack, sizeof (readBack), TEST_XFER_TIMEOUT);
+        TEST_CHECK ((status == sizeof (readBack)) || (status == FX3SIM_ERROR_PIPE));
+        TEST_CHECK (FX3SimGetTime () - start < TEST_POLL_TIMEOUT);
+    } while (status != sizeof (readBack));
+    TEST_CHECK (memcmp (sector, readBack, sizeof (readBack)) == 0);
+}
+
+static void
+TestCrc (
+    void
+) {
+    static uint8_t data[CY_FX_BULKLP_DMA_BUF_SIZE];
+    CyFxBulkLpCrcResult_t result;
+    uint32_t start;
+
+    TestBoot (NULL, CY_U3P_SUPER_SPEED);
+
+    TestFill (data, sizeof (data));
+    FX3SimFramWrite (CY_FX_SECTOR_SIZE * 2, data, sizeof (data));
+
+    TestVendorOut (CY_FX_RQT_FRAM_CRC, 0, 2, NULL, 0);
+    start = FX3SimGetTime ();
+    do {
+        usleep (1000);
+        TestVendorIn (CY_FX_RQT_FRAM_CRC, 0, 0, &result, sizeof (result));
+        TEST_CHECK (FX3SimGetTime () - start < TEST_POLL_TIMEOUT);
+    } while (!result.ready);
+
+    TEST_CHECK (result.byteAddress == CY_FX_SECTOR_SIZE * 2);
+    TEST_CHECK (result.byteCount == sizeof (data));
+    TEST_CHECK (result.crc == TestCrc32 (data, sizeof (data)));
+}
+
+static void
+TestVerify (
+    void
+) {
+    static uint8_t data[CY_FX_BULKLP_DMA_BUF_SIZE];
+    static uint8_t readBack[CY_FX_BULKLP_DMA_BUF_SIZE];
+    CyFxBulkLpCrcResult_t result;
+
+    TestBoot (NULL, CY_U3P_SUPER_SPEED);
+
+    TestVendorOut (CY_FX_RQT_SET_VERIFY, 1, 0, NULL, 0);
+    TestSectorRoundTrip (0, CY_FX_BULKLP_DMA_BUF_SIZE);
+    TestSectorRoundTrip (1, 100);
+
+    TestVendorIn (CY_FX_RQT_FRAM_CRC, 0, 0, &result, sizeof (result));
+    TEST_CHECK (result.verifyCount == 2);
+    TEST_CHECK (result.verifyErrors == 0);
+
+    /* A WRITE queued before SET_VERIFY keeps the previous setting, also
+     * when its data is sent after SET_VERIFY. */
+    TestFill (data, sizeof (data));
+    TestVendorOut (CY_FX_RQT_SET_VERIFY, 0, 0, NULL, 0);
+    TestVendorOut (CY_FX_RQT_FRAM_WRITE, sizeof (data), 2, NULL, 0);
+    TestVendorOut (CY_FX_RQT_SET_VERIFY, 1, 0, NULL, 0);
+    TestBulkWrite (data, sizeof (data), CyFalse);
+    TestSectorRoundTrip (3, CY_FX_BULKLP_DMA_BUF_SIZE);
+
+    TestVendorIn (CY_FX_RQT_FRAM_CRC, 0, 0, &result, sizeof (result));
+    TEST_CHECK (result.verifyCount == 3);
+    TEST_CHECK (result.verifyErrors == 0);
+    FX3SimFramRead (CY_FX_SECTOR_SIZE * 2, readBack, sizeof (readBack));
+    TEST_CHECK (memcmp (data, readBack, sizeof (data)) == 0);
+}
+
+static void
+TestDirect (
+    void
+) {
+    TestBoot (NULL, CY_U3P_SUPER_SPEED);
+    TestSetDmaMode (CY_FX_DMA_MODE_DIRECT);
+    TestSectorRoundTrip (2, CY_FX_BULKLP_DMA_BUF_SIZE);
+    TestSectorRoundTrip (3, 4096);
+
+    /* The size of a WRITE is taken from wValue in the direct mode. */
+    TEST_CHECK (FX3SimControl (TEST_RQT_OUT, CY_FX_RQT_FRAM_WRITE, 0, 2, NULL, 0,
+                TEST_XFER_TIMEOUT) == FX3SIM_ERROR_PIPE);
+    TestSectorRoundTrip (2, 100);
+    TestSetDmaMode (CY_FX_DMA_MODE_CPU);
+    TestSectorRoundTrip (2, CY_FX_BULKLP_DMA_BUF_SIZE);
+
+    /* The mode is changed by the thread after the requests before it. */
+    TestReconfig (CY_FX_RQT_SET_DMA_MODE, CY_FX_DMA_MODE_DIRECT, CY_FX_DMA_MODE_DIRECT);
+    TestReconfig (CY_FX_RQT_SET_DMA_MODE, CY_FX_DMA_MODE_CALLBACK, CY_FX_DMA_MODE_CALLBACK);
+    TestSectorRoundTrip (3, 4096);
+}
+
+static void
+TestCallback (
+    void
+) {
+    CyFxBulkLpCrcResult_t result;
+
+    TestBoot (NULL, CY_U3P_SUPER_SPEED);
+    TestSetDmaMode (CY_FX_DMA_MODE_CALLBACK);
+    TestSectorRoundTrip (7, CY_FX_BULKLP_DMA_BUF_SIZE);
+    TestSectorRoundTrip (8, 1500);
+    TestSectorRoundTrip (9, CY_FX_BULKLP_DMA_BUF_SIZE);
+
+    /* The CRC of the chunks is computed by the thread. */
+    TestVendorOut (CY_FX_RQT_SET_VERIFY, 1, 0, NULL, 0);
+    TestSectorRoundTrip (7, CY_FX_BULKLP_DMA_BUF_SIZE);
+    TestSectorRoundTrip (8, 3 * glTestPacketSize);
+    TestVendorIn (CY_FX_RQT_FRAM_CRC, 0, 0, &result, sizeof (result));
+    TEST_CHECK (result.verifyCount == 2);
+    TEST_CHECK (result.verifyErrors == 0);
+}
+
+static void
+TestLoop (
+    void
+) {
+    static uint8_t data[3 * CY_FX_BULKLP_DMA_CHUNK_SIZE];
+    static uint8_t readBack[3 * CY_FX_BULKLP_DMA_CHUNK_SIZE];
+    uint32_t lengths[] = { 5000, CY_FX_BULKLP_DMA_CHUNK_SIZE + 100, 1 };
+    uint32_t transferred;
+    uint32_t total;
+    uint8_t mode;
+    int i;
+
+    TestBoot (NULL, CY_U3P_SUPER_SPEED);
+
+    for (mode = CY_FX_DMA_MODE_LOOP_COPY; mode <= CY_FX_DMA_MODE_LOOP_AUTO; mode++) {
+        TestSetDmaMode (mode);
+        for (i = 0; i < (int)(sizeof (lengths) / sizeof (lengths[0])); i++) {
+            TestFill (data, lengths[i]);
+            TEST_CHECK (FX3SimBulkOut (CY_FX_EP_PRODUCER, data, lengths[i], &transferred,
+                        TEST_XFER_TIMEOUT) == FX3SIM_SUCCESS);
+
+            /* The data comes back in buffers of up to a chunk. */
+            total = 0;
+            while (total < lengths[i]) {
+                TEST_CHECK (FX3SimBulkIn (CY_FX_EP_CONSUMER, readBack + total,
+                            sizeof (readBack) - total, &transferred,
+                            TEST_XFER_TIMEOUT) == FX3SIM_SUCCESS);
+                TEST_CHECK (transferred > 0);
+                total += transferred;
+            }
+            TEST_CHECK (total == lengths[i]);
+            TEST_CHECK (memcmp (data, readBack, lengths[i]) == 0);
+        }
+    }
+}
+
+/* Check the pattern of the given length and wait for the result. */
+static void
+TestPatternCheck (
+    const uint8_t   *data,
+    uint32_t        length
+) {
+    CyFxBulkLpPatternResult_t result;
+    uint32_t start;
+
+    TestVendorOut (CY_FX_RQT_PATTERN_CHECK, length, 0, NULL, 0);
+    TestBulkWrite (data, length, CyTrue);
+    start = FX3SimGetTime ();
+    do {
+        usleep (1000);
+        TestVendorIn (CY_FX_RQT_PATTERN_CHECK, 0, 0, &result, sizeof (result));
+        TEST_CHECK (FX3SimGetTime () - start < TEST_POLL_TIMEOUT);
+    } while (result.checkBytes != length);
+    TEST_CHECK (result.passed == 1);
+    TEST_CHECK (result.checkErrors == 0);
+}
+
+static void
+TestPatternSendCheck (
+    void
+) {
+    static uint8_t data[64 * 100];
+    static uint8_t readBack[64 * 100];
+    static uint8_t pattern[CY_FX_BULKLP_DMA_CHUNK_SIZE];
+
+    TestBoot (NULL, CY_U3P_SUPER_SPEED);
+    TestPattern (data, 0, sizeof (data));
+
+    TestVendorOut (CY_FX_RQT_PATTERN_SEND, sizeof (data), 0, NULL, 0);
+    TestBulkRead (readBack, sizeof (readBack));
+    TEST_CHECK (memcmp (data, readBack, sizeof (data)) == 0);
+
+    TestPatternCheck (data, sizeof (data));
+
+    /* Whole packets end with a ZLP, with and without a full last buffer. */
+    TestPattern (pattern, 0, sizeof (pattern));
+    TestPatternCheck (pattern, 3 * glTestPacketSize);
+    TestPatternCheck (pattern, sizeof (pattern));
+    TestPatternCheck (pattern, 777);
+
+    /* The pattern requests are refused outside of the CPU modes. */
+    TestSetDmaMode (CY_FX_DMA_MODE_DIRECT);
+    TEST_CHECK (FX3SimControl (TEST_RQT_OUT, CY_FX_RQT_PATTERN_SEND, 64, 0, NULL, 0,
+                TEST_XFER_TIMEOUT) == FX3SIM_ERROR_PIPE);
+}
+
+static void
+TestFujitsu (
+    void
+) {
+    FX3SimConfig_t config;
+    CyFxBulkLpFramGeometry_t geometry;
+
+    FX3SimDefaultConfig (&config);
+    config.framSize   = 32 * 1024;
+    config.framVendor = FX3SIM_FRAM_FUJITSU;
+    TestBoot (&config, CY_U3P_SUPER_SPEED);
+
+    TestGetGeometry (&geometry);
+    TEST_CHECK (geometry.capacity == 32 * 1024);
+    TEST_CHECK (geometry.addressBytes == 2);
+    TEST_CHECK (geometry.identified == 1);
+    TEST_CHECK (geometry.nSectors == 1);
+
+    TestSectorRoundTrip (0, CY_FX_BULKLP_DMA_BUF_SIZE);
+    TEST_CHECK (FX3SimControl (TEST_RQT_OUT, CY_FX_RQT_FRAM_WRITE, 100, 1, NULL, 0,
+                TEST_XFER_TIMEOUT) == FX3SIM_ERROR_PIPE);
+}
+
+static void
+TestBurst (
+    void
+) {
+    uint16_t pcktSize;
+    uint8_t burstLen;
+    uint8_t maxBurst;
+    uint32_t start;
+
+    TestBoot (NULL, CY_U3P_SUPER_SPEED);
+
+    TestVendorOut (CY_FX_RQT_SET_BURST, 4, 0, NULL, 0);
+    start = FX3SimGetTime ();
+    do {
+        usleep (1000);
+        TEST_CHECK (FX3SimEndpointInfo (CY_FX_EP_CONSUMER, &pcktSize, &burstLen, &maxBurst) == 0);
+        TEST_CHECK (FX3SimGetTime () - start < TEST_POLL_TIMEOUT);
+    } while (burstLen != 4);
+    TestSectorRoundTrip (1, CY_FX_BULKLP_DMA_BUF_SIZE);
+
+    TestReconfig (CY_FX_RQT_SET_BURST, 8, CY_FX_DMA_MODE_CPU);
+    TEST_CHECK (FX3SimEndpointInfo (CY_FX_EP_CONSUMER, &pcktSize, &burstLen, &maxBurst) == 0);
+    TEST_CHECK (burstLen == 8);
+}
+
+static void
+TestHighSpeed (
+    void
+) {
+    TestBoot (NULL, CY_U3P_HIGH_SPEED);
+    TEST_CHECK (glTestPacketSize == 512);
+    TestSectorRoundTrip (1, CY_FX_BULKLP_DMA_BUF_SIZE);
+    TestSectorRoundTrip (2, 512);
+}
+
+static const TestCase_t glTestCases[] =
+{
+    { "boot",       TestBootDefault },
+    { "clock",      TestClockLimit },
+    { "sector",     TestSector },
+    { "limits",     TestSectorLimits },
+    { "multi",      TestMulti },
+    { "bytes",      TestBytes },
+    { "bytes_cb",   TestBytesCallback },
+    { "ep0",        TestEp0 },
+    { "crc",        TestCrc },
+    { "verify",     TestVerify },
+    { "direct",     TestDirect },
+    { "callback",   TestCallback },
+    { "loop",       TestLoop },
+    { "pattern",    TestPatternSendCheck },
+    { "fujitsu",    TestFujitsu },
+    { "burst",      TestBurst },
+    { "highspeed",  TestHighSpeed },
+};
+
+/* Run a test in a child process, as the firmware can be booted once. */
+static int
+TestRun (
+    const TestCase_t    *test
+) {
+    pid_t pid;
+    int status;
+
+    fflush (stdout);
+    pid = fork ();
+    if (pid < 0) {
+        perror ("fork");
+        return 1;
+    }
+    if (pid == 0) {
+        alarm (TEST_TIMEOUT);
+        test->run ();
+        if (FX3SimErrorCount () != 0) {
+            fprintf (stderr, "%u simulation errors\n", FX3SimErrorCount ());
+            _exit (1);
+        }
+        _exit (0);
+    }
+
+    if (waitpid (pid, &status, 0) < 0) {
+        perror ("waitpid");
+        return 1;
+    }
+    if (WIFEXITED (status) && (WEXITSTATUS (status) == 0)) {
+        printf ("PASS %s\n", test->name);
+        return 0;
+    }
+    if (WIFSIGNALED (status)) {
+        printf ("FAIL %s (%s)\n", test->name,
+                (WTERMSIG (status) == SIGALRM) ? "timeout" : strsignal (WTERMSIG (status)));
+    } else {
+        printf ("FAIL %s\n", test->name);
+    }
+    return 1;
+}
+
+int
+main (
+    int     argc,
+    char    *argv[]
+) {
+    int nTests = sizeof (glTestCases) / sizeof (glTestCases[0]);
+    int failed = 0;
+    int found;
+    int i;
+    int j;
+
+    if (argc == 1) {
+        for (i = 0; i < nTests; i++) {
+            failed += TestRun (&glTestCases[i]);
+        }
+    } else {
+        for (j = 1; j < argc; j++) {
+            found = 0;
+            for (i = 0; i < nTests; i++) {
+                if (strcmp (argv[j], glTestCases[i].name) == 0) {
+                    failed += TestRun (&glTestCases[i]);
+                    found = 1;
+                }
+            }
+            if (!found) {
+                fprintf (stderr, "unknown test %s\n", argv[j]);
+                failed++;
+            }
+        }
+    }
+
+    printf ("%d failed\n", failed);
+    return (failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,794 @@
+/*
+ * FX3 host simulation: USB device and host
+ *
+ * The USB driver of the SDK is reduced to what the application uses.
+ * The host functions of fx3sim.h run in the context of the USB driver,
+ * so the setup and event callbacks are called in the host thread as
+ * they are called in the USB thread of the SDK.
+ *
+ * A bulk transfer moves packets between the host buffer and the DMA
+ * channel of the endpoint socket. OUT packets wait for a free buffer as
+ * the endpoint NAKs on the device, and an IN transfer ends with a short
+ * packet, a ZLP or when the host buffer is full. With usbTiming set,
+ * each packet takes its bus time, and the first packet of each burst
+ * takes the turnaround time of the burst.
+ */
+
+#include <string.h>
+
+#include "cyu3usb.h"
+#include "cyu3dma.h"
+#include "cyu3error.h"
+#include "simint.h"
+
+#define SIM_USB_EP_COUNT                (16)
+#define SIM_USB_STRING_COUNT            (16)
+
+/* Bus time per byte in ps and per burst in ns, roughly the bulk
+ * throughput of a host controller. */
+#define SIM_USB_SS_BYTE_PS              (2200)
+#define SIM_USB_SS_BURST_NS             (2000)
+#define SIM_USB_HS_BYTE_PS              (22000)
+#define SIM_USB_HS_BURST_NS             (1000)
+#define SIM_USB_FS_BYTE_PS              (1000000)
+#define SIM_USB_FS_BURST_NS             (10000)
+
+typedef struct SimUsbEp
+{
+    CyU3PEpConfig_t     config;
+    CyBool_t            isStalled;
+    uint8_t             maxBurst;       /* Burst length in the descriptors */
+    uint32_t            burstCount;     /* Packets sent in the current burst */
+} SimUsbEp;
+
+static CyBool_t simUsbStarted = CyFalse;
+static CyBool_t simConnected = CyFalse;
+static CyBool_t simSsEnable = CyFalse;
+static CyBool_t simConfigured = CyFalse;
+static CyU3PUSBSpeed_t simSpeed = CY_U3P_NOT_CONNECTED;
+
+static CyU3PUSBSetupCb_t simSetupCb = NULL;
+static CyU3PUSBEventCb_t simEventCb = NULL;
+
+static uint8_t *simSsDeviceDscr;
+static uint8_t *simHsDeviceDscr;
+static uint8_t *simDevQualDscr;
+static uint8_t *simFsConfigDscr;
+static uint8_t *simHsConfigDscr;
+static uint8_t *simSsConfigDscr;
+static uint8_t *simBosDscr;
+static uint8_t *simStringDscr[SIM_USB_STRING_COUNT];
+
+static SimUsbEp simEpOut[SIM_USB_EP_COUNT];
+static SimUsbEp simEpIn[SIM_USB_EP_COUNT];
+
+/* Control request in progress */
+static CyBool_t simEp0Active = CyFalse;
+static CyBool_t simEp0In;
+static uint8_t  *simEp0Data;
+static uint16_t simEp0Length;
+static uint16_t simEp0Count;
+static CyBool_t simEp0Stall;
+
+static SimUsbEp *
+SimUsbEpGet (
+        uint8_t ep)
+{
+    if (((ep & 0x0F) == 0) || ((ep & 0x70) != 0))
+    {
+        return NULL;
+    }
+    return ((ep & 0x80) != 0) ? &simEpIn[ep & 0x0F] : &simEpOut[ep & 0x0F];
+}
+
+CyBool_t
+SimUsbIsConnected (
+        void)
+{
+    return simConnected;
+}
+
+/* Take the bus time of a packet. */
+static void
+SimUsbPacketDelay (
+        SimUsbEp *ep_p,
+        uint32_t count)
+{
+    uint64_t ns;
+    uint32_t burstLen = (ep_p->config.burstLen > 0) ? ep_p->config.burstLen : 1;
+
+    if (!simConfig.usbTiming)
+    {
+        return;
+    }
+
+    switch (simSpeed)
+    {
+        case CY_U3P_SUPER_SPEED:
+            ns = (uint64_t)count * SIM_USB_SS_BYTE_PS / 1000;
+            ns += (ep_p->burstCount == 0) ? SIM_USB_SS_BURST_NS : 0;
+            break;
+        case CY_U3P_HIGH_SPEED:
+            ns = (uint64_t)count * SIM_USB_HS_BYTE_PS / 1000 + SIM_USB_HS_BURST_NS;
+            burstLen = 1;
+            break;
+        default:
+            ns = (uint64_t)count * SIM_USB_FS_BYTE_PS / 1000 + SIM_USB_FS_BURST_NS;
+            burstLen = 1;
+            break;
+    }
+
+    /* A short packet ends the burst. */
+    ep_p->burstCount++;
+    if ((ep_p->burstCount >= burstLen) || (count < ep_p->config.pcktSize))
+    {
+        ep_p->burstCount = 0;
+    }
+    SimBusDelay (ns);
+}
+
+/* Find the burst lengths in the SuperSpeed configuration descriptor. */
+static void
+SimUsbParseBursts (
+        void)
+{
+    uint8_t *dscr = simSsConfigDscr;
+    uint16_t total, offset;
+    uint8_t ep = 0;
+
+    if (dscr == NULL)
+    {
+        return;
+    }
+
+    total = dscr[2] | (dscr[3] << 8);
+    for (offset = 0; (offset < total) && (dscr[offset] != 0); offset += dscr[offset])
+    {
+        if (dscr[offset + 1] == CY_U3P_USB_ENDPNT_DESCR)
+        {
+            ep = dscr[offset + 2];
+        }
+        else if ((dscr[offset + 1] == CY_U3P_SS_EP_COMPN_DESCR) && (SimUsbEpGet (ep) != NULL))
+        {
+            SimUsbEpGet (ep)->maxBurst = dscr[offset + 2] + 1;
+        }
+    }
+}
+
+/* Copy a descriptor to the data stage of GET_DESCRIPTOR. */
+static int
+SimUsbGetDescriptor (
+        uint16_t wValue,
+        uint8_t *data,
+        uint16_t wLength)
+{
+    uint8_t *dscr = NULL;
+    uint16_t length;
+    CyBool_t isSuper = (simSpeed == CY_U3P_SUPER_SPEED);
+
+    switch (wValue >> 8)
+    {
+        case CY_U3P_USB_DEVICE_DESCR:
+            dscr = (isSuper) ? simSsDeviceDscr : simHsDeviceDscr;
+            break;
+        case CY_U3P_USB_CONFIG_DESCR:
+            dscr = (isSuper) ? simSsConfigDscr :
+                (simSpeed == CY_U3P_HIGH_SPEED) ? simHsConfigDscr : simFsConfigDscr;
+            break;
+        case CY_U3P_USB_DEVQUAL_DESCR:
+            dscr = (isSuper) ? NULL : simDevQualDscr;
+            break;
+        case CY_U3P_BOS_DESCR:
+            dscr = simBosDscr;
+            break;
+        case CY_U3P_USB_STRING_DESCR:
+            if ((wValue & 0xFF) < SIM_USB_STRING_COUNT)
+            {
+                dscr = simStringDscr[wValue & 0xFF];
+            }
+            break;
+        default:
+            break;
+    }
+    if (dscr == NULL)
+    {
+        return FX3SIM_ERROR_PIPE;
+    }
+
+    length = (((wValue >> 8) == CY_U3P_USB_CONFIG_DESCR) || ((wValue >> 8) == CY_U3P_BOS_DESCR)) ?
+        (dscr[2] | (dscr[3] << 8)) : dscr[0];
+    if (length > wLength)
+    {
+        length = wLength;
+    }
+    memcpy (data, dscr, length);
+    return length;
+}
+
+/* Serve a control request. Called with the lock held. */
+static int
+SimUsbControl (
+        uint8_t bmRequestType,
+        uint8_t bRequest,
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint8_t *data,
+        uint16_t wLength)
+{
+    uint8_t bType   = bmRequestType & CY_U3P_USB_TYPE_MASK;
+    uint8_t bTarget = bmRequestType & CY_U3P_USB_TARGET_MASK;
+    SimUsbEp *ep_p;
+    CyBool_t isHandled = CyFalse;
+
+    if (!simConnected)
+    {
+        return FX3SIM_ERROR_NO_DEVICE;
+    }
+
+    if (bType == CY_U3P_USB_STANDARD_RQT)
+    {
+        switch (bRequest)
+        {
+            case CY_U3P_USB_SC_GET_DESCRIPTOR:
+                return SimUsbGetDescriptor (wValue, data, wLength);
+
+            case CY_U3P_USB_SC_SET_CONFIGURATION:
+                simConfigured = (wValue != 0);
+                if ((simConfigured) && (simEventCb != NULL))
+                {
+                    simEventCb (CY_U3P_USB_EVENT_SETCONF, wValue);
+                }
+                return 0;
+
+            case CY_U3P_USB_SC_GET_STATUS:
+                if (wLength > 0)
+                {
+                    memset (data, 0, (wLength < 2) ? wLength : 2);
+                }
+                return (wLength < 2) ? wLength : 2;
+
+            case CY_U3P_USB_SC_SET_FEATURE:
+            case CY_U3P_USB_SC_CLEAR_FEATURE:
+                /* These requests are passed to the application first. */
+                if ((bTarget == CY_U3P_USB_TARGET_INTF) || (bTarget == CY_U3P_USB_TARGET_ENDPT))
+                {
+                    break;
+                }
+                return 0;
+
+            default:
+                return 0;
+        }
+    }
+
+    simEp0Active = CyTrue;
+    simEp0In     = ((bmRequestType & 0x80) != 0);
+    simEp0Data   = data;
+    simEp0Length = wLength;
+    simEp0Count  = 0;
+    simEp0Stall  = CyFalse;
+    if (simSetupCb != NULL)
+    {
+        isHandled = simSetupCb (bmRequestType | (bRequest << 8) | ((uint32_t)wValue << 16),
+                wIndex | ((uint32_t)wLength << 16));
+    }
+    simEp0Active = CyFalse;
+
+    /* The library clears the halt of an endpoint not handled by the
+     * application. */
+    if ((bType == CY_U3P_USB_STANDARD_RQT) && (bTarget == CY_U3P_USB_TARGET_ENDPT) &&
+            (bRequest == CY_U3P_USB_SC_CLEAR_FEATURE) && (!isHandled))
+    {
+        ep_p = SimUsbEpGet (wIndex);
+        if (ep_p != NULL)
+        {
+            ep_p->isStalled = CyFalse;
+        }
+        return 0;
+    }
+
+    if ((!isHandled) || (simEp0Stall))
+    {
+        return FX3SIM_ERROR_PIPE;
+    }
+    return (simEp0In) ? simEp0Count : wLength;
+}
+
+/* Host API */
+
+int
+FX3SimEnumerate (
+        CyU3PUSBSpeed_t speed)
+{
+    int status;
+    uint8_t dscr[18];
+
+    if ((speed < CY_U3P_FULL_SPEED) || (speed > CY_U3P_SUPER_SPEED))
+    {
+        return FX3SIM_ERROR_INVALID_PARAM;
+    }
+
+    SimEnter ();
+    if (!simConnected)
+    {
+        SimLeave ();
+        return FX3SIM_ERROR_NO_DEVICE;
+    }
+
+    if ((simConfigured) && (simEventCb != NULL))
+    {
+        simConfigured = CyFalse;
+        simEventCb (CY_U3P_USB_EVENT_RESET, 0);
+    }
+    simSpeed = ((speed == CY_U3P_SUPER_SPEED) && (!simSsEnable)) ? CY_U3P_HIGH_SPEED : speed;
+    SimUsbParseBursts ();
+
+    status = SimUsbControl (0x80, CY_U3P_USB_SC_GET_DESCRIPTOR, CY_U3P_USB_DEVICE_DESCR << 8, 0,
+            dscr, sizeof (dscr));
+    if (status == sizeof (dscr))
+    {
+        status = SimUsbControl (0x00, CY_U3P_USB_SC_SET_CONFIGURATION, 1, 0, NULL, 0);
+    }
+    else if (status >= 0)
+    {
+        SimError ("device descriptor is %d bytes", status);
+        status = FX3SIM_ERROR_IO;
+    }
+    SimLeave ();
+    return (status < 0) ? status : FX3SIM_SUCCESS;
+}
+
+int
+FX3SimControl (
+        uint8_t bmRequestType,
+        uint8_t bRequest,
+        uint16_t wValue,
+        uint16_t wIndex,
+        uint8_t *data,
+        uint16_t wLength,
+        uint32_t timeout)
+{
+    int status;
+
+    (void) timeout;
+
+    if ((wLength > 0) && (data == NULL))
+    {
+        return FX3SIM_ERROR_INVALID_PARAM;
+    }
+
+    SimEnter ();
+    status = SimUsbControl (bmRequestType, bRequest, wValue, wIndex, data, wLength);
+    SimBusFlush ();
+    SimLeave ();
+    return status;
+}
+
+int
+FX3SimBulkOut (
+        uint8_t ep,
+        const uint8_t *data,
+        uint32_t length,
+        uint32_t *transferred,
+        uint32_t timeout)
+{
+    SimUsbEp *ep_p = SimUsbEpGet (ep);
+    SimDmaChannel *ch;
+    struct timespec deadline;
+    uint32_t waitOption = (timeout == 0) ? CYU3P_WAIT_FOREVER : timeout;
+    uint32_t offset = 0;
+    uint32_t packet, done, space;
+    uint8_t *dest;
+    int status = FX3SIM_SUCCESS;
+
+    *transferred = 0;
+    if ((ep_p == NULL) || ((ep & 0x80) != 0))
+    {
+        return FX3SIM_ERROR_INVALID_PARAM;
+    }
+
+    SimEnter ();
+    SimDeadline (&deadline, waitOption);
+    do
+    {
+        if ((!simConfigured) || (!ep_p->config.enable) || (ep_p->config.pcktSize == 0))
+        {
+            status = FX3SIM_ERROR_IO;
+            break;
+        }
+        if (ep_p->isStalled)
+        {
+            status = FX3SIM_ERROR_PIPE;
+            break;
+        }
+
+        packet = length - offset;
+        if (packet > ep_p->config.pcktSize)
+        {
+            packet = ep_p->config.pcktSize;
+        }
+        SimUsbPacketDelay (ep_p, packet);
+
+        /* The packet may be split between the buffers of the channel. */
+        done = 0;
+        while (status == FX3SIM_SUCCESS)
+        {
+            ch = SimDmaFindProducer (CY_U3P_UIB_SOCKET_PROD_0 | (ep & 0x0F));
+            dest = (ch != NULL) ? SimDmaProdSpace (ch, &space) : NULL;
+            if (dest == NULL)
+            {
+                if (!SimWait (&deadline, waitOption))
+                {
+                    status = FX3SIM_ERROR_TIMEOUT;
+                }
+                continue;
+            }
+
+            if (space > packet - done)
+            {
+                space = packet - done;
+            }
+            memcpy (dest, data + offset + done, space);
+            done += space;
+            SimDmaProduce (ch, space, ((done == packet) && (packet < ep_p->config.pcktSize)));
+            if (done == packet)
+            {
+                break;
+            }
+        }
+        offset += done;
+    } while ((status == FX3SIM_SUCCESS) && (offset < length));
+
+    *transferred = offset;
+    SimBusFlush ();
+    SimLeave ();
+    return status;
+}
+
+int
+FX3SimBulkIn (
+        uint8_t ep,
+        uint8_t *data,
+        uint32_t length,
+        uint32_t *transferred,
+        uint32_t timeout)
+{
+    SimUsbEp *ep_p = SimUsbEpGet (ep);
+    SimDmaChannel *ch;
+    struct timespec deadline;
+    uint32_t waitOption = (timeout == 0) ? CYU3P_WAIT_FOREVER : timeout;
+    uint32_t offset = 0;
+    uint32_t packet, count;
+    CyBool_t isEop, isDelayed = CyFalse;
+    uint8_t *src;
+    int status = FX3SIM_SUCCESS;
+
+    *transferred = 0;
+    if ((ep_p == NULL) || ((ep & 0x80) == 0))
+    {
+        return FX3SIM_ERROR_INVALID_PARAM;
+    }
+
+    SimEnter ();
+    SimDeadline (&deadline, waitOption);
+    for (;;)
+    {
+        if ((!simConfigured) || (!ep_p->config.enable) || (ep_p->config.pcktSize == 0))
+        {
+            status = FX3SIM_ERROR_IO;
+            break;
+        }
+        if (ep_p->isStalled)
+        {
+            status = FX3SIM_ERROR_PIPE;
+            break;
+        }
+
+        ch = SimDmaFindConsumer (CY_U3P_UIB_SOCKET_CONS_0 | (ep & 0x0F));
+        src = (ch != NULL) ? SimDmaConsData (ch, &count, &isEop) : NULL;
+        if (src == NULL)
+        {
+            if (!SimWait (&deadline, waitOption))
+            {
+                status = FX3SIM_ERROR_TIMEOUT;
+                break;
+            }
+            continue;
+        }
+
+        packet = (count > ep_p->config.pcktSize) ? ep_p->config.pcktSize : count;
+        if (packet > length - offset)
+        {
+            status = FX3SIM_ERROR_OVERFLOW;
+            break;
+        }
+
+        /* The data is taken again after the bus time. */
+        if (!isDelayed)
+        {
+            SimUsbPacketDelay (ep_p, packet);
+            isDelayed = CyTrue;
+            continue;
+        }
+        isDelayed = CyFalse;
+
+        memcpy (data + offset, src, packet);
+        offset += packet;
+        SimDmaConsume (ch, packet);
+
+        /* A short packet or a ZLP ends the transfer. */
+        if ((packet < ep_p->config.pcktSize) || (offset == length))
+        {
+            break;
+        }
+    }
+
+    *transferred = offset;
+    SimBusFlush ();
+    SimLeave ();
+    return status;
+}
+
+int
+FX3SimEndpointInfo (
+        uint8_t ep,
+        uint16_t *pcktSize,
+        uint8_t *burstLen,
+        uint8_t *maxBurst)
+{
+    SimUsbEp *ep_p = SimUsbEpGet (ep);
+
+    if (ep_p == NULL)
+    {
+        return FX3SIM_ERROR_INVALID_PARAM;
+    }
+
+    SimEnter ();
+    *pcktSize = ep_p->config.pcktSize;
+    *burstLen = ep_p->config.burstLen;
+    *maxBurst = ep_p->maxBurst;
+    SimLeave ();
+    return FX3SIM_SUCCESS;
+}
+
+/* USB driver API */
+
+CyU3PReturnStatus_t
+CyU3PUsbStart (
+        void)
+{
+    if (simUsbStarted)
+    {
+        return CY_U3P_ERROR_ALREADY_STARTED;
+    }
+    simUsbStarted = CyTrue;
+    return CY_U3P_SUCCESS;
+}
+
+void
+CyU3PUsbRegisterSetupCallback (
+        CyU3PUSBSetupCb_t callback,
+        CyBool_t fastEnum)
+{
+    (void) fastEnum;
+    simSetupCb = callback;
+}
+
+void
+CyU3PUsbRegisterEventCallback (
+        CyU3PUSBEventCb_t callback)
+{
+    simEventCb = callback;
+}
+
+void
+CyU3PUsbRegisterLPMRequestCallback (
+        CyU3PUsbLPMReqCb_t callback)
+{
+    (void) callback;
+}
+
+CyU3PReturnStatus_t
+CyU3PUsbSetDesc (
+        CyU3PUSBSetDescType_t desc_type,
+        uint8_t desc_index,
+        uint8_t *desc)
+{
+    if (desc == NULL)
+    {
+        return CY_U3P_ERROR_NULL_POINTER;
+    }
+
+    switch (desc_type)
+    {
+        case CY_U3P_USB_SET_SS_DEVICE_DESCR:
+            simSsDeviceDscr = desc;
+            break;
+        case CY_U3P_USB_SET_HS_DEVICE_DESCR:
+            simHsDeviceDscr = desc;
+            break;
+        case CY_U3P_USB_SET_DEVQUAL_DESCR:
+            simDevQualDscr = desc;
+            break;
+        case CY_U3P_USB_SET_FS_CONFIG_DESCR:
+            simFsConfigDscr = desc;
+            break;
+        case CY_U3P_USB_SET_HS_CONFIG_DESCR:
+            simHsConfigDscr = desc;
+            break;
+        case CY_U3P_USB_SET_SS_CONFIG_DESCR:
+            simSsConfigDscr = desc;
+            break;
+        case CY_U3P_USB_SET_SS_BOS_DESCR:
+            simBosDscr = desc;
+            break;
+        case CY_U3P_USB_SET_STRING_DESCR:
+            if (desc_index >= SIM_USB_STRING_COUNT)
+            {
+                return CY_U3P_ERROR_BAD_INDEX;
+            }
+            simStringDscr[desc_index] = desc;
+            break;
+        default:
+            return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PConnectState (
+        CyBool_t connect,
+        CyBool_t ssEnable)
+{
+    if (!simUsbStarted)
+    {
+        return CY_U3P_ERROR_NOT_STARTED;
+    }
+
+    simConnected = connect;
+    simSsEnable  = ssEnable;
+    if (!connect)
+    {
+        simConfigured = CyFalse;
+        simSpeed = CY_U3P_NOT_CONNECTED;
+    }
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PUSBSpeed_t
+CyU3PUsbGetSpeed (
+        void)
+{
+    return simSpeed;
+}
+
+CyU3PReturnStatus_t
+CyU3PSetEpConfig (
+        uint8_t ep,
+        CyU3PEpConfig_t *epinfo)
+{
+    SimUsbEp *ep_p = SimUsbEpGet (ep);
+    uint16_t maxPacket = (simSpeed == CY_U3P_SUPER_SPEED) ? 1024 :
+        (simSpeed == CY_U3P_HIGH_SPEED) ? 512 : 64;
+
+    if ((ep_p == NULL) || (epinfo == NULL))
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+
+    if (epinfo->enable)
+    {
+        if (epinfo->pcktSize > maxPacket)
+        {
+            SimError ("EP 0x%02X packet size %d above %d", ep, epinfo->pcktSize, maxPacket);
+        }
+        if ((simSpeed == CY_U3P_SUPER_SPEED) && (ep_p->maxBurst != 0) &&
+                (epinfo->burstLen > ep_p->maxBurst))
+        {
+            SimError ("EP 0x%02X burst length %d above the descriptor maximum %d",
+                    ep, epinfo->burstLen, ep_p->maxBurst);
+        }
+    }
+
+    ep_p->config     = *epinfo;
+    ep_p->isStalled  = CyFalse;
+    ep_p->burstCount = 0;
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PUsbFlushEp (
+        uint8_t ep)
+{
+    return (SimUsbEpGet (ep) != NULL) ? CY_U3P_SUCCESS : CY_U3P_ERROR_BAD_ARGUMENT;
+}
+
+CyU3PReturnStatus_t
+CyU3PUsbResetEp (
+        uint8_t ep)
+{
+    return (SimUsbEpGet (ep) != NULL) ? CY_U3P_SUCCESS : CY_U3P_ERROR_BAD_ARGUMENT;
+}
+
+CyU3PReturnStatus_t
+CyU3PUsbAckSetup (
+        void)
+{
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PUsbStall (
+        uint8_t ep,
+        CyBool_t stall,
+        CyBool_t toggle)
+{
+    SimUsbEp *ep_p;
+
+    (void) toggle;
+
+    if (ep == 0)
+    {
+        if ((stall) && (simEp0Active))
+        {
+            simEp0Stall = CyTrue;
+        }
+        return CY_U3P_SUCCESS;
+    }
+
+    ep_p = SimUsbEpGet (ep);
+    if (ep_p == NULL)
+    {
+        return CY_U3P_ERROR_BAD_ARGUMENT;
+    }
+    ep_p->isStalled = stall;
+    SimSignal ();
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PUsbSendEP0Data (
+        uint16_t count,
+        uint8_t *buffer)
+{
+    if ((!simEp0Active) || (!simEp0In))
+    {
+        SimError ("EP0 data sent without an IN request");
+        return CY_U3P_ERROR_INVALID_SEQUENCE;
+    }
+
+    if (count > simEp0Length)
+    {
+        count = simEp0Length;
+    }
+    memcpy (simEp0Data, buffer, count);
+    simEp0Count = count;
+    return CY_U3P_SUCCESS;
+}
+
+CyU3PReturnStatus_t
+CyU3PUsbGetEP0Data (
+        uint16_t count,
+        uint8_t *buffer,
+        uint16_t *readCount)
+{
+    if ((!simEp0Active) || (simEp0In))
+    {
+        SimError ("EP0 data received without an OUT request");
+        return CY_U3P_ERROR_INVALID_SEQUENCE;
+    }
+
+    if (count > simEp0Length)
+    {
+        count = simEp0Length;
+    }
+    memcpy (buffer, simEp0Data, count);
+    simEp0Count = count;
+    if (readCount != NULL)
+    {
+        *readCount = count;
+    }
+    return CY_U3P_SUCCESS;
+}